@@ -638,13 +638,13 @@ class STS_AnalyticsManager
                     int currentPos = 0;
                     while (currentPos < bucketsData.Length())
                     {
-                        int nextKeyStart = bucketsData.IndexOfFrom("\"", currentPos);
+                        int nextKeyStart = bucketsData.IndexOfFrom(currentPos, "\"");
                         if (nextKeyStart < 0) break;
                         
-                        int keyEnd = bucketsData.IndexOfFrom("\":{", nextKeyStart + 1);
+                        int keyEnd = bucketsData.IndexOfFrom(nextKeyStart + 1, "\":{");
                         if (keyEnd < 0) break;
                         
-                        int entryEnd = bucketsData.IndexOfFrom("}", keyEnd + 2);
+                        int entryEnd = bucketsData.IndexOfFrom(keyEnd + 2, "}");
                         if (entryEnd < 0) break;
                         
                         string key = bucketsData.Substring(nextKeyStart + 1, keyEnd - nextKeyStart - 1);
@@ -731,10 +731,10 @@ class STS_AnalyticsManager
                     int currentPos = 0;
                     while (currentPos < pointsData.Length())
                     {
-                        int entryStart = pointsData.IndexOfFrom("{", currentPos);
+                        int entryStart = pointsData.IndexOfFrom(currentPos, "{");
                         if (entryStart < 0) break;
                         
-                        int entryEnd = pointsData.IndexOfFrom("}", entryStart);
+                        int entryEnd = pointsData.IndexOfFrom(entryStart, "}");
                         if (entryEnd < 0) break;
                         
                         string entryData = pointsData.Substring(entryStart, entryEnd - entryStart + 1);
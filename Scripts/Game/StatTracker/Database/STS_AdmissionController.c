@@ -0,0 +1,219 @@
+// STS_AdmissionController.c
+// Token-bucket admission control for database work. The refill rate follows the base operation rate and is
+// scaled down when measured database latency or server frame time rise, so persistence backs off on its own
+// when the server is near its frame budget. Callers that are refused defer their work instead of dropping it.
+
+class STS_AdmissionController
+{
+    // Singleton instance
+    private static ref STS_AdmissionController s_Instance;
+    
+    // Bucket state
+    protected float m_fTokens;
+    protected float m_fLastRefillTime;
+    
+    // Configuration
+    protected float m_fBaseRate = 100;            // Tokens per second with a healthy database and frame time
+    protected float m_fBurstSeconds = 2.0;        // Bucket capacity in seconds of the current rate
+    protected float m_fTargetLatencyMs = 20;      // Per-operation latency above which the rate is scaled down
+    protected float m_fFrameBudgetMs = 33;        // Frame time above which persistence starts backing off
+    protected float m_fFrameLimitMs = 100;        // Frame time at which persistence is throttled to the minimum
+    protected float m_fMinRateFraction = 0.05;    // Never drop below this fraction of the base rate
+    
+    // Join/leave waves temporarily raise capacity and rate
+    protected const float WAVE_DURATION_MS = 10000;
+    protected const float WAVE_RATE_MULTIPLIER = 2.0;
+    protected const float WAVE_CAPACITY_MULTIPLIER = 4.0;
+    protected float m_fWaveUntil = 0;
+    
+    // Measurements (exponential moving averages)
+    protected const float EMA_ALPHA = 0.1;
+    protected float m_fLatencyEmaMs = 0;
+    protected float m_fFrameTimeEmaMs = 0;
+    
+    // Statistics
+    protected int m_iTotalAdmitted = 0;
+    protected int m_iTotalDeferred = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_AdmissionController()
+    {
+        m_fLastRefillTime = System.GetTickCount();
+        m_fTokens = GetCapacity();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    static STS_AdmissionController GetInstance()
+    {
+        if (!s_Instance)
+            s_Instance = new STS_AdmissionController();
+        
+        return s_Instance;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Take cost tokens if available
+    bool TryAcquire(int cost = 1)
+    {
+        Refill();
+        
+        if (m_fTokens < cost)
+        {
+            m_iTotalDeferred++;
+            return false;
+        }
+        
+        m_fTokens -= cost;
+        m_iTotalAdmitted++;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Take as many tokens as are available, up to maxCost; returns the number taken
+    int AcquireUpTo(int maxCost)
+    {
+        Refill();
+        
+        int granted = Math.Min(maxCost, Math.Floor(m_fTokens));
+        if (granted <= 0)
+        {
+            m_iTotalDeferred++;
+            return 0;
+        }
+        
+        m_fTokens -= granted;
+        m_iTotalAdmitted++;
+        return granted;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Charge work that cannot be deferred (e.g. a shutdown flush) so the bucket still reflects it
+    void Consume(int cost)
+    {
+        Refill();
+        m_fTokens -= cost;
+        m_iTotalAdmitted++;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Milliseconds until cost tokens will be available at the current rate
+    int GetWaitTimeMs(int cost = 1)
+    {
+        Refill();
+        
+        float missing = cost - m_fTokens;
+        if (missing <= 0)
+            return 0;
+        
+        return Math.Ceil(missing * 1000 / GetCurrentRate());
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Report how long one database operation took
+    void RecordLatency(float latencyMs)
+    {
+        if (m_fLatencyEmaMs <= 0)
+            m_fLatencyEmaMs = latencyMs;
+        else
+            m_fLatencyEmaMs += EMA_ALPHA * (latencyMs - m_fLatencyEmaMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Report the server frame time, called every frame with the entity timeSlice in seconds
+    void ReportFrameTime(float timeSlice)
+    {
+        float frameMs = timeSlice * 1000;
+        if (m_fFrameTimeEmaMs <= 0)
+            m_fFrameTimeEmaMs = frameMs;
+        else
+            m_fFrameTimeEmaMs += EMA_ALPHA * (frameMs - m_fFrameTimeEmaMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Players are joining or leaving in numbers - allow a burst of saves and loads
+    void NotifyPlayerWave()
+    {
+        m_fWaveUntil = System.GetTickCount() + WAVE_DURATION_MS;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Effective refill rate in tokens per second
+    float GetCurrentRate()
+    {
+        float rate = m_fBaseRate;
+        
+        // Slow database: scale down proportionally to how far latency exceeds the target
+        if (m_fLatencyEmaMs > m_fTargetLatencyMs)
+            rate *= m_fTargetLatencyMs / m_fLatencyEmaMs;
+        
+        // Frame budget pressure: linear back-off between the budget and the hard limit
+        bool framePressure = m_fFrameTimeEmaMs > m_fFrameBudgetMs;
+        if (framePressure)
+            rate *= Math.Clamp((m_fFrameLimitMs - m_fFrameTimeEmaMs) / (m_fFrameLimitMs - m_fFrameBudgetMs), 0, 1);
+        
+        // Join/leave waves get extra throughput unless the frame budget is already tight
+        if (!framePressure && IsWaveActive())
+            rate *= WAVE_RATE_MULTIPLIER;
+        
+        return Math.Max(rate, m_fBaseRate * m_fMinRateFraction);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    float GetCapacity()
+    {
+        float capacity = Math.Max(1, GetCurrentRate() * m_fBurstSeconds);
+        if (IsWaveActive())
+            capacity *= WAVE_CAPACITY_MULTIPLIER;
+        
+        return capacity;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected bool IsWaveActive()
+    {
+        return System.GetTickCount() < m_fWaveUntil;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Refill()
+    {
+        float now = System.GetTickCount();
+        float elapsedMs = now - m_fLastRefillTime;
+        m_fLastRefillTime = now;
+        
+        if (elapsedMs <= 0)
+            return;
+        
+        m_fTokens = Math.Min(GetCapacity(), m_fTokens + GetCurrentRate() * elapsedMs / 1000);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetBaseRate(float operationsPerSecond)
+    {
+        m_fBaseRate = Math.Max(1, operationsPerSecond);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetFrameBudget(float budgetMs, float limitMs)
+    {
+        m_fFrameBudgetMs = Math.Max(1, budgetMs);
+        m_fFrameLimitMs = Math.Max(m_fFrameBudgetMs + 1, limitMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetTargetLatency(float latencyMs)
+    {
+        m_fTargetLatencyMs = Math.Max(1, latencyMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get admission statistics
+    void GetStatistics(out int totalAdmitted, out int totalDeferred, out float currentRate, out float latencyMs, out float frameTimeMs)
+    {
+        totalAdmitted = m_iTotalAdmitted;
+        totalDeferred = m_iTotalDeferred;
+        currentRate = GetCurrentRate();
+        latencyMs = m_fLatencyEmaMs;
+        frameTimeMs = m_fFrameTimeEmaMs;
+    }
+}
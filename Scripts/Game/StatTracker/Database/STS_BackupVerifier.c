@@ -0,0 +1,183 @@
+// STS_BackupVerifier.c
+// Background verification of backup chunks. Each run checks the next slice of the chunks referenced by the
+// given manifests, re-hashing one chunk at a time within a small per-frame budget, and resumes where the previous
+// run stopped, so every chunk is covered over successive runs without a stall on large backup sets.
+
+class STS_BackupVerifier
+{
+    protected STS_ChunkStore m_ChunkStore;
+    
+    // Current run
+    protected bool m_bRunning = false;
+    protected ref array<string> m_aChunks = new array<string>();
+    protected ref map<string, ref array<string>> m_mChunkManifests = new map<string, ref array<string>>();
+    protected int m_iRunStart = 0;
+    protected int m_iRunChecked = 0;
+    protected ref set<string> m_CorruptManifests = new set<string>();
+    protected int m_iCorruptChunks = 0;
+    protected func<array<string>, int> m_Callback;
+    
+    // Position in the sorted chunk list where the next run starts
+    protected int m_iCursor = 0;
+    
+    // Configuration
+    protected float m_fFrameBudgetMs = 1.0;
+    protected int m_iChunksPerRun = 256;
+    
+    // Statistics
+    protected int m_iTotalChecked = 0;
+    protected int m_iTotalCorrupt = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_BackupVerifier(STS_ChunkStore chunkStore)
+    {
+        m_ChunkStore = chunkStore;
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_BackupVerifier()
+    {
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Start a verification run over the chunks of the given manifests. The callback receives the manifests that
+    // reference a corrupt or missing chunk and the number of chunks checked. Returns false if a run is active.
+    bool Start(array<string> manifestPaths, func<array<string>, int> callback)
+    {
+        if (m_bRunning || !m_ChunkStore)
+            return false;
+        
+        m_aChunks.Clear();
+        m_mChunkManifests.Clear();
+        m_CorruptManifests.Clear();
+        m_iCorruptChunks = 0;
+        m_iRunChecked = 0;
+        m_Callback = callback;
+        
+        foreach (string manifestPath : manifestPaths)
+        {
+            STS_BackupManifest manifest = STS_BackupManifest.Load(manifestPath);
+            if (!manifest || !manifest.IsConsistent())
+            {
+                m_CorruptManifests.Insert(manifestPath);
+                continue;
+            }
+            
+            foreach (STS_BackupManifestFile entry : manifest.m_aFiles)
+            {
+                foreach (string chunk : entry.m_aChunks)
+                {
+                    array<string> owners = m_mChunkManifests.Get(chunk);
+                    if (!owners)
+                    {
+                        owners = new array<string>();
+                        m_mChunkManifests.Set(chunk, owners);
+                        m_aChunks.Insert(chunk);
+                    }
+                    
+                    if (owners.Find(manifestPath) == -1)
+                        owners.Insert(manifestPath);
+                }
+            }
+        }
+        
+        // A stable order lets the cursor carry over between runs
+        m_aChunks.Sort();
+        
+        if (m_iCursor >= m_aChunks.Count())
+            m_iCursor = 0;
+        m_iRunStart = m_iCursor;
+        
+        m_bRunning = true;
+        GetGame().GetCallqueue().CallLater(ProcessFrame, 0, true);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Verify chunks until this frame's budget is spent
+    protected void ProcessFrame()
+    {
+        int startTime = System.GetTickCount();
+        int runLength = Math.Min(m_iChunksPerRun, m_aChunks.Count());
+        
+        while (m_iRunChecked < runLength && System.GetTickCount() - startTime < m_fFrameBudgetMs)
+        {
+            string chunk = m_aChunks[m_iCursor];
+            m_iCursor = (m_iCursor + 1) % m_aChunks.Count();
+            m_iRunChecked++;
+            m_iTotalChecked++;
+            
+            if (m_ChunkStore.VerifyChunk(chunk))
+                continue;
+            
+            m_iCorruptChunks++;
+            m_iTotalCorrupt++;
+            
+            if (m_Logger)
+                m_Logger.LogWarning(string.Format("Backup chunk %1 is missing or corrupt", chunk), "STS_BackupVerifier", "ProcessFrame");
+            
+            foreach (string manifestPath : m_mChunkManifests.Get(chunk))
+            {
+                m_CorruptManifests.Insert(manifestPath);
+            }
+        }
+        
+        if (m_iRunChecked >= runLength)
+            Finish();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Finish()
+    {
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+        m_bRunning = false;
+        
+        array<string> corrupt = new array<string>();
+        foreach (string manifestPath : m_CorruptManifests)
+        {
+            corrupt.Insert(manifestPath);
+        }
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Verified %1 of %2 backup chunks (from #%3), %4 corrupt",
+                m_iRunChecked, m_aChunks.Count(), m_iRunStart, m_iCorruptChunks), "STS_BackupVerifier", "Finish");
+        
+        // Release the chunk index; it is rebuilt from the manifests on the next run
+        m_aChunks.Clear();
+        m_mChunkManifests.Clear();
+        
+        if (m_Callback)
+            m_Callback(corrupt, m_iRunChecked);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsRunning()
+    {
+        return m_bRunning;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetFrameBudget(float budgetMs)
+    {
+        m_fFrameBudgetMs = Math.Max(0.1, budgetMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Chunks checked per run; runs continue from where the previous one stopped
+    void SetChunksPerRun(int chunksPerRun)
+    {
+        m_iChunksPerRun = Math.Max(1, chunksPerRun);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get verification statistics
+    void GetStatistics(out int totalChecked, out int totalCorrupt)
+    {
+        totalChecked = m_iTotalChecked;
+        totalCorrupt = m_iTotalCorrupt;
+    }
+}
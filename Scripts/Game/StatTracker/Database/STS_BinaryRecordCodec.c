@@ -0,0 +1,448 @@
+// STS_BinaryRecordCodec.c
+// Compact versioned binary layout for the complex parts of a player stats record
+// (weapon kills, killed-by and kill history). Bytes are packed four to an int so the
+// result can be stored as a plain array<int> entity property.
+
+//------------------------------------------------------------------------------------------------
+// Appends bytes, varints and length-prefixed strings to a packed int array
+class STS_ByteWriter
+{
+    protected ref array<int> m_aWords = new array<int>();
+    protected int m_iByteCount = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void WriteByte(int value)
+    {
+        int shift = (m_iByteCount % 4) * 8;
+        if (shift == 0)
+            m_aWords.Insert(0);
+        
+        int last = m_aWords.Count() - 1;
+        m_aWords[last] = m_aWords[last] | ((value & 0xFF) << shift);
+        m_iByteCount++;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Unsigned LEB128 varint; the value is treated as 32-bit unsigned
+    void WriteVarUInt(int value)
+    {
+        while (true)
+        {
+            int b = value & 0x7F;
+            value = (value >> 7) & 0x01FFFFFF; // Logical shift
+            
+            if (value == 0)
+            {
+                WriteByte(b);
+                return;
+            }
+            
+            WriteByte(b | 0x80);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Zigzag-encoded signed varint so small negative numbers stay short
+    void WriteVarInt(int value)
+    {
+        WriteVarUInt((value << 1) ^ (value >> 31));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Length-prefixed string
+    void WriteString(string value)
+    {
+        int length = value.Length();
+        WriteVarUInt(length);
+        
+        for (int i = 0; i < length; i++)
+        {
+            WriteByte(value.Get(i).ToAscii());
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    array<int> GetWords()
+    {
+        return m_aWords;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetByteCount()
+    {
+        return m_iByteCount;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Reads values written by STS_ByteWriter. Reading past the end sets the error flag instead of throwing.
+class STS_ByteReader
+{
+    protected array<int> m_aWords;
+    protected int m_iByteCount;
+    protected int m_iPosition = 0;
+    protected bool m_bError = false;
+    
+    protected static const int STRING_RUN_LENGTH = 64;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_ByteReader(array<int> words, int byteCount = -1)
+    {
+        m_aWords = words;
+        
+        m_iByteCount = 0;
+        if (words)
+            m_iByteCount = words.Count() * 4;
+        
+        if (byteCount >= 0 && byteCount < m_iByteCount)
+            m_iByteCount = byteCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int ReadByte()
+    {
+        if (m_iPosition >= m_iByteCount)
+        {
+            m_bError = true;
+            return 0;
+        }
+        
+        int word = m_aWords[m_iPosition / 4];
+        int shift = (m_iPosition % 4) * 8;
+        m_iPosition++;
+        
+        return (word >> shift) & 0xFF;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int ReadVarUInt()
+    {
+        int result = 0;
+        
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            int b = ReadByte();
+            if (m_bError)
+                return 0;
+            
+            result = result | ((b & 0x7F) << shift);
+            
+            if ((b & 0x80) == 0)
+                return result;
+        }
+        
+        // More than five continuation bytes - not a valid 32-bit varint
+        m_bError = true;
+        return 0;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int ReadVarInt()
+    {
+        int zigzag = ReadVarUInt();
+        return ((zigzag >> 1) & 0x7FFFFFFF) ^ -(zigzag & 1);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Strings are built in short runs that are joined once, so long strings do not cost a copy per byte
+    string ReadString()
+    {
+        int length = ReadVarUInt();
+        if (m_bError || length < 0 || length > GetRemaining())
+        {
+            m_bError = true;
+            return "";
+        }
+        
+        array<string> pieces = new array<string>();
+        string run = "";
+        for (int i = 0; i < length; i++)
+        {
+            run += string.FromAscii(ReadByte());
+            if (run.Length() >= STRING_RUN_LENGTH)
+            {
+                pieces.Insert(run);
+                run = "";
+            }
+        }
+        
+        pieces.Insert(run);
+        return STS_LZCodec.JoinPieces(pieces);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Reads a count of items that each take at least one byte; a negative count or one the remaining
+    // bytes cannot hold means the data is malformed
+    int ReadCount()
+    {
+        int count = ReadVarUInt();
+        if (m_bError || count < 0 || count > GetRemaining())
+        {
+            m_bError = true;
+            return 0;
+        }
+        
+        return count;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetRemaining()
+    {
+        return m_iByteCount - m_iPosition;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool HasError()
+    {
+        return m_bError;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Encodes and decodes the weapon kills, killed-by and kill history of a player record.
+//
+// Layout (version 3):
+//   byte    format version
+//   varint  string table size, followed by length-prefixed strings (weapon and player names, interned)
+//   varint  weapon kill count, followed by (varint string id, varint kills)
+//   varint  killed-by count, followed by (varint string id, varint deaths)
+//   varint  kill history count, followed by per record:
+//           varint killer id, varint victim id, varint weapon id,
+//           zigzag varint timestamp delta to the previous record,
+//           varint (distance in decimetres << 1 | headshot),
+//           zigzag varint x, y, z in whole metres, each as delta to the previous record
+//   kill rollup: varint kills, varint headshots, varint total distance in metres,
+//           varint longest distance in decimetres, zigzag varint first timestamp,
+//           varint last timestamp delta to the first, varint rolled-up kills in the last second
+// Version 1 records have no positions and no rollup, version 2 rollups have no last second count; both
+// are still decoded.
+class STS_PlayerStatsBinaryCodec
+{
+    static const int FORMAT_VERSION = 3;
+    
+    //------------------------------------------------------------------------------------------------
+    // Encode the complex stats into packed words; returns the number of bytes written
+    static int Encode(map<string, int> weaponKills, map<string, int> killedBy, array<ref STS_KillRecord> killHistory, STS_KillHistoryRollup rollup, out array<int> packed)
+    {
+        // Intern every string once so repeated weapon and player names cost a single varint each
+        map<string, int> stringIds = new map<string, int>();
+        array<string> strings = new array<string>();
+        
+        if (weaponKills)
+        {
+            foreach (string weapon, int kills : weaponKills)
+            {
+                InternString(weapon, stringIds, strings);
+            }
+        }
+        
+        if (killedBy)
+        {
+            foreach (string killer, int deaths : killedBy)
+            {
+                InternString(killer, stringIds, strings);
+            }
+        }
+        
+        if (killHistory)
+        {
+            foreach (STS_KillRecord record : killHistory)
+            {
+                InternString(record.m_sKillerName, stringIds, strings);
+                InternString(record.m_sVictimName, stringIds, strings);
+                InternString(record.m_sWeapon, stringIds, strings);
+            }
+        }
+        
+        STS_ByteWriter writer = new STS_ByteWriter();
+        writer.WriteByte(FORMAT_VERSION);
+        
+        writer.WriteVarUInt(strings.Count());
+        foreach (string value : strings)
+        {
+            writer.WriteString(value);
+        }
+        
+        WriteCounterMap(writer, weaponKills, stringIds);
+        WriteCounterMap(writer, killedBy, stringIds);
+        
+        if (!killHistory)
+        {
+            writer.WriteVarUInt(0);
+        }
+        else
+        {
+            writer.WriteVarUInt(killHistory.Count());
+            
+            int previousTimestamp = 0;
+            array<int> previousPosition = {0, 0, 0};
+            foreach (STS_KillRecord record : killHistory)
+            {
+                writer.WriteVarUInt(stringIds.Get(record.m_sKillerName));
+                writer.WriteVarUInt(stringIds.Get(record.m_sVictimName));
+                writer.WriteVarUInt(stringIds.Get(record.m_sWeapon));
+                writer.WriteVarInt(record.m_iTimestamp - previousTimestamp);
+                previousTimestamp = record.m_iTimestamp;
+                
+                int decimetres = Math.Max(0, Math.Round(record.m_fDistance * 10));
+                int packedDistance = decimetres << 1;
+                if (record.m_bHeadshot)
+                    packedDistance = packedDistance | 1;
+                
+                writer.WriteVarUInt(packedDistance);
+                
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    int coordinate = Math.Round(record.m_vPosition[axis]);
+                    writer.WriteVarInt(coordinate - previousPosition[axis]);
+                    previousPosition[axis] = coordinate;
+                }
+            }
+        }
+        
+        if (!rollup)
+            rollup = new STS_KillHistoryRollup();
+        
+        writer.WriteVarUInt(rollup.m_iKills);
+        writer.WriteVarUInt(rollup.m_iHeadshots);
+        writer.WriteVarUInt(Math.Max(0, Math.Round(rollup.m_fTotalDistance)));
+        writer.WriteVarUInt(Math.Max(0, Math.Round(rollup.m_fLongestDistance * 10)));
+        writer.WriteVarInt(rollup.m_iFirstTimestamp);
+        writer.WriteVarUInt(Math.Max(0, rollup.m_iLastTimestamp - rollup.m_iFirstTimestamp));
+        writer.WriteVarUInt(Math.Max(0, rollup.m_iLastTimestampKills));
+        
+        packed = writer.GetWords();
+        return writer.GetByteCount();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Decode packed words; returns false on an unknown version or truncated data
+    static bool Decode(array<int> packed, int byteCount, out map<string, int> weaponKills, out map<string, int> killedBy, out array<ref STS_KillRecord> killHistory, out STS_KillHistoryRollup rollup)
+    {
+        weaponKills = new map<string, int>();
+        killedBy = new map<string, int>();
+        killHistory = new array<ref STS_KillRecord>();
+        rollup = new STS_KillHistoryRollup();
+        
+        if (!packed || packed.IsEmpty())
+            return false;
+        
+        STS_ByteReader reader = new STS_ByteReader(packed, byteCount);
+        
+        int version = reader.ReadByte();
+        if (version < 1 || version > FORMAT_VERSION)
+            return false;
+        
+        int stringCount = reader.ReadCount();
+        array<string> strings = new array<string>();
+        for (int i = 0; i < stringCount && !reader.HasError(); i++)
+        {
+            strings.Insert(reader.ReadString());
+        }
+        
+        if (!ReadCounterMap(reader, strings, weaponKills) || !ReadCounterMap(reader, strings, killedBy))
+            return false;
+        
+        int recordCount = reader.ReadCount();
+        int timestamp = 0;
+        array<int> position = {0, 0, 0};
+        for (int r = 0; r < recordCount && !reader.HasError(); r++)
+        {
+            int killerId = reader.ReadVarUInt();
+            int victimId = reader.ReadVarUInt();
+            int weaponId = reader.ReadVarUInt();
+            timestamp += reader.ReadVarInt();
+            int packedDistance = reader.ReadVarUInt();
+            
+            if (version >= 2)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    position[axis] = position[axis] + reader.ReadVarInt();
+                }
+            }
+            
+            if (reader.HasError() || !IsStringId(killerId, strings) || !IsStringId(victimId, strings) || !IsStringId(weaponId, strings))
+                return false;
+            
+            STS_KillRecord record = new STS_KillRecord();
+            record.m_sKillerName = strings[killerId];
+            record.m_sVictimName = strings[victimId];
+            record.m_sWeapon = strings[weaponId];
+            record.m_iTimestamp = timestamp;
+            record.m_fDistance = ((packedDistance >> 1) & 0x7FFFFFFF) / 10.0;
+            record.m_bHeadshot = (packedDistance & 1) != 0;
+            record.m_vPosition = Vector(position[0], position[1], position[2]);
+            killHistory.Insert(record);
+        }
+        
+        if (version >= 2)
+        {
+            rollup.m_iKills = reader.ReadVarUInt();
+            rollup.m_iHeadshots = reader.ReadVarUInt();
+            rollup.m_fTotalDistance = reader.ReadVarUInt();
+            rollup.m_fLongestDistance = reader.ReadVarUInt() / 10.0;
+            rollup.m_iFirstTimestamp = reader.ReadVarInt();
+            rollup.m_iLastTimestamp = rollup.m_iFirstTimestamp + reader.ReadVarUInt();
+            
+            if (version >= 3)
+                rollup.m_iLastTimestampKills = reader.ReadVarUInt();
+            else if (rollup.m_iKills > 0)
+                rollup.m_iLastTimestampKills = 1;
+        }
+        
+        return !reader.HasError();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Varints above 2^31 read back negative, so both ends of the range are checked
+    protected static bool IsStringId(int id, array<string> strings)
+    {
+        return id >= 0 && id < strings.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static void InternString(string value, map<string, int> stringIds, array<string> strings)
+    {
+        if (stringIds.Contains(value))
+            return;
+        
+        stringIds.Insert(value, strings.Count());
+        strings.Insert(value);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static void WriteCounterMap(STS_ByteWriter writer, map<string, int> counters, map<string, int> stringIds)
+    {
+        if (!counters)
+        {
+            writer.WriteVarUInt(0);
+            return;
+        }
+        
+        writer.WriteVarUInt(counters.Count());
+        foreach (string key, int value : counters)
+        {
+            writer.WriteVarUInt(stringIds.Get(key));
+            writer.WriteVarUInt(Math.Max(0, value));
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static bool ReadCounterMap(STS_ByteReader reader, array<string> strings, map<string, int> counters)
+    {
+        int count = reader.ReadCount();
+        for (int i = 0; i < count; i++)
+        {
+            int id = reader.ReadVarUInt();
+            int value = reader.ReadVarUInt();
+            
+            if (reader.HasError() || !IsStringId(id, strings))
+                return false;
+            
+            counters.Set(strings[id], value);
+        }
+        
+        return !reader.HasError();
+    }
+}
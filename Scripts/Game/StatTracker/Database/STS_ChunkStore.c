@@ -0,0 +1,893 @@
+// STS_ChunkStore.c
+// Content-addressed, deduplicated backup store. Files are split into chunks at content-defined byte boundaries
+// and every chunk is stored once under the hash of its content; a backup is a small manifest listing the chunks
+// of each file. Unchanged data costs no writes, and retained backups share their chunks. Files are read as raw
+// bytes, so binary databases round-trip exactly, and the source directory is walked with its subdirectories.
+//
+// Chunk file: "STB" and a mode byte, then Z = the content as an STS_LZCodec frame, R = the raw bytes (content
+// with NUL bytes cannot be held in a string, and content that does not compress). Chunk files without that
+// header were written by earlier versions, which split on lines; they are read back as lines, each followed by
+// a newline.
+//
+// Manifest format (line based):
+//   STSMANIFEST <version>
+//   created <unix time>
+//   digest <hex>           (over every file entry and chunk key; chunk keys are digests of their content)
+//   file <byte count> <chunk count> <relative path>
+//   <chunk key>            (one line per chunk, in order)
+
+//------------------------------------------------------------------------------------------------
+class STS_BackupManifestFile
+{
+    string m_sRelativePath;
+    int m_iByteCount;
+    ref array<string> m_aChunks = new array<string>();
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_BackupManifest
+{
+    static const int FORMAT_VERSION = 1;
+    
+    int m_iCreated;
+    string m_sDigest;
+    ref array<ref STS_BackupManifestFile> m_aFiles = new array<ref STS_BackupManifestFile>();
+    
+    // Running digest, folded in as file entries are completed
+    protected int m_iDigestA = 0;
+    protected int m_iDigestB = 0x5bd1e995;
+    
+    // Statistics of the backup run that produced this manifest - not persisted
+    int m_iNewChunks;
+    int m_iReusedChunks;
+    int m_iBytesWritten;
+    int m_iBytesTotal;
+    
+    //------------------------------------------------------------------------------------------------
+    // Add a completed file entry and fold it into the running digest
+    void AddFile(STS_BackupManifestFile entry)
+    {
+        m_aFiles.Insert(entry);
+        FoldDigest(entry);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Digest of the running fold; matches ComputeDigest() once every entry was added through AddFile
+    string GetRunningDigest()
+    {
+        return STS_ChunkStore.ToHex(m_iDigestA) + STS_ChunkStore.ToHex(m_iDigestB);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Recompute the digest from the entries
+    string ComputeDigest()
+    {
+        m_iDigestA = 0;
+        m_iDigestB = 0x5bd1e995;
+        
+        foreach (STS_BackupManifestFile entry : m_aFiles)
+        {
+            FoldDigest(entry);
+        }
+        
+        return GetRunningDigest();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether the stored digest matches the entries; manifests written without one cannot be checked
+    bool IsConsistent()
+    {
+        return m_sDigest.IsEmpty() || m_sDigest == ComputeDigest();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void FoldDigest(STS_BackupManifestFile entry)
+    {
+        FoldToken(entry.m_sRelativePath + ":" + entry.m_iByteCount.ToString());
+        foreach (string chunk : entry.m_aChunks)
+        {
+            FoldToken(chunk);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void FoldToken(string token)
+    {
+        m_iDigestA = m_iDigestA * 31 + token.Hash();
+        m_iDigestB = (m_iDigestB ^ ("#" + token).Hash()) * 0x01000193;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool Save(string path)
+    {
+        string tempPath = path + ".tmp";
+        FileHandle file = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!file)
+            return false;
+        
+        WriteHeader(file);
+        
+        foreach (STS_BackupManifestFile entry : m_aFiles)
+        {
+            WriteFileHeader(file, entry);
+            foreach (string chunk : entry.m_aChunks)
+            {
+                file.WriteLine(chunk);
+            }
+        }
+        
+        file.Close();
+        
+        // A manifest only appears once it is complete
+        if (!FileIO.CopyFile(tempPath, path))
+            return false;
+        
+        FileIO.DeleteFile(tempPath);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Version, creation time and digest; file entries follow
+    void WriteHeader(FileHandle file)
+    {
+        file.WriteLine("STSMANIFEST " + FORMAT_VERSION.ToString());
+        file.WriteLine("created " + m_iCreated.ToString());
+        file.WriteLine("digest " + m_sDigest);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // The line that opens a file entry; its chunk keys follow one per line
+    static void WriteFileHeader(FileHandle file, STS_BackupManifestFile entry)
+    {
+        file.WriteLine(string.Format("file %1 %2 %3", entry.m_iByteCount, entry.m_aChunks.Count(), entry.m_sRelativePath));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read a manifest; returns null if the file is missing or malformed
+    static STS_BackupManifest Load(string path)
+    {
+        FileHandle file = FileIO.OpenFile(path, FileMode.READ);
+        if (!file)
+            return null;
+        
+        STS_BackupManifest manifest = new STS_BackupManifest();
+        bool valid = false;
+        
+        string line;
+        if (file.ReadLine(line) >= 0 && line.StartsWith("STSMANIFEST "))
+        {
+            valid = line.Substring(12, line.Length() - 12).ToInt() == FORMAT_VERSION;
+            
+            STS_BackupManifestFile entry;
+            int remainingChunks = 0;
+            
+            while (valid && file.ReadLine(line) >= 0)
+            {
+                if (remainingChunks > 0)
+                {
+                    entry.m_aChunks.Insert(line);
+                    remainingChunks--;
+                    continue;
+                }
+                
+                // The path comes last so it may contain spaces
+                array<string> fields = new array<string>();
+                line.Split(" ", fields, true);
+                
+                if (fields.Count() == 2 && fields[0] == "created")
+                {
+                    manifest.m_iCreated = fields[1].ToInt();
+                }
+                else if (fields.Count() == 2 && fields[0] == "digest")
+                {
+                    manifest.m_sDigest = fields[1];
+                }
+                else if (fields.Count() >= 4 && fields[0] == "file")
+                {
+                    int pathStart = fields[0].Length() + fields[1].Length() + fields[2].Length() + 3;
+                    
+                    entry = new STS_BackupManifestFile();
+                    entry.m_iByteCount = fields[1].ToInt();
+                    remainingChunks = fields[2].ToInt();
+                    entry.m_sRelativePath = line.Substring(pathStart, line.Length() - pathStart);
+                    manifest.m_aFiles.Insert(entry);
+                }
+                else
+                {
+                    valid = false;
+                }
+            }
+            
+            // A truncated chunk list means the manifest is unusable
+            if (remainingChunks > 0)
+                valid = false;
+        }
+        
+        file.Close();
+        
+        if (!valid)
+            return null;
+        
+        return manifest;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_ChunkStore
+{
+    protected static const string CHUNK_EXTENSION = ".chunk";
+    protected static const string MANIFEST_EXTENSION = ".manifest";
+    
+    protected static const string CHUNK_MAGIC = "STB";
+    protected static const string MODE_COMPRESSED = "Z";
+    protected static const string MODE_RAW = "R";
+    
+    // A chunk ends after a byte where the hash of the last four bytes matches the mask once it holds at least
+    // MIN_CHUNK_BYTES, or at MAX_CHUNK_BYTES; boundaries depend on content, so an edit only changes the chunks
+    // it touches
+    protected static const int MIN_CHUNK_BYTES = 1024;
+    protected static const int MAX_CHUNK_BYTES = 16384;
+    protected static const int BOUNDARY_MASK = 0x0FFF;
+    
+    protected static const int STRING_RUN_LENGTH = 64;
+    
+    protected string m_sChunkDirectory;
+    
+    // Directories whose manifests keep chunks alive during garbage collection
+    protected ref array<string> m_aManifestDirectories = new array<string>();
+    
+    // Chunks known to exist, so repeated backups skip the existence check
+    protected ref set<string> m_KnownChunks = new set<string>();
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    // Targets of the FindFiles callback while a directory is listed
+    protected array<string> m_aFoundFiles;
+    protected array<string> m_aFoundDirectories;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_ChunkStore(string chunkDirectory)
+    {
+        m_sChunkDirectory = chunkDirectory;
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Register a directory of manifests that garbage collection must keep the chunks of
+    void AddManifestDirectory(string directory)
+    {
+        if (m_aManifestDirectories.Find(directory) == -1)
+            m_aManifestDirectories.Insert(directory);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Back up every file below sourceDirectory into a manifest; returns null on failure
+    STS_BackupManifest CreateBackup(string sourceDirectory, string manifestPath)
+    {
+        if (!FileIO.FileExists(m_sChunkDirectory))
+            FileIO.MakeDirectory(m_sChunkDirectory);
+        
+        array<string> files = new array<string>();
+        CollectFiles(sourceDirectory, files);
+        
+        STS_BackupManifest manifest = new STS_BackupManifest();
+        manifest.m_iCreated = System.GetUnixTime();
+        
+        foreach (string path : files)
+        {
+            // Leftovers of interrupted writes are not part of the data set
+            if (path.EndsWith(".tmp"))
+                continue;
+            
+            STS_BackupManifestFile entry = StoreFile(path, manifest);
+            if (!entry)
+            {
+                if (m_Logger)
+                    m_Logger.LogError(string.Format("Failed to back up %1", path), "STS_ChunkStore", "CreateBackup");
+                return null;
+            }
+            
+            entry.m_sRelativePath = GetRelativePath(sourceDirectory, path);
+            manifest.AddFile(entry);
+        }
+        
+        // The digest was built while the chunks were hashed, so writing it costs no extra read
+        manifest.m_sDigest = manifest.GetRunningDigest();
+        
+        if (!manifest.Save(manifestPath))
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Failed to write backup manifest %1", manifestPath), "STS_ChunkStore", "CreateBackup");
+            return null;
+        }
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Backup %1: %2 files, %3 new chunks (%4 bytes written), %5 chunks reused of %6 bytes total",
+                manifestPath, manifest.m_aFiles.Count(), manifest.m_iNewChunks, manifest.m_iBytesWritten,
+                manifest.m_iReusedChunks, manifest.m_iBytesTotal), "STS_ChunkStore", "CreateBackup");
+        
+        return manifest;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Rebuild the files of a manifest below targetDirectory
+    bool Restore(string manifestPath, string targetDirectory)
+    {
+        STS_BackupManifest manifest = STS_BackupManifest.Load(manifestPath);
+        if (!manifest)
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Missing or corrupt backup manifest %1", manifestPath), "STS_ChunkStore", "Restore");
+            return false;
+        }
+        
+        // Check every chunk first so a broken backup does not leave a half-restored database
+        foreach (STS_BackupManifestFile entry : manifest.m_aFiles)
+        {
+            foreach (string chunk : entry.m_aChunks)
+            {
+                if (!FileIO.FileExists(GetChunkPath(chunk)))
+                {
+                    if (m_Logger)
+                        m_Logger.LogError(string.Format("Backup %1 references missing chunk %2", manifestPath, chunk), "STS_ChunkStore", "Restore");
+                    return false;
+                }
+            }
+        }
+        
+        if (!FileIO.FileExists(targetDirectory))
+            FileIO.MakeDirectory(targetDirectory);
+        
+        foreach (STS_BackupManifestFile restoreEntry : manifest.m_aFiles)
+        {
+            MakeParentDirectories(targetDirectory, restoreEntry.m_sRelativePath);
+            
+            if (!RestoreFile(restoreEntry, targetDirectory + "/" + restoreEntry.m_sRelativePath))
+                return false;
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Delete chunks no manifest in the registered directories refers to; returns the number deleted
+    int CollectGarbage()
+    {
+        set<string> live = new set<string>();
+        
+        foreach (string directory : m_aManifestDirectories)
+        {
+            array<string> manifests = new array<string>();
+            FileIO.FindFiles(manifests, directory + "*" + MANIFEST_EXTENSION);
+            
+            foreach (string manifestPath : manifests)
+            {
+                STS_BackupManifest manifest = STS_BackupManifest.Load(manifestPath);
+                if (!manifest)
+                {
+                    // Keep everything while a manifest cannot be read rather than risk deleting its chunks
+                    if (m_Logger)
+                        m_Logger.LogWarning(string.Format("Skipping garbage collection - unreadable manifest %1", manifestPath),
+                            "STS_ChunkStore", "CollectGarbage");
+                    return 0;
+                }
+                
+                foreach (STS_BackupManifestFile entry : manifest.m_aFiles)
+                {
+                    foreach (string chunk : entry.m_aChunks)
+                    {
+                        live.Insert(chunk);
+                    }
+                }
+            }
+        }
+        
+        array<string> chunkFiles = new array<string>();
+        FileIO.FindFiles(chunkFiles, m_sChunkDirectory + "*" + CHUNK_EXTENSION);
+        
+        int deleted = 0;
+        foreach (string chunkFile : chunkFiles)
+        {
+            int nameStart = chunkFile.LastIndexOf("/") + 1;
+            string key = chunkFile.Substring(nameStart, chunkFile.Length() - nameStart - CHUNK_EXTENSION.Length());
+            
+            if (live.Contains(key))
+                continue;
+            
+            if (FileIO.DeleteFile(GetChunkPath(key)))
+            {
+                m_KnownChunks.RemoveItem(key);
+                deleted++;
+            }
+        }
+        
+        if (m_Logger && deleted > 0)
+            m_Logger.LogInfo(string.Format("Deleted %1 unreferenced backup chunks", deleted), "STS_ChunkStore", "CollectGarbage");
+        
+        return deleted;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool HasChunk(string key)
+    {
+        return m_KnownChunks.Contains(key) || FileIO.FileExists(GetChunkPath(key));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Re-read a chunk and check that its content still hashes to its key
+    bool VerifyChunk(string key)
+    {
+        array<int> bytes = new array<int>();
+        bool legacy;
+        if (!ReadChunk(key, bytes, legacy))
+            return false;
+        
+        if (!legacy)
+            return ComputeChunkKey(bytes) == key;
+        
+        // Line-based chunks were keyed by their lines
+        array<string> lines = new array<string>();
+        if (!ReadLegacyChunk(key, lines))
+            return false;
+        
+        int byteCount = 0;
+        foreach (string line : lines)
+        {
+            byteCount += line.Length() + 1;
+        }
+        
+        return ComputeLegacyChunkKey(lines, byteCount) == key;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Copy the chunks a manifest lists into another chunk directory, skipping those already there, so the
+    // manifest can be restored from that directory alone. False if a chunk is missing or cannot be copied.
+    bool ExportChunks(STS_BackupManifest manifest, string targetChunkDirectory)
+    {
+        if (!FileIO.FileExists(targetChunkDirectory))
+            FileIO.MakeDirectory(targetChunkDirectory);
+        
+        foreach (STS_BackupManifestFile entry : manifest.m_aFiles)
+        {
+            foreach (string chunk : entry.m_aChunks)
+            {
+                string targetPath = targetChunkDirectory + chunk + CHUNK_EXTENSION;
+                if (FileIO.FileExists(targetPath))
+                    continue;
+                
+                if (!HasChunk(chunk) || !FileIO.CopyFile(GetChunkPath(chunk), targetPath))
+                {
+                    if (m_Logger)
+                        m_Logger.LogWarning(string.Format("Cannot export backup chunk %1 to %2", chunk, targetChunkDirectory),
+                            "STS_ChunkStore", "ExportChunks");
+                    return false;
+                }
+            }
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Every file below directory, subdirectories included
+    protected void CollectFiles(string directory, notnull array<string> files)
+    {
+        array<string> pending = {directory};
+        
+        m_aFoundFiles = files;
+        m_aFoundDirectories = pending;
+        
+        while (!pending.IsEmpty())
+        {
+            string current = pending[pending.Count() - 1];
+            pending.Remove(pending.Count() - 1);
+            
+            FileIO.FindFiles(OnFileFound, current, string.Empty);
+        }
+        
+        m_aFoundFiles = null;
+        m_aFoundDirectories = null;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void OnFileFound(string fileName, FileAttribute attributes = 0, string filesystem = string.Empty)
+    {
+        if (attributes & FileAttribute.DIRECTORY)
+            m_aFoundDirectories.Insert(fileName);
+        else
+            m_aFoundFiles.Insert(fileName);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Create the directories a relative path needs below targetDirectory
+    protected void MakeParentDirectories(string targetDirectory, string relativePath)
+    {
+        array<string> pathParts = new array<string>();
+        relativePath.Split("/", pathParts, true);
+        
+        string currentPath = targetDirectory;
+        for (int i = 0; i < pathParts.Count() - 1; i++)
+        {
+            currentPath += "/" + pathParts[i];
+            if (!FileIO.FileExists(currentPath))
+                FileIO.MakeDirectory(currentPath);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Split a file into chunks and store the ones not already present
+    protected STS_BackupManifestFile StoreFile(string path, STS_BackupManifest manifest)
+    {
+        FileHandle file = FileIO.OpenFile(path, FileMode.READ);
+        if (!file)
+            return null;
+        
+        STS_BackupManifestFile entry = new STS_BackupManifestFile();
+        array<int> bytes = new array<int>();
+        int window = 0;
+        
+        int length = file.GetLength();
+        int position = 0;
+        while (position < length)
+        {
+            int count = Math.Min(4, length - position);
+            int word = 0;
+            if (file.Read(word, count) != count)
+            {
+                file.Close();
+                return null;
+            }
+            
+            position += count;
+            
+            for (int i = 0; i < count; i++)
+            {
+                int value = (word >> (i * 8)) & 0xFF;
+                bytes.Insert(value);
+                window = (window << 8) | value;
+                
+                if (bytes.Count() >= MAX_CHUNK_BYTES || (bytes.Count() >= MIN_CHUNK_BYTES && (((window * 0x5bd1e995) >> 12) & BOUNDARY_MASK) == 0))
+                {
+                    if (!StoreChunk(bytes, entry, manifest))
+                    {
+                        file.Close();
+                        return null;
+                    }
+                    
+                    bytes.Clear();
+                }
+            }
+        }
+        
+        file.Close();
+        
+        if (!bytes.IsEmpty() && !StoreChunk(bytes, entry, manifest))
+            return null;
+        
+        return entry;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected bool StoreChunk(array<int> bytes, STS_BackupManifestFile entry, STS_BackupManifest manifest)
+    {
+        int byteCount = bytes.Count();
+        string key = ComputeChunkKey(bytes);
+        entry.m_aChunks.Insert(key);
+        entry.m_iByteCount += byteCount;
+        manifest.m_iBytesTotal += byteCount;
+        
+        if (m_KnownChunks.Contains(key) || FileIO.FileExists(GetChunkPath(key)))
+        {
+            m_KnownChunks.Insert(key);
+            manifest.m_iReusedChunks++;
+            return true;
+        }
+        
+        // Written under a temporary name so an interrupted write never leaves a chunk with the wrong content
+        string tempPath = GetChunkPath(key) + ".tmp";
+        FileHandle file = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!file)
+            return false;
+        
+        string frame;
+        if (bytes.Find(0) == -1)
+            frame = STS_LZCodec.Compress(BytesToString(bytes));
+        
+        int written;
+        if (!frame.IsEmpty() && frame.Length() < byteCount)
+        {
+            file.Write(CHUNK_MAGIC + MODE_COMPRESSED);
+            file.Write(frame);
+            written = frame.Length() + 4;
+        }
+        else
+        {
+            file.Write(CHUNK_MAGIC + MODE_RAW);
+            WriteBytes(file, bytes);
+            written = byteCount + 4;
+        }
+        
+        file.Close();
+        
+        if (!FileIO.CopyFile(tempPath, GetChunkPath(key)))
+            return false;
+        
+        FileIO.DeleteFile(tempPath);
+        
+        m_KnownChunks.Insert(key);
+        manifest.m_iNewChunks++;
+        manifest.m_iBytesWritten += written;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected bool RestoreFile(STS_BackupManifestFile entry, string targetPath)
+    {
+        string tempPath = targetPath + ".tmp";
+        FileHandle target = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!target)
+            return false;
+        
+        array<int> bytes = new array<int>();
+        bool legacy;
+        foreach (string chunk : entry.m_aChunks)
+        {
+            if (!ReadChunk(chunk, bytes, legacy))
+            {
+                target.Close();
+                FileIO.DeleteFile(tempPath);
+                return false;
+            }
+            
+            WriteBytes(target, bytes);
+        }
+        
+        target.Close();
+        
+        if (!FileIO.CopyFile(tempPath, targetPath))
+            return false;
+        
+        FileIO.DeleteFile(tempPath);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read the bytes of a chunk; false if it is missing or its content is corrupt. legacy is set for
+    // line-based chunks from earlier versions.
+    protected bool ReadChunk(string key, notnull array<int> bytes, out bool legacy)
+    {
+        bytes.Clear();
+        legacy = false;
+        
+        FileHandle file = FileIO.OpenFile(GetChunkPath(key), FileMode.READ);
+        if (!file)
+            return false;
+        
+        int length = file.GetLength();
+        int header = 0;
+        if (length >= 4)
+            file.Read(header, 4);
+        
+        if (header == GetChunkHeader(MODE_COMPRESSED))
+        {
+            // The frame never contains a newline, so it is read as one line
+            string frame;
+            file.ReadLine(frame);
+            file.Close();
+            
+            string content;
+            if (!STS_LZCodec.Decompress(frame, content))
+                return false;
+            
+            bytes.Resize(content.Length());
+            for (int i = 0; i < content.Length(); i++)
+            {
+                bytes[i] = content.Get(i).ToAscii() & 0xFF;
+            }
+            
+            return true;
+        }
+        
+        if (header == GetChunkHeader(MODE_RAW))
+        {
+            bool complete = ReadBytes(file, length - 4, bytes);
+            file.Close();
+            return complete;
+        }
+        
+        file.Close();
+        legacy = true;
+        
+        array<string> lines = new array<string>();
+        if (!ReadLegacyChunk(key, lines))
+            return false;
+        
+        foreach (string line : lines)
+        {
+            for (int j = 0; j < line.Length(); j++)
+            {
+                bytes.Insert(line.Get(j).ToAscii() & 0xFF);
+            }
+            
+            bytes.Insert(10);
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read the lines of a chunk written by the line-based versions; it holds either an STS_LZCodec frame
+    // or, from before compression was added, the plain lines
+    protected bool ReadLegacyChunk(string key, notnull array<string> lines)
+    {
+        lines.Clear();
+        
+        FileHandle file = FileIO.OpenFile(GetChunkPath(key), FileMode.READ);
+        if (!file)
+            return false;
+        
+        string line;
+        while (file.ReadLine(line) >= 0)
+        {
+            lines.Insert(line);
+        }
+        file.Close();
+        
+        if (lines.Count() != 1 || !STS_LZCodec.IsFramed(lines[0]))
+            return true;
+        
+        string content;
+        if (!STS_LZCodec.Decompress(lines[0], content))
+            return false;
+        
+        lines.Clear();
+        int start = 0;
+        while (start < content.Length())
+        {
+            int end = content.IndexOfFrom(start, "\n");
+            if (end == -1)
+                end = content.Length();
+            
+            lines.Insert(content.Substring(start, end - start));
+            start = end + 1;
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static bool ReadBytes(FileHandle file, int count, notnull array<int> bytes)
+    {
+        int position = 0;
+        while (position < count)
+        {
+            int wordBytes = Math.Min(4, count - position);
+            int word = 0;
+            if (file.Read(word, wordBytes) != wordBytes)
+                return false;
+            
+            for (int i = 0; i < wordBytes; i++)
+            {
+                bytes.Insert((word >> (i * 8)) & 0xFF);
+            }
+            
+            position += wordBytes;
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write bytes four at a time; the last word only writes the bytes that are left
+    protected static void WriteBytes(FileHandle file, array<int> bytes)
+    {
+        int count = bytes.Count();
+        for (int position = 0; position < count; position += 4)
+        {
+            int wordBytes = Math.Min(4, count - position);
+            int word = 0;
+            for (int i = 0; i < wordBytes; i++)
+            {
+                word = word | (bytes[position + i] << (i * 8));
+            }
+            
+            file.Write(word, wordBytes);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Strings are built in short runs that are joined once, so a chunk does not cost a copy per byte
+    protected static string BytesToString(array<int> bytes)
+    {
+        array<string> pieces = new array<string>();
+        string run = "";
+        foreach (int value : bytes)
+        {
+            run += string.FromAscii(value);
+            if (run.Length() >= STRING_RUN_LENGTH)
+            {
+                pieces.Insert(run);
+                run = "";
+            }
+        }
+        
+        pieces.Insert(run);
+        return STS_LZCodec.JoinPieces(pieces);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // The first four bytes of a chunk file as the little-endian word Read returns
+    protected static int GetChunkHeader(string mode)
+    {
+        string header = CHUNK_MAGIC + mode;
+        int word = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            word = word | ((header.Get(i).ToAscii() & 0xFF) << (i * 8));
+        }
+        
+        return word;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Two 32-bit hashes with different mixing plus the length, so a collision needs all three to match
+    protected string ComputeChunkKey(array<int> bytes)
+    {
+        int hashA = 0;
+        int hashB = 0x5bd1e995;
+        
+        foreach (int value : bytes)
+        {
+            hashA = hashA * 31 + value;
+            hashB = (hashB ^ value) * 0x01000193;
+        }
+        
+        return ToHex(hashA) + ToHex(hashB) + "-" + bytes.Count().ToString();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Key of a line-based chunk: two 32-bit hashes over differently salted lines plus the length
+    protected string ComputeLegacyChunkKey(array<string> lines, int byteCount)
+    {
+        int hashA = 0;
+        int hashB = 0x5bd1e995;
+        
+        foreach (string line : lines)
+        {
+            hashA = hashA * 31 + line.Hash();
+            hashB = (hashB ^ ("#" + line).Hash()) * 0x01000193;
+        }
+        
+        return ToHex(hashA) + ToHex(hashB) + "-" + byteCount.ToString();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    static string ToHex(int value)
+    {
+        string digits = "0123456789abcdef";
+        string result = "";
+        
+        for (int shift = 28; shift >= 0; shift -= 4)
+        {
+            result += digits.Get((value >> shift) & 0x0F);
+        }
+        
+        return result;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GetChunkPath(string key)
+    {
+        return m_sChunkDirectory + key + CHUNK_EXTENSION;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GetRelativePath(string sourceDirectory, string path)
+    {
+        int start = sourceDirectory.Length();
+        if (path.Get(start) == "/")
+            start++;
+        
+        return path.Substring(start, path.Length() - start);
+    }
+}
@@ -44,16 +44,24 @@ class STS_PendingDatabaseOperation
     int m_iPriority;                           // Operation priority (higher values = higher priority)
     int m_iAttempts;                           // Number of attempts made
     float m_fLastAttemptTime;                  // Time of last attempt
+    float m_fNextAttemptTime;                  // Not retried before this time (ms); grows with each failed attempt
     string m_sError;                           // Last error message
+    string m_sTargetKey;                       // Operations on the same target coalesce in the pending queue
+    float m_fEnqueueTime;                      // Time the target was first queued (ms)
+    int m_iSequence;                           // Tie-breaker for operations queued in the same millisecond
+    int m_iHeapIndex = -1;                     // Position in STS_PendingOperationQueue
 
-    void STS_PendingDatabaseOperation(string operationType, map<string, string> parameters, int priority = 1)
+    void STS_PendingDatabaseOperation(string operationType = "", map<string, string> parameters = null, int priority = 1, string targetKey = "")
     {
         m_sOperationType = operationType;
         m_mParameters = parameters;
         m_iPriority = priority;
         m_iAttempts = 0;
         m_fLastAttemptTime = 0;
+        m_fNextAttemptTime = 0;
         m_sError = "";
+        m_sTargetKey = targetKey;
+        m_fEnqueueTime = 0;
     }
 }
 
@@ -102,8 +110,6 @@ class STS_DatabaseManager
     protected int m_iConsecutiveFailures = 0;
     protected bool m_bDataCorruptionDetected = false;
     protected float m_fLastOperationTime = 0;      // Time of last operation
-    protected int m_iOperationsInLastSecond = 0;   // Operations in the last second (rate limiting)
-    protected float m_fOperationRateLimitStartTime = 0; // Start time for rate limit window
     protected bool m_bReconnecting = false;        // Flag for reconnection in progress
     protected int m_iLastOperationTime = 0;        // Time of last operation (for timeout detection)
     protected int m_iSchemaVersion = 1;            // Current schema version
@@ -111,8 +117,21 @@ class STS_DatabaseManager
     // Logging
     protected STS_LoggingSystem m_Logger;
     
-    // Critical operation queue for retrying important operations
-    protected ref array<ref STS_PendingDatabaseOperation> m_aPendingOperations = new array<ref STS_PendingDatabaseOperation>();
+    // Critical operation queue for retrying important operations, ordered by priority and coalesced per target
+    protected ref STS_PendingOperationQueue m_PendingOperations = new STS_PendingOperationQueue();
+    protected const int MAX_PENDING_OPERATIONS_PER_TICK = 100;
+    
+    // Failed pending operations wait this long before their next attempt, doubling per failure up to the cap
+    protected const int PENDING_RETRY_BASE_DELAY_MS = 5000;
+    protected const int PENDING_RETRY_MAX_DELAY_MS = 300000;
+    
+    // Token-bucket admission control shared by every repository caller; m_fOperationRateLimit is its base rate
+    protected STS_AdmissionController m_AdmissionController;
+    
+    // Deduplicated backup storage; every backup is a manifest, chunks are shared between backups
+    protected ref STS_ChunkStore m_BackupChunkStore;
+    protected const string BACKUP_CHUNK_DIRECTORY = "Chunks/";
+    protected const string SCHEDULED_BACKUP_DIRECTORY = "Scheduled/";
     
     // Enhanced error tracking
     protected ref map<STS_DatabaseError, int> m_mErrorCounts = new map<STS_DatabaseError, int>();
@@ -130,6 +149,11 @@ class STS_DatabaseManager
     protected int m_iRecoveryAttempts = 0;
     protected float m_fLastRecoveryAttempt = 0;
     
+    // Legacy JSON record migration (binary backend only)
+    protected const int LEGACY_MIGRATION_INTERVAL = 2000;   // ms between batches
+    protected const int LEGACY_MIGRATION_BATCH_SIZE = 100;
+    protected int m_iLegacyRecordsMigrated = 0;
+    
     //------------------------------------------------------------------------------------------------
     protected void STS_DatabaseManager()
     {
@@ -175,12 +199,17 @@ class STS_DatabaseManager
             }
         }
         
+        m_BackupChunkStore = new STS_ChunkStore(m_sBackupDirectory + BACKUP_CHUNK_DIRECTORY);
+        m_BackupChunkStore.AddManifestDirectory(m_sBackupDirectory + SCHEDULED_BACKUP_DIRECTORY);
+        
         // Set up health check timer
         GetGame().GetCallqueue().CallLater(PerformHealthCheck, m_iHealthCheckIntervalMs, true);
         
         // Initialize rate limiting
-        m_fOperationRateLimitStartTime = GetCurrentTimeMs();
-        m_iOperationsInLastSecond = 0;
+        m_AdmissionController = STS_AdmissionController.GetInstance();
+        m_AdmissionController.SetBaseRate(m_fOperationRateLimit);
+        
+        m_PendingOperations.SetMaxSize(m_iMaxPendingOperations);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -401,6 +430,10 @@ class STS_DatabaseManager
             // Set up recovery monitoring
             GetGame().GetCallqueue().CallLater(CheckRecovery, RECOVERY_CHECK_INTERVAL, true);
             
+            // Rewrite legacy JSON player records in the background
+            if (m_eDatabaseType == STS_DatabaseType.BINARY_FILE)
+                GetGame().GetCallqueue().CallLater(MigrateLegacyPlayerStats, LEGACY_MIGRATION_INTERVAL, true);
+            
             // Initialize error tracking
             InitializeErrorTracking();
             
@@ -832,6 +865,36 @@ class STS_DatabaseManager
         return "$profile:StatTracker/Database/" + m_sDatabaseName;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Migrate one batch of legacy JSON player records; stops the timer once none are left
+    protected void MigrateLegacyPlayerStats()
+    {
+        if (!m_bInitialized || !m_PlayerStatsRepository)
+            return;
+        
+        // Background work yields first when the database or the frame budget is under pressure
+        int batchSize = m_AdmissionController.AcquireUpTo(LEGACY_MIGRATION_BATCH_SIZE);
+        if (batchSize <= 0)
+            return;
+        
+        int migrated = m_PlayerStatsRepository.MigrateLegacyRecords(batchSize);
+        if (migrated > 0)
+        {
+            m_iLegacyRecordsMigrated += migrated;
+            LogDebug(string.Format("Migrated %1 legacy player records to the binary layout", migrated), "MigrateLegacyPlayerStats");
+            return;
+        }
+        
+        // Failures are retried on the next tick
+        if (migrated < 0)
+            return;
+        
+        GetGame().GetCallqueue().Remove(MigrateLegacyPlayerStats);
+        
+        if (m_iLegacyRecordsMigrated > 0)
+            LogInfo(string.Format("Legacy player record migration complete: %1 records converted", m_iLegacyRecordsMigrated), "MigrateLegacyPlayerStats");
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Initialize all repositories
     protected bool InitializeRepositories()
@@ -846,6 +909,9 @@ class STS_DatabaseManager
             
             LogDebug("Initializing repositories...", "InitializeRepositories");
             
+            // The binary backend stores complex player stats in the packed layout instead of nested JSON
+            STS_PlayerStatsEntity.SetBinaryEncoding(m_eDatabaseType == STS_DatabaseType.BINARY_FILE);
+            
             // Initialize player stats repository
             m_PlayerStatsRepository = new STS_PlayerStatsRepository(m_DbContext);
             if (!m_PlayerStatsRepository)
@@ -1152,6 +1218,11 @@ class STS_DatabaseManager
             string currentName = m_sDatabaseName;
             string currentConnection = m_sConnectionString;
             
+            // Keep the player UID -> entity ID cache so known players stay lookup-free after recovery
+            map<string, ref STS_PlayerStatsEntityRef> entityRefs = null;
+            if (m_PlayerStatsRepository)
+                entityRefs = m_PlayerStatsRepository.GetEntityRefCache();
+            
             // Shutdown current connection
             Shutdown();
             
@@ -1168,6 +1239,10 @@ class STS_DatabaseManager
             if (result)
             {
                 LogInfo("Database connection recovery successful", "AttemptConnectionRecovery");
+                
+                // The new repository validates the carried-over IDs against the database
+                if (m_PlayerStatsRepository && entityRefs)
+                    m_PlayerStatsRepository.AdoptEntityRefCache(entityRefs);
             }
             else
             {
@@ -1184,6 +1259,13 @@ class STS_DatabaseManager
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Reconnect to the database using the current configuration
+    bool Reconnect()
+    {
+        return AttemptConnectionRecovery();
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Set error state
     protected void SetError(STS_DatabaseError error, string message, string stackTrace = "")
@@ -1394,25 +1476,24 @@ class STS_DatabaseManager
                 return false;
             }
             
-            // Generate timestamp for backup
-            int timestamp = System.GetTickCount() / 1000;
-            string backupName = string.Format("%1_%2", m_sDatabaseName, timestamp);
-            string backupPath = m_sBackupDirectory + backupName;
+            // Generate timestamp for backup; zero-padded so manifest names sort by age
+            int timestamp = System.GetUnixTime();
+            string backupName = string.Format("%1_%2.manifest", m_sDatabaseName, timestamp.ToString().PadLeft(10, "0"));
+            string backupDirectory = m_sBackupDirectory + SCHEDULED_BACKUP_DIRECTORY;
+            string backupPath = backupDirectory + backupName;
             
             // Create backup directory if it doesn't exist
-            if (!FileIO.FileExists(m_sBackupDirectory))
+            if (!FileIO.FileExists(backupDirectory))
             {
-                if (!FileIO.MakeDirectory(m_sBackupDirectory))
+                if (!FileIO.MakeDirectory(backupDirectory))
                 {
-                    LogError(string.Format("Failed to create backup directory: %1", m_sBackupDirectory), "CreateBackup");
+                    LogError(string.Format("Failed to create backup directory: %1", backupDirectory), "CreateBackup");
                     return false;
                 }
             }
             
-            // Copy database files to backup location
-            // In a real implementation, we'd use proper file operations for directory copying
-            // This is simplified for demonstration
-            bool success = CopyDirectory(sourcePath, backupPath);
+            // Only chunks that changed since earlier backups are written
+            bool success = BackupDatabase(backupPath);
             
             if (success)
             {
@@ -1439,25 +1520,26 @@ class STS_DatabaseManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Remove old backup files to save disk space
+    // Remove old backup manifests and the chunks no remaining backup refers to
     protected void CleanupOldBackups()
     {
         try
         {
-            // Get all backup directories
-            TStringArray backupDirs = new TStringArray();
-            FindDirContent(m_sBackupDirectory, backupDirs);
+            string backupDirectory = m_sBackupDirectory + SCHEDULED_BACKUP_DIRECTORY;
+            array<string> manifests = new array<string>();
+            FileIO.FindFiles(manifests, backupDirectory + m_sDatabaseName + "_*.manifest");
             
-            // Sort by timestamp (assuming naming convention includes timestamp)
-            backupDirs.Sort(false); // Sort descending to have newest first
+            // Names carry a zero-padded timestamp; sort descending to have newest first
+            manifests.Sort(true);
             
             // Keep only the most recent backups
-            for (int i = m_iMaxBackups; i < backupDirs.Count(); i++)
+            for (int i = m_iMaxBackups; i < manifests.Count(); i++)
             {
-                string oldBackupPath = m_sBackupDirectory + backupDirs[i];
-                DeleteDirectory(oldBackupPath);
-                LogInfo(string.Format("Removed old database backup: %1", oldBackupPath), "CleanupOldBackups");
+                FileIO.DeleteFile(manifests[i]);
+                LogInfo(string.Format("Removed old database backup: %1", manifests[i]), "CleanupOldBackups");
             }
+            
+            m_BackupChunkStore.CollectGarbage();
         }
         catch (Exception e)
         {
@@ -1466,8 +1548,55 @@ class STS_DatabaseManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Add a pending operation to the queue
-    bool AddPendingOperation(string operationType, map<string, string> parameters, int priority = 1)
+    // Back up the file database into a manifest at manifestPath
+    bool BackupDatabase(string manifestPath)
+    {
+        if (!IsFileDatabaseType(m_eDatabaseType))
+            return false;
+        
+        return m_BackupChunkStore.CreateBackup(GetFileDatabasePath(), manifestPath) != null;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Every backup manifest is complete on its own and shares unchanged chunks with earlier backups,
+    // so a differential backup is stored like a full one
+    bool CreateDifferentialBackup(string manifestPath, string baseManifestPath)
+    {
+        return BackupDatabase(manifestPath);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Restore the file database from a backup manifest
+    bool RestoreDatabase(string manifestPath)
+    {
+        if (!IsFileDatabaseType(m_eDatabaseType))
+            return false;
+        
+        bool success = m_BackupChunkStore.Restore(manifestPath, GetFileDatabasePath());
+        if (success)
+            LogInfo(string.Format("Database restored from %1", manifestPath), "RestoreDatabase");
+        else
+            LogError(string.Format("Failed to restore database from %1", manifestPath), "RestoreDatabase");
+        
+        return success;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool RestoreDifferentialBackup(string manifestPath)
+    {
+        return RestoreDatabase(manifestPath);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    STS_ChunkStore GetBackupChunkStore()
+    {
+        return m_BackupChunkStore;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Add a pending operation to the queue. Operations on the same target (by default the "playerUID"
+    // parameter) replace each other, so the backlog grows with distinct players rather than events.
+    bool AddPendingOperation(string operationType, map<string, string> parameters, int priority = 1, string targetKey = "")
     {
         try
         {
@@ -1478,18 +1607,25 @@ class STS_DatabaseManager
                 return false;
             }
             
+            if (!parameters)
+                parameters = new map<string, string>();
+            
+            if (targetKey.IsEmpty() && parameters.Contains("playerUID"))
+                targetKey = "player:" + parameters.Get("playerUID");
+            
             // Create the operation
-            STS_PendingDatabaseOperation operation = new STS_PendingDatabaseOperation();
-            operation.m_sOperationType = operationType;
-            operation.m_mParameters = parameters;
-            operation.m_iPriority = priority;
-            operation.m_iTimestamp = System.GetTickCount() / 1000;
+            STS_PendingDatabaseOperation operation = new STS_PendingDatabaseOperation(operationType, parameters, priority, targetKey);
             
             // Add to queue
-            m_aPendingOperations.Insert(operation);
+            if (!m_PendingOperations.Push(operation))
+            {
+                LogWarning(string.Format("Pending operation queue full (%1) - rejected %2 for %3", 
+                    m_iMaxPendingOperations, operationType, targetKey), "AddPendingOperation");
+                return false;
+            }
             
-            LogInfo(string.Format("Added pending operation: %1 (Priority: %2, Params: %3)", 
-                operationType, priority, parameters.Count()), "AddPendingOperation");
+            LogDebug(string.Format("Queued pending operation: %1 (Priority: %2, Target: %3, Depth: %4)", 
+                operationType, priority, targetKey, m_PendingOperations.Count()), "AddPendingOperation");
             
             return true;
         }
@@ -1502,62 +1638,120 @@ class STS_DatabaseManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Process pending operations
+    // Drop a queued save of this player, once a newer save has been stored, so the retry cannot overwrite it
+    void CancelPendingPlayerSave(string playerUID)
+    {
+        STS_PendingDatabaseOperation operation = m_PendingOperations.Get("player:" + playerUID);
+        if (operation && operation.m_sOperationType == "SavePlayerStats")
+            m_PendingOperations.Remove(operation);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Process pending operations in priority order. Failures go back on the queue and wait with exponential
+    // backoff; they are never dropped, since the queue holds only the latest payload per target.
     protected void ProcessPendingOperations()
     {
+        m_PendingOperations.SampleDepth();
+        
         if (!m_bInitialized || !m_DbContext)
             return;
             
         try
         {
-            if (m_aPendingOperations.Count() == 0)
+            if (m_PendingOperations.IsEmpty())
                 return;
                 
-            LogInfo(string.Format("Processing %1 pending database operations", m_aPendingOperations.Count()), 
-                "ProcessPendingOperations");
-                
-            // Sort operations by priority
-            m_aPendingOperations.Sort();
+            LogInfo(string.Format("Processing %1 pending database operations (oldest %2 s)", m_PendingOperations.Count(), 
+                m_PendingOperations.GetOldestAgeMs() / 1000), "ProcessPendingOperations");
+            
+            array<ref STS_PendingDatabaseOperation> failed = new array<ref STS_PendingDatabaseOperation>();
+            float now = GetCurrentTimeMs();
+            int executed = 0;
             
-            // Process high priority operations first
-            foreach (STS_PendingDatabaseOperation operation : m_aPendingOperations)
+            while (executed < MAX_PENDING_OPERATIONS_PER_TICK && !m_PendingOperations.IsEmpty())
             {
-                if (operation.m_iPriority >= 3) // High priority
+                STS_PendingDatabaseOperation operation = m_PendingOperations.Pop();
+                
+                // Still backing off: set aside without spending a token
+                if (operation.m_fNextAttemptTime > now)
                 {
-                    if (!ExecuteOperation(operation))
-                    {
-                        LogWarning("Failed to process high priority operation", "ProcessPendingOperations", {
-                            "operation_type": operation.m_sOperationType,
-                            "attempts": operation.m_iAttempts
-                        });
-                    }
+                    failed.Insert(operation);
+                    continue;
+                }
+                
+                // Out of tokens: the rest stays queued for the next tick
+                if (!m_AdmissionController.TryAcquire())
+                {
+                    failed.Insert(operation);
+                    break;
+                }
+                
+                executed++;
+                operation.m_iAttempts++;
+                operation.m_fLastAttemptTime = now;
+                
+                if (ExecuteOperation(operation))
+                    continue;
+                
+                int delayMs = Math.Min(PENDING_RETRY_BASE_DELAY_MS * Math.Pow(2, Math.Min(operation.m_iAttempts - 1, 6)), PENDING_RETRY_MAX_DELAY_MS);
+                operation.m_fNextAttemptTime = now + delayMs;
+                
+                if (operation.m_iAttempts == m_iMaxRetryAttempts)
+                {
+                    LogError("Pending operation keeps failing - still queued, retrying with backoff", "ProcessPendingOperations", {
+                        "operation_type": operation.m_sOperationType,
+                        "target": operation.m_sTargetKey,
+                        "attempts": operation.m_iAttempts,
+                        "retry_in_ms": delayMs
+                    });
+                }
+                else
+                {
+                    LogWarning("Failed to process operation", "ProcessPendingOperations", {
+                        "operation_type": operation.m_sOperationType,
+                        "attempts": operation.m_iAttempts,
+                        "retry_in_ms": delayMs
+                    });
                 }
+                failed.Insert(operation);
             }
             
-            // Process remaining operations
-            foreach (STS_PendingDatabaseOperation operation : m_aPendingOperations)
+            // Requeue after the loop so a failing operation is not retried within the same tick
+            foreach (STS_PendingDatabaseOperation operation : failed)
             {
-                if (operation.m_iPriority < 3)
-                {
-                    if (!ExecuteOperation(operation))
-                    {
-                        LogWarning("Failed to process operation", "ProcessPendingOperations", {
-                            "operation_type": operation.m_sOperationType,
-                            "attempts": operation.m_iAttempts
-                        });
-                    }
-                }
+                m_PendingOperations.Requeue(operation);
             }
         }
         catch (Exception e)
         {
             LogError("Exception processing pending operations", "ProcessPendingOperations", {
                 "error": e.ToString(),
-                "pending_operations": m_aPendingOperations.Count()
+                "pending_operations": m_PendingOperations.Count()
             });
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Current pending operation backlog
+    int GetPendingOperationCount()
+    {
+        return m_PendingOperations.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Pending queue depth samples and current age distribution (see STS_PendingOperationQueue for the buckets)
+    void GetPendingOperationHistograms(notnull array<int> depthHistogram, notnull array<int> ageHistogram)
+    {
+        m_PendingOperations.GetDepthHistogram(depthHistogram);
+        m_PendingOperations.GetAgeHistogram(ageHistogram);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    STS_AdmissionController GetAdmissionController()
+    {
+        return m_AdmissionController;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Execute a specific pending operation
     protected bool ExecuteOperation(STS_PendingDatabaseOperation operation)
@@ -1614,8 +1808,13 @@ class STS_DatabaseManager
                 return false;
             }
             
-            // Create stats object from JSON
-            STS_PlayerStats stats = new STS_PlayerStats();
+            // Create stats object from JSON; saves from the player components carry the enhanced fields
+            STS_PlayerStats stats;
+            if (statsJson.Contains("\"firstLogin\":"))
+                stats = new STS_EnhancedPlayerStats();
+            else
+                stats = new STS_PlayerStats();
+            
             if (!stats.FromJSON(statsJson))
             {
                 LogError(string.Format("Failed to parse stats JSON for player %1", playerUID), "ExecuteSavePlayerStats");
@@ -0,0 +1,196 @@
+// STS_KillHistoryRing.c
+// Fixed-capacity kill history. The newest kills are kept as full records in a ring buffer; kills that fall out
+// of it are folded into aggregate counters, so a player's stored history stays the same size however long they
+// have played.
+
+//------------------------------------------------------------------------------------------------
+// Aggregate of the kills that no longer fit in the ring
+class STS_KillHistoryRollup
+{
+    int m_iKills;
+    int m_iHeadshots;
+    float m_fTotalDistance;
+    float m_fLongestDistance;
+    int m_iFirstTimestamp;
+    int m_iLastTimestamp;
+    int m_iLastTimestampKills; // Rolled-up kills recorded in the same second as m_iLastTimestamp
+    
+    // Coverage boundary captured by BeginCoverage, so kills rolled up during a pass do not hide later ones
+    protected int m_iCoverTimestamp;
+    protected int m_iCoverRemaining;
+    protected bool m_bCoverAny;
+    
+    //------------------------------------------------------------------------------------------------
+    void Add(STS_KillRecord record)
+    {
+        if (!record)
+            return;
+        
+        if (m_iKills == 0 || record.m_iTimestamp < m_iFirstTimestamp)
+            m_iFirstTimestamp = record.m_iTimestamp;
+        
+        if (m_iKills == 0 || record.m_iTimestamp > m_iLastTimestamp)
+        {
+            m_iLastTimestamp = record.m_iTimestamp;
+            m_iLastTimestampKills = 1;
+        }
+        else if (record.m_iTimestamp == m_iLastTimestamp)
+        {
+            m_iLastTimestampKills++;
+        }
+        
+        m_iKills++;
+        if (record.m_bHeadshot)
+            m_iHeadshots++;
+        
+        m_fTotalDistance += record.m_fDistance;
+        m_fLongestDistance = Math.Max(m_fLongestDistance, record.m_fDistance);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Start a pass over a history, oldest first, that Covers is asked about record by record
+    void BeginCoverage()
+    {
+        m_bCoverAny = m_iKills > 0;
+        m_iCoverTimestamp = m_iLastTimestamp;
+        m_iCoverRemaining = m_iLastTimestampKills;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether a record is already counted: everything before the newest rolled-up second, and within that
+    // second only as many records as were rolled up from it, since timestamps only resolve to seconds
+    bool Covers(STS_KillRecord record)
+    {
+        if (!m_bCoverAny || record.m_iTimestamp > m_iCoverTimestamp)
+            return false;
+        
+        if (record.m_iTimestamp < m_iCoverTimestamp)
+            return true;
+        
+        if (m_iCoverRemaining <= 0)
+            return false;
+        
+        m_iCoverRemaining--;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    float GetAverageDistance()
+    {
+        if (m_iKills == 0)
+            return 0;
+        
+        return m_fTotalDistance / m_iKills;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Serialize to JSON
+    string ToJSON()
+    {
+        string json = "{";
+        json += "\"kills\":" + m_iKills.ToString() + ",";
+        json += "\"headshots\":" + m_iHeadshots.ToString() + ",";
+        json += "\"totalDistance\":" + m_fTotalDistance.ToString() + ",";
+        json += "\"longest\":" + m_fLongestDistance.ToString() + ",";
+        json += "\"first\":" + m_iFirstTimestamp.ToString() + ",";
+        json += "\"last\":" + m_iLastTimestamp.ToString() + ",";
+        json += "\"lastCount\":" + m_iLastTimestampKills.ToString();
+        json += "}";
+        return json;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Deserialize from JSON; missing fields stay zero
+    static STS_KillHistoryRollup FromJSON(string json)
+    {
+        STS_KillHistoryRollup rollup = new STS_KillHistoryRollup();
+        rollup.m_iKills = ReadNumber(json, "kills").ToInt();
+        rollup.m_iHeadshots = ReadNumber(json, "headshots").ToInt();
+        rollup.m_fTotalDistance = ReadNumber(json, "totalDistance").ToFloat();
+        rollup.m_fLongestDistance = ReadNumber(json, "longest").ToFloat();
+        rollup.m_iFirstTimestamp = ReadNumber(json, "first").ToInt();
+        rollup.m_iLastTimestamp = ReadNumber(json, "last").ToInt();
+        rollup.m_iLastTimestampKills = ReadNumber(json, "lastCount").ToInt();
+        
+        // Rollups written before the count existed hold at least one kill in their newest second
+        if (rollup.m_iKills > 0 && rollup.m_iLastTimestampKills <= 0)
+            rollup.m_iLastTimestampKills = 1;
+        
+        return rollup;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static string ReadNumber(string json, string key)
+    {
+        string pattern = "\"" + key + "\":";
+        int start = json.IndexOf(pattern);
+        if (start == -1)
+            return "0";
+        
+        start += pattern.Length();
+        int end = start;
+        while (end < json.Length() && json.Get(end) != "," && json.Get(end) != "}")
+        {
+            end++;
+        }
+        
+        return json.Substring(start, end - start);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Ring buffer of the most recent kill records, oldest first when read back
+class STS_KillHistoryRing
+{
+    protected ref array<ref STS_KillRecord> m_aSlots = new array<ref STS_KillRecord>();
+    protected int m_iCapacity;
+    protected int m_iHead = 0; // Slot of the oldest record
+    protected int m_iCount = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_KillHistoryRing(int capacity)
+    {
+        m_iCapacity = Math.Max(1, capacity);
+        m_aSlots.Resize(m_iCapacity);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Append a record; returns the oldest record if it had to make room, otherwise null
+    STS_KillRecord Push(STS_KillRecord record)
+    {
+        if (m_iCount < m_iCapacity)
+        {
+            m_aSlots[(m_iHead + m_iCount) % m_iCapacity] = record;
+            m_iCount++;
+            return null;
+        }
+        
+        STS_KillRecord evicted = m_aSlots[m_iHead];
+        m_aSlots[m_iHead] = record;
+        m_iHead = (m_iHead + 1) % m_iCapacity;
+        return evicted;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Copy the records into result, oldest first
+    void ToArray(notnull array<ref STS_KillRecord> result)
+    {
+        result.Clear();
+        for (int i = 0; i < m_iCount; i++)
+        {
+            result.Insert(m_aSlots[(m_iHead + i) % m_iCapacity]);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_iCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetCapacity()
+    {
+        return m_iCapacity;
+    }
+}
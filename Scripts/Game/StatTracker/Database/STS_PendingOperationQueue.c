@@ -0,0 +1,352 @@
+// STS_PendingOperationQueue.c
+// Priority queue for pending database operations. Operations are ordered by priority (highest first) and then
+// by enqueue time, and operations with the same target key coalesce so the backlog holds one entry per target.
+
+class STS_PendingOperationQueue
+{
+    // Binary heap; the best operation is at index 0
+    protected ref array<ref STS_PendingDatabaseOperation> m_aHeap = new array<ref STS_PendingDatabaseOperation>();
+    
+    // Queued operation per target key
+    protected ref map<string, STS_PendingDatabaseOperation> m_mByKey = new map<string, STS_PendingDatabaseOperation>();
+    
+    protected int m_iMaxSize;
+    protected int m_iNextSequence = 0;
+    
+    // Statistics
+    protected int m_iTotalEnqueued = 0;
+    protected int m_iTotalCoalesced = 0;
+    protected int m_iTotalRejected = 0;
+    protected int m_iPeakDepth = 0;
+    
+    // Depth sampled on each SampleDepth() call, bucketed by DEPTH_BUCKETS upper bounds
+    protected ref array<int> m_aDepthHistogram = {0, 0, 0, 0, 0, 0};
+    static const ref array<int> DEPTH_BUCKETS = {0, 10, 100, 1000, 10000};
+    static const ref array<int> AGE_BUCKETS_MS = {1000, 10000, 60000, 600000};
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PendingOperationQueue(int maxSize = 1000)
+    {
+        m_iMaxSize = Math.Max(1, maxSize);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queue an operation; one with the same target key replaces the queued operation's payload.
+    // Returns false if the queue is full and the operation is for a new target.
+    bool Push(STS_PendingDatabaseOperation operation)
+    {
+        if (!operation)
+            return false;
+        
+        if (!operation.m_sTargetKey.IsEmpty())
+        {
+            STS_PendingDatabaseOperation existing = m_mByKey.Get(operation.m_sTargetKey);
+            if (existing)
+            {
+                // The latest payload wins; the original enqueue time keeps its place and its age
+                existing.m_sOperationType = operation.m_sOperationType;
+                existing.m_mParameters = operation.m_mParameters;
+                existing.m_iAttempts = 0;
+                existing.m_sError = "";
+                
+                if (operation.m_iPriority > existing.m_iPriority)
+                {
+                    existing.m_iPriority = operation.m_iPriority;
+                    SiftUp(existing.m_iHeapIndex);
+                }
+                
+                m_iTotalCoalesced++;
+                return true;
+            }
+        }
+        
+        if (m_aHeap.Count() >= m_iMaxSize)
+        {
+            m_iTotalRejected++;
+            return false;
+        }
+        
+        if (operation.m_fEnqueueTime <= 0)
+            operation.m_fEnqueueTime = System.GetTickCount();
+        operation.m_iSequence = m_iNextSequence++;
+        
+        operation.m_iHeapIndex = m_aHeap.Count();
+        m_aHeap.Insert(operation);
+        SiftUp(operation.m_iHeapIndex);
+        
+        if (!operation.m_sTargetKey.IsEmpty())
+            m_mByKey.Set(operation.m_sTargetKey, operation);
+        
+        m_iTotalEnqueued++;
+        m_iPeakDepth = Math.Max(m_iPeakDepth, m_aHeap.Count());
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Put back an operation that failed. If a newer operation for the same target was queued meanwhile, its
+    // payload is kept and it only takes over the failed operation's place in line.
+    bool Requeue(STS_PendingDatabaseOperation operation)
+    {
+        if (!operation)
+            return false;
+        
+        STS_PendingDatabaseOperation existing;
+        if (!operation.m_sTargetKey.IsEmpty())
+            existing = m_mByKey.Get(operation.m_sTargetKey);
+        
+        if (!existing)
+            return Push(operation);
+        
+        bool moved = false;
+        if (operation.m_fEnqueueTime < existing.m_fEnqueueTime)
+        {
+            existing.m_fEnqueueTime = operation.m_fEnqueueTime;
+            moved = true;
+        }
+        
+        if (operation.m_iPriority > existing.m_iPriority)
+        {
+            existing.m_iPriority = operation.m_iPriority;
+            moved = true;
+        }
+        
+        if (moved)
+            SiftUp(existing.m_iHeapIndex);
+        
+        m_iTotalCoalesced++;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Remove and return the highest-priority, oldest operation
+    STS_PendingDatabaseOperation Pop()
+    {
+        if (m_aHeap.IsEmpty())
+            return null;
+        
+        STS_PendingDatabaseOperation top = m_aHeap[0];
+        int last = m_aHeap.Count() - 1;
+        
+        if (last > 0)
+        {
+            m_aHeap[0] = m_aHeap[last];
+            m_aHeap[0].m_iHeapIndex = 0;
+        }
+        m_aHeap.Remove(last);
+        
+        if (!m_aHeap.IsEmpty())
+            SiftDown(0);
+        
+        if (!top.m_sTargetKey.IsEmpty())
+            m_mByKey.Remove(top.m_sTargetKey);
+        
+        top.m_iHeapIndex = -1;
+        return top;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    STS_PendingDatabaseOperation Peek()
+    {
+        if (m_aHeap.IsEmpty())
+            return null;
+        
+        return m_aHeap[0];
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_aHeap.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsEmpty()
+    {
+        return m_aHeap.IsEmpty();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool ContainsKey(string targetKey)
+    {
+        return m_mByKey.Contains(targetKey);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queued operation for a target key, null if there is none
+    STS_PendingDatabaseOperation Get(string targetKey)
+    {
+        return m_mByKey.Get(targetKey);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Take a queued operation out of line; false if it is not queued
+    bool Remove(STS_PendingDatabaseOperation operation)
+    {
+        if (!operation)
+            return false;
+        
+        int index = operation.m_iHeapIndex;
+        if (index < 0 || index >= m_aHeap.Count() || m_aHeap[index] != operation)
+            return false;
+        
+        int last = m_aHeap.Count() - 1;
+        if (index != last)
+            Swap(index, last);
+        m_aHeap.Remove(last);
+        
+        // The operation moved into the gap may belong above or below it
+        if (index < m_aHeap.Count())
+        {
+            SiftDown(index);
+            SiftUp(index);
+        }
+        
+        if (!operation.m_sTargetKey.IsEmpty())
+            m_mByKey.Remove(operation.m_sTargetKey);
+        
+        operation.m_iHeapIndex = -1;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Clear()
+    {
+        m_aHeap.Clear();
+        m_mByKey.Clear();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Record the current depth in the depth histogram
+    void SampleDepth()
+    {
+        int bucket = GetBucket(m_aHeap.Count(), DEPTH_BUCKETS);
+        m_aDepthHistogram[bucket] = m_aDepthHistogram[bucket] + 1;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Depth samples per bucket: 0, 1-10, 11-100, 101-1000, 1001-10000, more
+    void GetDepthHistogram(notnull array<int> histogram)
+    {
+        histogram.Copy(m_aDepthHistogram);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queued operations per age bucket: <1s, <10s, <1min, <10min, older
+    void GetAgeHistogram(notnull array<int> histogram)
+    {
+        histogram.Clear();
+        for (int i = 0; i <= AGE_BUCKETS_MS.Count(); i++)
+        {
+            histogram.Insert(0);
+        }
+        
+        float now = System.GetTickCount();
+        foreach (STS_PendingDatabaseOperation operation : m_aHeap)
+        {
+            int bucket = GetBucket(now - operation.m_fEnqueueTime, AGE_BUCKETS_MS);
+            histogram[bucket] = histogram[bucket] + 1;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Age of the oldest queued operation in ms
+    float GetOldestAgeMs()
+    {
+        float oldest = 0;
+        float now = System.GetTickCount();
+        foreach (STS_PendingDatabaseOperation operation : m_aHeap)
+        {
+            oldest = Math.Max(oldest, now - operation.m_fEnqueueTime);
+        }
+        return oldest;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetMaxSize(int maxSize)
+    {
+        m_iMaxSize = Math.Max(1, maxSize);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get queue statistics
+    void GetStatistics(out int totalEnqueued, out int totalCoalesced, out int totalRejected, out int peakDepth)
+    {
+        totalEnqueued = m_iTotalEnqueued;
+        totalCoalesced = m_iTotalCoalesced;
+        totalRejected = m_iTotalRejected;
+        peakDepth = m_iPeakDepth;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Priority descending, then enqueue order
+    protected bool IsBefore(STS_PendingDatabaseOperation a, STS_PendingDatabaseOperation b)
+    {
+        if (a.m_iPriority != b.m_iPriority)
+            return a.m_iPriority > b.m_iPriority;
+        
+        if (a.m_fEnqueueTime != b.m_fEnqueueTime)
+            return a.m_fEnqueueTime < b.m_fEnqueueTime;
+        
+        return a.m_iSequence < b.m_iSequence;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void SiftUp(int index)
+    {
+        while (index > 0)
+        {
+            int parent = (index - 1) / 2;
+            if (!IsBefore(m_aHeap[index], m_aHeap[parent]))
+                return;
+            
+            Swap(index, parent);
+            index = parent;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void SiftDown(int index)
+    {
+        int count = m_aHeap.Count();
+        while (true)
+        {
+            int best = index;
+            int left = index * 2 + 1;
+            int right = left + 1;
+            
+            if (left < count && IsBefore(m_aHeap[left], m_aHeap[best]))
+                best = left;
+            if (right < count && IsBefore(m_aHeap[right], m_aHeap[best]))
+                best = right;
+            
+            if (best == index)
+                return;
+            
+            Swap(index, best);
+            index = best;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Swap(int a, int b)
+    {
+        STS_PendingDatabaseOperation temp = m_aHeap[a];
+        m_aHeap[a] = m_aHeap[b];
+        m_aHeap[b] = temp;
+        
+        m_aHeap[a].m_iHeapIndex = a;
+        m_aHeap[b].m_iHeapIndex = b;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Index of the first bucket whose upper bound is >= value, or the overflow bucket
+    protected static int GetBucket(float value, array<int> upperBounds)
+    {
+        for (int i = 0; i < upperBounds.Count(); i++)
+        {
+            if (value <= upperBounds[i])
+                return i;
+        }
+        return upperBounds.Count();
+    }
+}
@@ -0,0 +1,254 @@
+// STS_PlayerStatsCache.c
+// Size-bounded LRU cache of hydrated player stats with a time-to-live. Concurrent misses for the same UID are
+// coalesced so only the first one reaches the database and the rest are answered when its load completes.
+
+//------------------------------------------------------------------------------------------------
+class STS_PlayerStatsCacheEntry
+{
+    string m_sPlayerUID;
+    ref STS_PlayerStats m_Stats;
+    float m_fLoadedAt;
+    
+    // Recency list links; entries are owned by the cache map
+    STS_PlayerStatsCacheEntry m_Next;
+    STS_PlayerStatsCacheEntry m_Prev;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsCacheEntry(string playerUID, STS_PlayerStats stats, float loadedAt)
+    {
+        m_sPlayerUID = playerUID;
+        m_Stats = stats;
+        m_fLoadedAt = loadedAt;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_PlayerStatsCache
+{
+    // Entries by UID; the recency list runs from most (head) to least (tail) recently used
+    protected ref map<string, ref STS_PlayerStatsCacheEntry> m_mEntries = new map<string, ref STS_PlayerStatsCacheEntry>();
+    protected STS_PlayerStatsCacheEntry m_Head;
+    protected STS_PlayerStatsCacheEntry m_Tail;
+    
+    // Callbacks waiting on a load that is already in flight, by UID
+    protected ref map<string, ref array<func<STS_PlayerStats>>> m_mInFlight = new map<string, ref array<func<STS_PlayerStats>>>();
+    
+    // Configuration
+    protected int m_iCapacity;
+    protected float m_fTtlMs;
+    
+    // Statistics
+    protected int m_iHits = 0;
+    protected int m_iMisses = 0;
+    protected int m_iEvictions = 0;
+    protected int m_iExpirations = 0;
+    protected int m_iCoalescedLoads = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsCache(int capacity = 256, float ttlSeconds = 300)
+    {
+        m_iCapacity = Math.Max(1, capacity);
+        m_fTtlMs = ttlSeconds * 1000;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Cached stats for a player, or null on a miss or an expired entry
+    STS_PlayerStats Get(string playerUID)
+    {
+        STS_PlayerStatsCacheEntry entry = m_mEntries.Get(playerUID);
+        if (!entry)
+        {
+            m_iMisses++;
+            return null;
+        }
+        
+        if (System.GetTickCount() - entry.m_fLoadedAt > m_fTtlMs)
+        {
+            Remove(entry);
+            m_iExpirations++;
+            m_iMisses++;
+            return null;
+        }
+        
+        MoveToHead(entry);
+        m_iHits++;
+        return entry.m_Stats;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Insert or refresh a player's stats; the least recently used entry is evicted when full
+    void Put(string playerUID, STS_PlayerStats stats)
+    {
+        if (playerUID.IsEmpty() || !stats)
+            return;
+        
+        float now = System.GetTickCount();
+        
+        STS_PlayerStatsCacheEntry entry = m_mEntries.Get(playerUID);
+        if (entry)
+        {
+            entry.m_Stats = stats;
+            entry.m_fLoadedAt = now;
+            MoveToHead(entry);
+            return;
+        }
+        
+        while (m_mEntries.Count() >= m_iCapacity && m_Tail)
+        {
+            Remove(m_Tail);
+            m_iEvictions++;
+        }
+        
+        entry = new STS_PlayerStatsCacheEntry(playerUID, stats, now);
+        m_mEntries.Set(playerUID, entry);
+        LinkAtHead(entry);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether a live entry exists, without touching recency or the hit statistics
+    bool Contains(string playerUID)
+    {
+        STS_PlayerStatsCacheEntry entry = m_mEntries.Get(playerUID);
+        return entry && System.GetTickCount() - entry.m_fLoadedAt <= m_fTtlMs;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Invalidate(string playerUID)
+    {
+        STS_PlayerStatsCacheEntry entry = m_mEntries.Get(playerUID);
+        if (entry)
+            Remove(entry);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Clear()
+    {
+        m_Head = null;
+        m_Tail = null;
+        m_mEntries.Clear();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Register interest in a load. Returns true if the caller must start the load and later call CompleteLoad;
+    // false if a load is already in flight and the callback will be answered by it.
+    bool BeginLoad(string playerUID, func<STS_PlayerStats> callback)
+    {
+        array<func<STS_PlayerStats>> waiters = m_mInFlight.Get(playerUID);
+        if (waiters)
+        {
+            waiters.Insert(callback);
+            m_iCoalescedLoads++;
+            return false;
+        }
+        
+        waiters = new array<func<STS_PlayerStats>>();
+        waiters.Insert(callback);
+        m_mInFlight.Set(playerUID, waiters);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Finish an in-flight load: cache the result and answer every waiting callback. A save that was written
+    // through while the load was running is newer than the loaded stats and stays cached, but the callbacks
+    // get the loaded stats: the written object may be the caller's live stats, which must not be merged into
+    // themselves.
+    void CompleteLoad(string playerUID, STS_PlayerStats stats, bool cacheResult = true)
+    {
+        if (cacheResult && !m_mEntries.Contains(playerUID))
+            Put(playerUID, stats);
+        
+        // Detach first so a callback that loads the same player again starts a new load
+        array<func<STS_PlayerStats>> waiters = m_mInFlight.Get(playerUID);
+        m_mInFlight.Remove(playerUID);
+        if (!waiters)
+            return;
+        
+        foreach (func<STS_PlayerStats> callback : waiters)
+        {
+            if (callback)
+                callback(stats);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsLoading(string playerUID)
+    {
+        return m_mInFlight.Contains(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_mEntries.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    float GetHitRate()
+    {
+        int lookups = m_iHits + m_iMisses;
+        if (lookups == 0)
+            return 0;
+        
+        return m_iHits / (float)lookups;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get cache statistics
+    void GetStatistics(out int hits, out int misses, out int evictions, out int expirations, out int coalescedLoads)
+    {
+        hits = m_iHits;
+        misses = m_iMisses;
+        evictions = m_iEvictions;
+        expirations = m_iExpirations;
+        coalescedLoads = m_iCoalescedLoads;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void LinkAtHead(STS_PlayerStatsCacheEntry entry)
+    {
+        entry.m_Prev = null;
+        entry.m_Next = m_Head;
+        if (m_Head)
+            m_Head.m_Prev = entry;
+        
+        m_Head = entry;
+        if (!m_Tail)
+            m_Tail = entry;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Unlink(STS_PlayerStatsCacheEntry entry)
+    {
+        STS_PlayerStatsCacheEntry next = entry.m_Next;
+        
+        if (entry.m_Prev)
+            entry.m_Prev.m_Next = next;
+        else
+            m_Head = next;
+        
+        if (next)
+            next.m_Prev = entry.m_Prev;
+        else
+            m_Tail = entry.m_Prev;
+        
+        entry.m_Next = null;
+        entry.m_Prev = null;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void MoveToHead(STS_PlayerStatsCacheEntry entry)
+    {
+        if (entry == m_Head)
+            return;
+        
+        Unlink(entry);
+        LinkAtHead(entry);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Remove(STS_PlayerStatsCacheEntry entry)
+    {
+        Unlink(entry);
+        m_mEntries.Remove(entry.m_sPlayerUID);
+    }
+}
@@ -83,11 +83,38 @@ class STS_PlayerStatsEntity : EDF_DbEntity
     [EDF_DbProperty("KillHistory")]
     string m_sKillHistoryJson;
     
+    // Binary encoding of weapon kills, killed-by and kill history (see STS_PlayerStatsBinaryCodec).
+    // Version 0 means the record still uses the legacy JSON string fields above.
+    [EDF_DbProperty("PackedVersion")]
+    int m_iPackedVersion;
+    
+    [EDF_DbProperty("PackedLength")]
+    int m_iPackedLength;
+    
+    [EDF_DbProperty("PackedData")]
+    ref array<int> m_aPackedData;
+    
+    // Decoded complex data, filled on first access - not persisted
+    [NonSerialized()]
+    protected ref map<string, int> m_mWeaponKillsData;
+    [NonSerialized()]
+    protected ref map<string, int> m_mKilledByData;
+    [NonSerialized()]
+    protected ref array<ref STS_KillRecord> m_aKillHistoryData;
+    [NonSerialized()]
+    protected ref STS_KillHistoryRollup m_KillRollupData;
+    [NonSerialized()]
+    protected bool m_bComplexDataLoaded;
+    
+    // Write new records in the binary layout (enabled for the BINARY_FILE database type)
+    protected static bool s_bBinaryEncoding = false;
+    
     // Validation and sanitization
     protected ref STS_LoggingSystem m_Logger;
     static const int MAX_NAME_LENGTH = 64;
     static const int MAX_JSON_LENGTH = 10000;
     static const int MAX_IP_LENGTH = 45; // IPv6 length
+    static const int MAX_KILL_HISTORY = 100; // Older kills are rolled up into aggregate counters
     
     //------------------------------------------------------------------------------------------------
     void STS_PlayerStatsEntity()
@@ -161,6 +188,14 @@ class STS_PlayerStatsEntity : EDF_DbEntity
             sanitizedMap.Insert(sanitizedKey, weaponKills.Get(key));
         }
         
+        if (s_bBinaryEncoding)
+        {
+            EnsureComplexDataLoaded();
+            m_mWeaponKillsData = sanitizedMap;
+            PackComplexData();
+            return;
+        }
+        
         // Convert to JSON
         string json = SerializeMapToJson(sanitizedMap);
         
@@ -221,6 +256,14 @@ class STS_PlayerStatsEntity : EDF_DbEntity
             sanitizedMap.Insert(sanitizedKey, killedBy.Get(key));
         }
         
+        if (s_bBinaryEncoding)
+        {
+            EnsureComplexDataLoaded();
+            m_mKilledByData = sanitizedMap;
+            PackComplexData();
+            return;
+        }
+        
         // Convert to JSON
         string json = SerializeMapToJson(sanitizedMap);
         
@@ -266,14 +309,24 @@ class STS_PlayerStatsEntity : EDF_DbEntity
     }
     
     //------------------------------------------------------------------------------------------------
-    // Set kill history with validation
+    // Set kill history with validation. Only the newest MAX_KILL_HISTORY records are kept; older ones are
+    // folded into the kill rollup, and records the rollup already covers are ignored.
     void SetKillHistory(array<ref STS_KillRecord> killHistory)
     {
-        // Sanitize kill history
-        array<ref STS_KillRecord> sanitizedArray = new array<ref STS_KillRecord>();
+        if (s_bBinaryEncoding)
+            EnsureComplexDataLoaded();
+        else
+            EnsureKillRollupLoaded();
+        
+        // Sanitize kill history into the ring; records pushed out of it are rolled up
+        STS_KillHistoryRing ring = new STS_KillHistoryRing(MAX_KILL_HISTORY);
+        m_KillRollupData.BeginCoverage();
         
         foreach (STS_KillRecord record : killHistory)
         {
+            if (!record || m_KillRollupData.Covers(record))
+                continue;
+            
             // Create sanitized copy of record
             STS_KillRecord sanitizedRecord = new STS_KillRecord();
             sanitizedRecord.m_sKillerName = SanitizePlayerName(record.m_sKillerName);
@@ -282,41 +335,34 @@ class STS_PlayerStatsEntity : EDF_DbEntity
             sanitizedRecord.m_iTimestamp = record.m_iTimestamp;
             sanitizedRecord.m_fDistance = record.m_fDistance;
             sanitizedRecord.m_bHeadshot = record.m_bHeadshot;
+            sanitizedRecord.m_vPosition = record.m_vPosition;
             
-            sanitizedArray.Insert(sanitizedRecord);
+            m_KillRollupData.Add(ring.Push(sanitizedRecord));
         }
         
-        // Convert to JSON
-        string json = "";
+        array<ref STS_KillRecord> sanitizedArray = new array<ref STS_KillRecord>();
+        ring.ToArray(sanitizedArray);
         
-        // Serialize array
-        json = "{\"records\":[";
-        for (int i = 0; i < sanitizedArray.Count(); i++)
+        if (s_bBinaryEncoding)
         {
-            json += sanitizedArray[i].ToJSON();
-            if (i < sanitizedArray.Count() - 1)
-                json += ",";
+            m_aKillHistoryData = sanitizedArray;
+            PackComplexData();
+            return;
         }
-        json += "]}";
+        
+        // Convert to JSON
+        string json = SerializeKillHistoryJson(sanitizedArray);
         
         // Check JSON length
         if (json.Length() > MAX_JSON_LENGTH)
         {
-            // Truncate by taking only the most recent entries
+            // Truncate by rolling up the oldest entries
             while (json.Length() > MAX_JSON_LENGTH && sanitizedArray.Count() > 0)
             {
-                // Remove oldest record
+                m_KillRollupData.Add(sanitizedArray[0]);
                 sanitizedArray.RemoveOrdered(0);
                 
-                // Regenerate JSON
-                json = "{\"records\":[";
-                for (int i = 0; i < sanitizedArray.Count(); i++)
-                {
-                    json += sanitizedArray[i].ToJSON();
-                    if (i < sanitizedArray.Count() - 1)
-                        json += ",";
-                }
-                json += "]}";
+                json = SerializeKillHistoryJson(sanitizedArray);
             }
             
             if (m_Logger)
@@ -326,13 +372,33 @@ class STS_PlayerStatsEntity : EDF_DbEntity
         m_sKillHistoryJson = json;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Legacy kill history layout: {"records":[...],"rollup":{...}}
+    protected string SerializeKillHistoryJson(array<ref STS_KillRecord> records)
+    {
+        string json = "{\"records\":[";
+        for (int i = 0; i < records.Count(); i++)
+        {
+            json += records[i].ToJSON();
+            if (i < records.Count() - 1)
+                json += ",";
+        }
+        json += "],\"rollup\":" + m_KillRollupData.ToJSON() + "}";
+        return json;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get weapon kills as map
     map<string, int> GetWeaponKills()
     {
         map<string, int> result = new map<string, int>();
         
-        if (m_sWeaponKillsJson.Length() > 0)
+        if (m_iPackedVersion > 0)
+        {
+            EnsureComplexDataLoaded();
+            result.Copy(m_mWeaponKillsData);
+        }
+        else if (m_sWeaponKillsJson.Length() > 0)
         {
             DeserializeJsonToMap(m_sWeaponKillsJson, result);
         }
@@ -346,7 +412,12 @@ class STS_PlayerStatsEntity : EDF_DbEntity
     {
         map<string, int> result = new map<string, int>();
         
-        if (m_sKilledByJson.Length() > 0)
+        if (m_iPackedVersion > 0)
+        {
+            EnsureComplexDataLoaded();
+            result.Copy(m_mKilledByData);
+        }
+        else if (m_sKilledByJson.Length() > 0)
         {
             DeserializeJsonToMap(m_sKilledByJson, result);
         }
@@ -357,15 +428,69 @@ class STS_PlayerStatsEntity : EDF_DbEntity
     //------------------------------------------------------------------------------------------------
     // Get kill history as array
     array<ref STS_KillRecord> GetKillHistory()
+    {
+        if (m_iPackedVersion > 0)
+        {
+            EnsureComplexDataLoaded();
+            
+            array<ref STS_KillRecord> packedResults = new array<ref STS_KillRecord>();
+            foreach (STS_KillRecord record : m_aKillHistoryData)
+            {
+                packedResults.Insert(record);
+            }
+            return packedResults;
+        }
+        
+        return ParseKillHistoryJson(m_sKillHistoryJson);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Aggregate of the kills that no longer fit in the kill history
+    STS_KillHistoryRollup GetKillRollup()
+    {
+        EnsureKillRollupLoaded();
+        return m_KillRollupData;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load only the kill rollup; binary records decode everything at once
+    protected void EnsureKillRollupLoaded()
+    {
+        if (m_KillRollupData)
+            return;
+        
+        if (m_iPackedVersion > 0)
+        {
+            EnsureComplexDataLoaded();
+            return;
+        }
+        
+        m_KillRollupData = ParseKillRollupJson(m_sKillHistoryJson);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Parse the rollup that follows the records in the legacy kill history JSON string
+    protected STS_KillHistoryRollup ParseKillRollupJson(string recordsJson)
+    {
+        int rollupStart = recordsJson.IndexOf("\"rollup\":");
+        if (rollupStart == -1)
+            return new STS_KillHistoryRollup();
+        
+        rollupStart += 9; // Length of "rollup":
+        return STS_KillHistoryRollup.FromJSON(recordsJson.Substring(rollupStart, recordsJson.Length() - rollupStart));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Parse the legacy kill history JSON string
+    protected array<ref STS_KillRecord> ParseKillHistoryJson(string recordsJson)
     {
         array<ref STS_KillRecord> results = new array<ref STS_KillRecord>();
         
-        if (m_sKillHistoryJson.Length() == 0)
+        if (recordsJson.Length() == 0)
             return results;
             
         // Basic JSON parsing (in a real implementation, use a proper JSON parser)
         // Looking for pattern: {"records":[{...},{...}]}
-        string recordsJson = m_sKillHistoryJson;
         
         // Find the records array
         int recordsStart = recordsJson.IndexOf("[");
@@ -421,6 +546,86 @@ class STS_PlayerStatsEntity : EDF_DbEntity
         return results;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Enable or disable the binary layout for records written from now on
+    static void SetBinaryEncoding(bool enabled)
+    {
+        s_bBinaryEncoding = enabled;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    static bool IsBinaryEncoding()
+    {
+        return s_bBinaryEncoding;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Convert a legacy JSON record to the binary layout; returns false if it was already binary
+    bool MigrateToBinary()
+    {
+        if (m_iPackedVersion > 0)
+            return false;
+        
+        EnsureComplexDataLoaded();
+        PackComplexData();
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Decode the complex data once from whichever layout the record uses
+    protected void EnsureComplexDataLoaded()
+    {
+        if (m_bComplexDataLoaded)
+            return;
+        
+        m_bComplexDataLoaded = true;
+        
+        if (m_iPackedVersion > 0)
+        {
+            if (STS_PlayerStatsBinaryCodec.Decode(m_aPackedData, m_iPackedLength, m_mWeaponKillsData, m_mKilledByData, m_aKillHistoryData, m_KillRollupData))
+                return;
+            
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Corrupt packed stats (version %1, %2 bytes) for UID %3 - falling back to JSON fields", 
+                    m_iPackedVersion, m_iPackedLength, m_sPlayerUID), "STS_PlayerStatsEntity", "EnsureComplexDataLoaded");
+        }
+        
+        // Legacy layout: nested JSON strings
+        m_mWeaponKillsData = new map<string, int>();
+        m_mKilledByData = new map<string, int>();
+        
+        if (m_sWeaponKillsJson.Length() > 0)
+            DeserializeJsonToMap(m_sWeaponKillsJson, m_mWeaponKillsData);
+        
+        if (m_sKilledByJson.Length() > 0)
+            DeserializeJsonToMap(m_sKilledByJson, m_mKilledByData);
+        
+        m_aKillHistoryData = ParseKillHistoryJson(m_sKillHistoryJson);
+        
+        m_KillRollupData = ParseKillRollupJson(m_sKillHistoryJson);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Encode the decoded complex data into the binary fields and drop the legacy JSON copies
+    protected void PackComplexData()
+    {
+        // Legacy records may hold more history than the ring keeps
+        while (m_aKillHistoryData.Count() > MAX_KILL_HISTORY)
+        {
+            m_KillRollupData.Add(m_aKillHistoryData[0]);
+            m_aKillHistoryData.RemoveOrdered(0);
+        }
+        
+        array<int> packed;
+        m_iPackedLength = STS_PlayerStatsBinaryCodec.Encode(m_mWeaponKillsData, m_mKilledByData, m_aKillHistoryData, m_KillRollupData, packed);
+        m_aPackedData = packed;
+        m_iPackedVersion = STS_PlayerStatsBinaryCodec.FORMAT_VERSION;
+        
+        m_sWeaponKillsJson = "";
+        m_sKilledByJson = "";
+        m_sKillHistoryJson = "";
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Helper methods for validation and sanitization
     
@@ -647,7 +852,7 @@ class STS_PlayerStatsEntity : EDF_DbEntity
     
     //------------------------------------------------------------------------------------------------
     // Serialize map to JSON
-    protected string SerializeMapToJson(map<string, int> dataMap)
+    string SerializeMapToJson(map<string, int> dataMap)
     {
         if (!dataMap || dataMap.Count() == 0)
             return "{}";
@@ -698,11 +903,11 @@ class STS_PlayerStatsEntity : EDF_DbEntity
         while (pos < content.Length())
         {
             // Find the key (should start with a quote)
-            int keyStart = content.IndexOfFrom("\"", pos);
+            int keyStart = content.IndexOfFrom(pos, "\"");
             if (keyStart == -1)
                 break;
                 
-            int keyEnd = content.IndexOfFrom("\"", keyStart + 1);
+            int keyEnd = content.IndexOfFrom(keyStart + 1, "\"");
             if (keyEnd == -1)
                 break;
                 
@@ -710,12 +915,12 @@ class STS_PlayerStatsEntity : EDF_DbEntity
             string key = content.Substring(keyStart + 1, keyEnd - keyStart - 1);
             
             // Find the value (should start after a colon)
-            int colonPos = content.IndexOfFrom(":", keyEnd);
+            int colonPos = content.IndexOfFrom(keyEnd, ":");
             if (colonPos == -1)
                 break;
                 
             // Find the end of the value (comma or end of string)
-            int valueEnd = content.IndexOfFrom(",", colonPos);
+            int valueEnd = content.IndexOfFrom(colonPos, ",");
             if (valueEnd == -1)
                 valueEnd = content.Length();
                 
@@ -743,6 +948,7 @@ class STS_KillRecord
     int m_iTimestamp;
     float m_fDistance;
     bool m_bHeadshot;
+    vector m_vPosition;     // Stored quantized to whole metres
     
     //------------------------------------------------------------------------------------------------
     // Serialize to JSON
@@ -755,7 +961,8 @@ class STS_KillRecord
         json += "\"weapon\":\"" + m_sWeapon.Replace("\"", "\\\"") + "\",";
         json += "\"timestamp\":" + m_iTimestamp.ToString() + ",";
         json += "\"distance\":" + m_fDistance.ToString() + ",";
-        json += "\"headshot\":" + m_bHeadshot.ToString();
+        json += "\"headshot\":" + m_bHeadshot.ToString() + ",";
+        json += "\"pos\":\"" + Math.Round(m_vPosition[0]).ToString() + " " + Math.Round(m_vPosition[1]).ToString() + " " + Math.Round(m_vPosition[2]).ToString() + "\"";
         
         json += "}";
         
@@ -777,7 +984,7 @@ class STS_KillRecord
         if (killerStart != -1)
         {
             killerStart += 10; // Length of "killer":\"
-            int killerEnd = json.IndexOfFrom("\"", killerStart);
+            int killerEnd = json.IndexOfFrom(killerStart, "\"");
             if (killerEnd != -1)
             {
                 record.m_sKillerName = json.Substring(killerStart, killerEnd - killerStart);
@@ -789,7 +996,7 @@ class STS_KillRecord
         if (victimStart != -1)
         {
             victimStart += 10; // Length of "victim":\"
-            int victimEnd = json.IndexOfFrom("\"", victimStart);
+            int victimEnd = json.IndexOfFrom(victimStart, "\"");
             if (victimEnd != -1)
             {
                 record.m_sVictimName = json.Substring(victimStart, victimEnd - victimStart);
@@ -801,7 +1008,7 @@ class STS_KillRecord
         if (weaponStart != -1)
         {
             weaponStart += 10; // Length of "weapon":\"
-            int weaponEnd = json.IndexOfFrom("\"", weaponStart);
+            int weaponEnd = json.IndexOfFrom(weaponStart, "\"");
             if (weaponEnd != -1)
             {
                 record.m_sWeapon = json.Substring(weaponStart, weaponEnd - weaponStart);
@@ -813,7 +1020,7 @@ class STS_KillRecord
         if (timestampStart != -1)
         {
             timestampStart += 12; // Length of "timestamp":
-            int timestampEnd = json.IndexOfFrom(",", timestampStart);
+            int timestampEnd = json.IndexOfFrom(timestampStart, ",");
             if (timestampEnd != -1)
             {
                 string timestampStr = json.Substring(timestampStart, timestampEnd - timestampStart);
@@ -826,7 +1033,7 @@ class STS_KillRecord
         if (distanceStart != -1)
         {
             distanceStart += 11; // Length of "distance":
-            int distanceEnd = json.IndexOfFrom(",", distanceStart);
+            int distanceEnd = json.IndexOfFrom(distanceStart, ",");
             if (distanceEnd != -1)
             {
                 string distanceStr = json.Substring(distanceStart, distanceEnd - distanceStart);
@@ -843,6 +1050,18 @@ class STS_KillRecord
             record.m_bHeadshot = headshotStr.IndexOf("true") != -1;
         }
         
+        // Parse position
+        int positionStart = json.IndexOf("\"pos\":\"");
+        if (positionStart != -1)
+        {
+            positionStart += 7; // Length of "pos":\"
+            int positionEnd = json.IndexOfFrom(positionStart, "\"");
+            if (positionEnd != -1)
+            {
+                record.m_vPosition = json.Substring(positionStart, positionEnd - positionStart).ToVector();
+            }
+        }
+        
         return record;
     }
 } 
\ No newline at end of file
@@ -0,0 +1,282 @@
+// STS_PlayerStatsFileIndex.c
+// Sidecar index for the player_stats.json cache file mapping each player UID to the byte range of its
+// stats object, so individual players can be read on demand instead of parsing the whole file at boot.
+// Whatever rewrites a stats file deletes its index first (Invalidate); reads also check that the UID key sits
+// where the index says and fall back to rescanning the file when it does not.
+//
+// Index file format (<stats file>.idx):
+//   STS_INDEX <tab> format version <tab> stats file length
+//   uid <tab> key offset <tab> offset <tab> length        (one line per player)
+
+//------------------------------------------------------------------------------------------------
+class STS_PlayerStatsFileIndexEntry
+{
+    int m_iKeyOffset; // Opening quote of the UID key
+    int m_iOffset;
+    int m_iLength;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsFileIndexEntry(int keyOffset, int offset, int length)
+    {
+        m_iKeyOffset = keyOffset;
+        m_iOffset = offset;
+        m_iLength = length;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_PlayerStatsFileIndex
+{
+    protected const string INDEX_MAGIC = "STS_INDEX";
+    protected const int INDEX_VERSION = 2;
+    
+    protected string m_sStatsFilePath;
+    protected string m_sIndexFilePath;
+    protected ref map<string, ref STS_PlayerStatsFileIndexEntry> m_mEntries = new map<string, ref STS_PlayerStatsFileIndexEntry>();
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsFileIndex()
+    {
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load the index for a stats file, rebuilding it if it is missing or stale. Returns false if there is no stats file.
+    bool Load(string statsFilePath)
+    {
+        m_sStatsFilePath = statsFilePath;
+        m_sIndexFilePath = statsFilePath + ".idx";
+        m_mEntries.Clear();
+        
+        int statsLength = GetFileLength(m_sStatsFilePath);
+        if (statsLength < 0)
+            return false;
+        
+        if (ReadIndex(statsLength))
+            return true;
+        
+        return Rebuild(statsLength);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Start an index for a stats file that is being written; entries are added as records are written and
+    // Save() is called once the file is in place
+    void Begin(string statsFilePath)
+    {
+        m_sStatsFilePath = statsFilePath;
+        m_sIndexFilePath = statsFilePath + ".idx";
+        m_mEntries.Clear();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void AddEntry(string playerUID, int keyOffset, int offset, int length)
+    {
+        m_mEntries.Set(playerUID, new STS_PlayerStatsFileIndexEntry(keyOffset, offset, length));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write the index built with Begin/AddEntry for the stats file as it is now
+    void Save()
+    {
+        WriteIndex(GetFileLength(m_sStatsFilePath));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool Contains(string playerUID)
+    {
+        return m_mEntries.Contains(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_mEntries.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Delete the index of a stats file; call before the stats file is rewritten so a stale index is never read
+    static void Invalidate(string statsFilePath)
+    {
+        string indexFilePath = statsFilePath + ".idx";
+        if (FileIO.FileExists(indexFilePath))
+            FileIO.DeleteFile(indexFilePath);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read one player's stats object straight from its byte range; empty if unknown or unreadable. If the
+    // range no longer holds that player the file is rescanned and the index rebuilt.
+    string ReadRecord(string playerUID)
+    {
+        STS_PlayerStatsFileIndexEntry entry = m_mEntries.Get(playerUID);
+        if (!entry)
+            return "";
+        
+        string json;
+        if (ReadEntry(playerUID, entry, json))
+            return json;
+        
+        if (m_Logger)
+            m_Logger.LogWarning(string.Format("Stats file index for %1 points at another record - rescanning %2", playerUID, m_sStatsFilePath),
+                "STS_PlayerStatsFileIndex", "ReadRecord");
+        
+        if (!Rebuild())
+            return "";
+        
+        entry = m_mEntries.Get(playerUID);
+        if (!entry || !ReadEntry(playerUID, entry, json))
+            return "";
+        
+        return json;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read the object of an entry after checking that its key is the expected UID; false on a mismatch
+    protected bool ReadEntry(string playerUID, STS_PlayerStatsFileIndexEntry entry, out string json)
+    {
+        json = "";
+        
+        // An unreadable file is not a stale index; rescanning it would not help
+        FileHandle file = FileIO.OpenFile(m_sStatsFilePath, FileMode.READ);
+        if (!file)
+            return true;
+        
+        string line;
+        file.Seek(entry.m_iKeyOffset);
+        if (file.ReadLine(line) < 0 || !line.StartsWith("\"" + playerUID + "\""))
+        {
+            file.Close();
+            return false;
+        }
+        
+        int endOffset = entry.m_iOffset + entry.m_iLength;
+        file.Seek(entry.m_iOffset);
+        
+        while (true)
+        {
+            int lineStart = file.GetPos();
+            if (lineStart >= endOffset || file.ReadLine(line) < 0)
+                break;
+            
+            // The last line may continue past the object (e.g. a separating comma)
+            if (file.GetPos() >= endOffset)
+            {
+                json += line.Substring(0, Math.Min(line.Length(), endOffset - lineStart));
+                break;
+            }
+            
+            json += line;
+        }
+        
+        file.Close();
+        
+        // The key can match while the object moved relative to it
+        return json.StartsWith("{") && json.EndsWith("}");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Scan the stats file once and write a fresh index
+    bool Rebuild(int statsLength = -1)
+    {
+        if (statsLength < 0)
+            statsLength = GetFileLength(m_sStatsFilePath);
+        
+        m_mEntries.Clear();
+        
+        STS_PlayerStatsFileReader reader = new STS_PlayerStatsFileReader();
+        if (!reader.Open(m_sStatsFilePath))
+            return false;
+        
+        float startTime = System.GetTickCount();
+        
+        string playerUID;
+        string playerJson;
+        int offset;
+        int length;
+        while (reader.Next(playerUID, playerJson))
+        {
+            reader.GetLastRecordLocation(offset, length);
+            m_mEntries.Set(playerUID, new STS_PlayerStatsFileIndexEntry(reader.GetLastRecordKeyOffset(), offset, length));
+        }
+        
+        WriteIndex(statsLength);
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Rebuilt stats file index: %1 players in %2 ms", m_mEntries.Count(),
+                System.GetTickCount() - startTime), "STS_PlayerStatsFileIndex", "Rebuild");
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read the index file; false if it is missing, malformed or was built for a different stats file length
+    protected bool ReadIndex(int statsLength)
+    {
+        FileHandle file = FileIO.OpenFile(m_sIndexFilePath, FileMode.READ);
+        if (!file)
+            return false;
+        
+        string line;
+        array<string> fields = new array<string>();
+        
+        if (file.ReadLine(line) < 0)
+        {
+            file.Close();
+            return false;
+        }
+        
+        line.Split("\t", fields, false);
+        if (fields.Count() < 3 || fields[0] != INDEX_MAGIC || fields[1].ToInt() != INDEX_VERSION || fields[2].ToInt() != statsLength)
+        {
+            file.Close();
+            return false;
+        }
+        
+        while (file.ReadLine(line) >= 0)
+        {
+            fields.Clear();
+            line.Split("\t", fields, false);
+            if (fields.Count() < 4)
+                continue;
+            
+            m_mEntries.Set(fields[0], new STS_PlayerStatsFileIndexEntry(fields[1].ToInt(), fields[2].ToInt(), fields[3].ToInt()));
+        }
+        
+        file.Close();
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void WriteIndex(int statsLength)
+    {
+        FileHandle file = FileIO.OpenFile(m_sIndexFilePath, FileMode.WRITE);
+        if (!file)
+        {
+            if (m_Logger)
+                m_Logger.LogWarning(string.Format("Failed to write stats file index %1 - it will be rebuilt next start", m_sIndexFilePath),
+                    "STS_PlayerStatsFileIndex", "WriteIndex");
+            return;
+        }
+        
+        file.WriteLine(string.Format("%1\t%2\t%3", INDEX_MAGIC, INDEX_VERSION, statsLength));
+        foreach (string uid, STS_PlayerStatsFileIndexEntry entry : m_mEntries)
+        {
+            file.WriteLine(string.Format("%1\t%2\t%3\t%4", uid, entry.m_iKeyOffset, entry.m_iOffset, entry.m_iLength));
+        }
+        
+        file.Close();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static int GetFileLength(string filePath)
+    {
+        FileHandle file = FileIO.OpenFile(filePath, FileMode.READ);
+        if (!file)
+            return -1;
+        
+        int length = file.GetLength();
+        file.Close();
+        return length;
+    }
+}
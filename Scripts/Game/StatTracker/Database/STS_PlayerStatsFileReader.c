@@ -0,0 +1,256 @@
+// STS_PlayerStatsFileReader.c
+// Incremental pull reader for the legacy player_stats.json cache file:
+//   {"players":{"<uid>":{...stats...},"<uid>":{...}}}
+// The file is read a line at a time and each Next() call hands out one player's UID and JSON object.
+// Objects are cut out with one Substring per line they span instead of being copied character by character.
+
+class STS_PlayerStatsFileReader
+{
+    protected FileHandle m_File;
+    
+    // Current line and scan position
+    protected string m_sLine;
+    protected int m_iLineLength = 0;
+    protected int m_iLineOffset = 0;    // Byte offset of the current line in the file
+    protected int m_iPos = 0;
+    
+    // Structural state carried across lines
+    protected int m_iDepth = 0;
+    protected bool m_bInString = false;
+    protected bool m_bEscape = false;
+    protected int m_iPlayersDepth = -1; // Depth of the players object once found
+    protected bool m_bDone = false;
+    
+    // String being captured (a key at root or players level)
+    protected bool m_bCapturingKey = false;
+    protected int m_iKeyStart = 0;
+    protected string m_sKeyBuffer;
+    protected string m_sLastKey;
+    protected int m_iKeyOffset = 0;     // Byte offset of the opening quote of the last key
+    
+    // Player object being captured
+    protected bool m_bInValue = false;
+    protected int m_iValueStart = 0;
+    protected string m_sValueBuffer;
+    protected int m_iValueOffset = 0;
+    
+    // Location of the last record handed out
+    protected int m_iRecordKeyOffset = 0;
+    protected int m_iRecordOffset = 0;
+    protected int m_iRecordLength = 0;
+    
+    protected int m_iRecordCount = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_PlayerStatsFileReader()
+    {
+        Close();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool Open(string filePath)
+    {
+        Close();
+        
+        m_File = FileIO.OpenFile(filePath, FileMode.READ);
+        if (!m_File)
+            return false;
+        
+        m_sLine = "";
+        m_iLineLength = 0;
+        m_iLineOffset = 0;
+        m_iPos = 0;
+        m_iDepth = 0;
+        m_bInString = false;
+        m_bEscape = false;
+        m_iPlayersDepth = -1;
+        m_bDone = false;
+        m_bCapturingKey = false;
+        m_sLastKey = "";
+        m_bInValue = false;
+        m_iRecordCount = 0;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Close()
+    {
+        if (m_File)
+        {
+            m_File.Close();
+            m_File = null;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Advance to the next player record; returns false at the end of the players object or file
+    bool Next(out string playerUID, out string playerJson)
+    {
+        while (!m_bDone)
+        {
+            if (m_iPos >= m_iLineLength)
+            {
+                if (!ReadNextLine())
+                    return false;
+                continue;
+            }
+            
+            if (ScanLine(playerUID, playerJson))
+                return true;
+        }
+        
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected bool ReadNextLine()
+    {
+        if (!m_File)
+            return false;
+        
+        // Flush partial captures from the finished line
+        if (m_bInValue)
+        {
+            m_sValueBuffer += m_sLine.Substring(m_iValueStart, m_iLineLength - m_iValueStart);
+            m_iValueStart = 0;
+        }
+        if (m_bCapturingKey)
+        {
+            m_sKeyBuffer += m_sLine.Substring(m_iKeyStart, m_iLineLength - m_iKeyStart);
+            m_iKeyStart = 0;
+        }
+        
+        m_iLineOffset = m_File.GetPos();
+        if (m_File.ReadLine(m_sLine) < 0)
+        {
+            Close();
+            m_bDone = true;
+            return false;
+        }
+        
+        m_iLineLength = m_sLine.Length();
+        m_iPos = 0;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Scan the rest of the current line; stops early and returns true when a player object closes
+    protected bool ScanLine(out string playerUID, out string playerJson)
+    {
+        while (m_iPos < m_iLineLength)
+        {
+            int i = m_iPos;
+            string c = m_sLine.Get(i);
+            m_iPos++;
+            
+            if (m_bInString)
+            {
+                if (m_bEscape)
+                {
+                    m_bEscape = false;
+                }
+                else if (c == "\\")
+                {
+                    m_bEscape = true;
+                }
+                else if (c == "\"")
+                {
+                    m_bInString = false;
+                    
+                    if (m_bCapturingKey)
+                    {
+                        m_sLastKey = m_sKeyBuffer + m_sLine.Substring(m_iKeyStart, i - m_iKeyStart);
+                        m_bCapturingKey = false;
+                    }
+                }
+                continue;
+            }
+            
+            if (c == "\"")
+            {
+                m_bInString = true;
+                
+                // Keys of the root object (looking for "players") and of the players object (UIDs)
+                if (!m_bInValue && (m_iDepth == 1 || m_iDepth == m_iPlayersDepth))
+                {
+                    m_bCapturingKey = true;
+                    m_iKeyStart = i + 1;
+                    m_sKeyBuffer = "";
+                    m_iKeyOffset = m_iLineOffset + i;
+                }
+            }
+            else if (c == "{")
+            {
+                m_iDepth++;
+                
+                if (m_iPlayersDepth < 0)
+                {
+                    if (m_iDepth == 2 && m_sLastKey == "players")
+                        m_iPlayersDepth = 2;
+                }
+                else if (!m_bInValue && m_iDepth == m_iPlayersDepth + 1)
+                {
+                    m_bInValue = true;
+                    m_iValueStart = i;
+                    m_sValueBuffer = "";
+                    m_iValueOffset = m_iLineOffset + i;
+                    m_iRecordKeyOffset = m_iKeyOffset;
+                }
+            }
+            else if (c == "}")
+            {
+                m_iDepth--;
+                
+                if (m_bInValue && m_iDepth == m_iPlayersDepth)
+                {
+                    m_bInValue = false;
+                    playerUID = m_sLastKey;
+                    playerJson = m_sValueBuffer + m_sLine.Substring(m_iValueStart, i - m_iValueStart + 1);
+                    m_sValueBuffer = "";
+                    
+                    m_iRecordOffset = m_iValueOffset;
+                    m_iRecordLength = m_iLineOffset + i + 1 - m_iValueOffset;
+                    m_iRecordCount++;
+                    return true;
+                }
+                
+                if (m_iPlayersDepth > 0 && m_iDepth < m_iPlayersDepth)
+                {
+                    m_bDone = true;
+                    Close();
+                    return false;
+                }
+            }
+        }
+        
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Byte offset and length of the object returned by the last Next() call
+    void GetLastRecordLocation(out int offset, out int length)
+    {
+        offset = m_iRecordOffset;
+        length = m_iRecordLength;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Byte offset of the quoted UID key of the object returned by the last Next() call
+    int GetLastRecordKeyOffset()
+    {
+        return m_iRecordKeyOffset;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetRecordCount()
+    {
+        return m_iRecordCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // False if the file ended before the players object was found
+    bool FoundPlayers()
+    {
+        return m_iPlayersDepth > 0;
+    }
+}
@@ -1,6 +1,21 @@
 // STS_PlayerStatsRepository.c
 // Repository for player statistics database operations
 
+//------------------------------------------------------------------------------------------------
+// What the repository remembers about a stored player so saves load it by ID instead of querying by UID
+class STS_PlayerStatsEntityRef
+{
+    string m_sEntityId;
+    float m_fCreationTime;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsEntityRef(string entityId, float creationTime)
+    {
+        m_sEntityId = entityId;
+        m_fCreationTime = creationTime;
+    }
+}
+
 class STS_PlayerStatsRepository
 {
     // Database context
@@ -12,12 +27,21 @@ class STS_PlayerStatsRepository
     // Logger for diagnostics
     protected STS_LoggingSystem m_Logger;
     
+    // Measured latency drives the database admission rate
+    protected STS_AdmissionController m_AdmissionController;
+    
+    // Player UID -> stored entity ID, filled on load, insert and query, cleared on delete
+    protected ref map<string, ref STS_PlayerStatsEntityRef> m_mEntityRefs = new map<string, ref STS_PlayerStatsEntityRef>();
+    protected int m_iEntityRefHits = 0;
+    protected int m_iEntityRefMisses = 0;
+    
     //------------------------------------------------------------------------------------------------
     void STS_PlayerStatsRepository(EDF_DbContext dbContext)
     {
         m_DbContext = dbContext;
         m_Repository = EDF_DbEntityHelper<STS_PlayerStatsEntity>.GetRepository(m_DbContext);
         m_Logger = STS_LoggingSystem.GetInstance();
+        m_AdmissionController = STS_AdmissionController.GetInstance();
         
         if (!m_Repository)
         {
@@ -91,52 +115,48 @@ class STS_PlayerStatsRepository
             
             try
             {
-                // Check if player already exists in the database with retry logic
+                // Known players are loaded by their cached entity ID, the rest by UID - a single attempt,
+                // use SavePlayerStatsAsync to have failures retried off the game thread. Either way the
+                // stored entity is merged into, so its kill rollup and history survive the save.
                 STS_PlayerStatsEntity entity = null;
-                EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").Equals(playerUID);
+                STS_PlayerStats oldStats = null;
+                bool exists = false;
                 
-                // Retry query up to 3 times in case of temporary failures
-                for (int attempt = 1; attempt <= 3; attempt++)
+                STS_PlayerStatsEntityRef entityRef = LookupEntityRef(playerUID);
+                if (entityRef)
                 {
-                    try
-                    {
-                        entity = m_Repository.FindFirst(condition);
-                        break; // Success, exit retry loop
-                    }
-                    catch (Exception queryEx)
-                    {
-                        if (attempt == 3)
-                        {
-                            // Rethrow on final attempt
-                            throw queryEx;
-                        }
-                        
-                        if (m_Logger)
-                            m_Logger.LogWarning(string.Format("Query attempt %1 failed for UID %2: %3", 
-                                attempt, playerUID, queryEx.ToString()), 
-                                "STS_PlayerStatsRepository", "SavePlayerStats");
-                        
-                        // Sleep before retry with increasing delay
-                        int delayMs = 50 * attempt;
-                        Sleep(delayMs);
-                    }
+                    entity = FindEntityByRef(entityRef);
+                    
+                    // The record behind the cached ID is gone - forget it and look the player up by UID
+                    if (!entity)
+                        m_mEntityRefs.Remove(playerUID);
                 }
                 
-                // Always log operation details at debug level
-                if (m_Logger)
-                    m_Logger.LogDebug(string.Format("Saving stats for player %1 (UID: %2) - exists: %3", 
-                        playerName, playerUID, entity != null), "STS_PlayerStatsRepository", "SavePlayerStats");
-                
-                EDF_EDbOperationStatusCode statusCode;
+                if (!entity)
+                {
+                    EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").Equals(playerUID);
+                    entity = m_Repository.FindFirst(condition);
+                }
                 
+                exists = entity != null;
                 if (entity)
                 {
                     // Create a backup of existing entity values for logging significant changes
-                    STS_PlayerStats oldStats = entity.ToPlayerStats();
+                    oldStats = entity.ToPlayerStats();
                     
                     // Update existing entity
                     entity.UpdateFromStats(playerName, stats);
-                    
+                }
+                
+                // Always log operation details at debug level
+                if (m_Logger)
+                    m_Logger.LogDebug(string.Format("Saving stats for player %1 (UID: %2) - exists: %3, cached: %4", 
+                        playerName, playerUID, exists, entityRef != null), "STS_PlayerStatsRepository", "SavePlayerStats");
+                
+                EDF_EDbOperationStatusCode statusCode;
+                
+                if (exists)
+                {
                     // Record update timestamp
                     entity.m_fLastUpdateTime = System.GetTickCount() / 1000.0;
                     
@@ -144,7 +164,7 @@ class STS_PlayerStatsRepository
                     statusCode = m_Repository.AddOrUpdate(entity);
                     
                     // Log significant changes for debugging and auditing
-                    if (m_Logger && statusCode == EDF_EDbOperationStatusCode.SUCCESS)
+                    if (m_Logger && oldStats && statusCode == EDF_EDbOperationStatusCode.SUCCESS)
                     {
                         // Log significant stat changes
                         LogSignificantChanges(playerUID, playerName, oldStats, stats);
@@ -199,11 +219,18 @@ class STS_PlayerStatsRepository
                         }
                     }
                 }
+                
+                // Remember the entity ID for the next save; forget it on failure in case it went stale
+                if (success)
+                    CacheEntityRef(entity);
+                else
+                    m_mEntityRefs.Remove(playerUID);
             }
             catch (Exception innerEx)
             {
                 // Make sure transaction is rolled back on exception
                 transaction.Rollback();
+                m_mEntityRefs.Remove(playerUID);
                 
                 // Re-throw the exception to be caught by outer catch block
                 throw innerEx;
@@ -211,6 +238,7 @@ class STS_PlayerStatsRepository
             
             // Log operation duration for performance monitoring
             float duration = (System.GetTickCount() / 1000.0) - startTime;
+            m_AdmissionController.RecordLatency(duration * 1000);
             if (m_Logger)
             {
                 if (duration > 0.5) // Log warning if operation took more than 500ms
@@ -249,6 +277,191 @@ class STS_PlayerStatsRepository
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Save a batch of player statistics as a single upsert in one transaction.
+    // Existing entities are looked up with one query for the whole batch instead of one per player.
+    // Each record's m_bSuccess is set individually; returns the number of records saved.
+    int SavePlayerStatsBatch(array<ref STS_PlayerStatsSaveRecord> records)
+    {
+        if (!records || records.IsEmpty())
+            return 0;
+        
+        foreach (STS_PlayerStatsSaveRecord record : records)
+        {
+            record.m_bSuccess = false;
+        }
+        
+        if (!m_Repository)
+        {
+            if (m_Logger)
+                m_Logger.LogError("Repository is null - database connection may be broken",
+                    "STS_PlayerStatsRepository", "SavePlayerStatsBatch");
+            return 0;
+        }
+        
+        // Validate up front so invalid records never enter the transaction
+        array<STS_PlayerStatsSaveRecord> validRecords = new array<STS_PlayerStatsSaveRecord>();
+        array<string> playerUIDs = new array<string>();
+        
+        foreach (STS_PlayerStatsSaveRecord record : records)
+        {
+            if (record.m_sPlayerUID.IsEmpty() || !record.GetStatsToWrite() || !ValidatePlayerStats(record.GetStatsToWrite()))
+            {
+                if (m_Logger)
+                    m_Logger.LogError(string.Format("Invalid player stats data for %1 (UID: %2) - skipping in batch",
+                        record.m_sPlayerName, record.m_sPlayerUID), "STS_PlayerStatsRepository", "SavePlayerStatsBatch");
+                continue;
+            }
+            
+            if (record.m_sPlayerName.IsEmpty())
+                record.m_sPlayerName = "Unknown Player";
+            
+            validRecords.Insert(record);
+            playerUIDs.Insert(record.m_sPlayerUID);
+        }
+        
+        if (validRecords.IsEmpty())
+            return 0;
+        
+        EDF_DbTransaction transaction = m_DbContext.BeginTransaction();
+        if (!transaction)
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Failed to create transaction for batch of %1 records", validRecords.Count()),
+                    "STS_PlayerStatsRepository", "SavePlayerStatsBatch");
+            return 0;
+        }
+        
+        int savedCount = 0;
+        float batchStartTime = System.GetTickCount();
+        
+        try
+        {
+            // The stored entities are merged into so their kill rollup and history survive: one lookup by cached
+            // ID for the known players, and one by UID for the rest and for cached IDs whose record is gone
+            map<string, ref STS_PlayerStatsEntity> existingEntities = new map<string, ref STS_PlayerStatsEntity>();
+            array<string> knownIds = new array<string>();
+            foreach (string knownUID : playerUIDs)
+            {
+                STS_PlayerStatsEntityRef knownRef = LookupEntityRef(knownUID);
+                if (knownRef)
+                    knownIds.Insert(knownRef.m_sEntityId);
+            }
+            
+            if (!knownIds.IsEmpty())
+            {
+                array<ref STS_PlayerStatsEntity> foundById = m_Repository.FindAll(EDF_DbFind.Id().EqualsAnyOf(EDF_DbValues<string>.From(knownIds)));
+                if (foundById)
+                {
+                    foreach (STS_PlayerStatsEntity storedEntity : foundById)
+                    {
+                        existingEntities.Set(storedEntity.m_sPlayerUID, storedEntity);
+                    }
+                }
+            }
+            
+            array<string> unknownUIDs = new array<string>();
+            foreach (string playerUID : playerUIDs)
+            {
+                if (existingEntities.Contains(playerUID))
+                    continue;
+                
+                m_mEntityRefs.Remove(playerUID);
+                unknownUIDs.Insert(playerUID);
+            }
+            
+            if (!unknownUIDs.IsEmpty())
+            {
+                EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").EqualsAnyOf(EDF_DbValues<string>.From(unknownUIDs));
+                array<ref STS_PlayerStatsEntity> found = m_Repository.FindAll(condition);
+                if (found)
+                {
+                    foreach (STS_PlayerStatsEntity existing : found)
+                    {
+                        existingEntities.Set(existing.m_sPlayerUID, existing);
+                    }
+                }
+            }
+            
+            float currentTime = System.GetTickCount() / 1000.0;
+            array<ref STS_PlayerStatsEntity> savedEntities = new array<ref STS_PlayerStatsEntity>();
+            
+            foreach (STS_PlayerStatsSaveRecord record : validRecords)
+            {
+                STS_PlayerStatsEntity entity = existingEntities.Get(record.m_sPlayerUID);
+                if (entity)
+                {
+                    entity.UpdateFromStats(record.m_sPlayerName, record.GetStatsToWrite());
+                }
+                else
+                {
+                    entity = STS_PlayerStatsEntity.FromPlayerStats(record.m_sPlayerUID, record.m_sPlayerName, record.GetStatsToWrite());
+                    entity.m_fCreationTime = currentTime;
+                }
+                
+                entity.m_fLastUpdateTime = currentTime;
+                
+                EDF_EDbOperationStatusCode statusCode = m_Repository.AddOrUpdate(entity);
+                record.m_bSuccess = statusCode == EDF_EDbOperationStatusCode.SUCCESS;
+                
+                if (record.m_bSuccess)
+                {
+                    savedCount++;
+                    savedEntities.Insert(entity);
+                }
+                else
+                {
+                    m_mEntityRefs.Remove(record.m_sPlayerUID);
+                    
+                    if (m_Logger)
+                        m_Logger.LogError(string.Format("Batch upsert failed for %1 (UID: %2) - Status: %3",
+                            record.m_sPlayerName, record.m_sPlayerUID, statusCode), "STS_PlayerStatsRepository", "SavePlayerStatsBatch");
+                }
+            }
+            
+            EDF_EDbOperationStatusCode commitStatus = transaction.Commit();
+            if (commitStatus != EDF_EDbOperationStatusCode.SUCCESS)
+            {
+                if (m_Logger)
+                    m_Logger.LogError(string.Format("Failed to commit batch of %1 records - Status: %2",
+                        validRecords.Count(), commitStatus), "STS_PlayerStatsRepository", "SavePlayerStatsBatch");
+                
+                // Nothing in the batch is durable if the commit failed
+                foreach (STS_PlayerStatsSaveRecord record : validRecords)
+                {
+                    record.m_bSuccess = false;
+                    m_mEntityRefs.Remove(record.m_sPlayerUID);
+                }
+                return 0;
+            }
+            
+            foreach (STS_PlayerStatsEntity savedEntity : savedEntities)
+            {
+                CacheEntityRef(savedEntity);
+            }
+            
+            // Per-record latency, so batches and single saves are measured on the same scale
+            m_AdmissionController.RecordLatency((System.GetTickCount() - batchStartTime) / validRecords.Count());
+        }
+        catch (Exception e)
+        {
+            transaction.Rollback();
+            
+            foreach (STS_PlayerStatsSaveRecord record : validRecords)
+            {
+                record.m_bSuccess = false;
+                m_mEntityRefs.Remove(record.m_sPlayerUID);
+            }
+            
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Exception in SavePlayerStatsBatch: %1", e.ToString()),
+                    "STS_PlayerStatsRepository", "SavePlayerStatsBatch", e.GetStackTrace());
+            return 0;
+        }
+        
+        return savedCount;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Validate player statistics before saving
     bool ValidatePlayerStats(STS_PlayerStats stats)
@@ -377,53 +590,17 @@ class STS_PlayerStatsRepository
                 m_Logger.LogDebug(string.Format("Loading stats for player UID: %1", playerUID), 
                     "STS_PlayerStatsRepository", "LoadPlayerStats");
             
-            // Find player in the database using retry logic
-            STS_PlayerStatsEntity entity = null;
-            Exception lastException = null;
+            // Find player in the database. This is a single attempt - use LoadPlayerStatsWithRetry
+            // to have failures retried off the game thread.
             EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").Equals(playerUID);
-            
-            // Retry query up to 3 times in case of temporary failures
-            for (int attempt = 1; attempt <= 3; attempt++)
-            {
-                try
-                {
-                    entity = m_Repository.FindFirst(condition);
-                    lastException = null; // Clear exception if query succeeds
-                    break; // Success, exit retry loop
-                }
-                catch (Exception queryEx)
-                {
-                    lastException = queryEx;
-                    
-                    if (m_Logger)
-                        m_Logger.LogWarning(string.Format("Query attempt %1 failed for UID %2: %3", 
-                            attempt, playerUID, queryEx.ToString()), 
-                            "STS_PlayerStatsRepository", "LoadPlayerStats");
-                    
-                    if (attempt < 3)
-                    {
-                        // Sleep before retry with increasing delay
-                        int delayMs = 50 * attempt;
-                        Sleep(delayMs);
-                    }
-                }
-            }
-            
-            // If we have a persistent exception after retries, log and rethrow
-            if (lastException)
-            {
-                if (m_Logger)
-                    m_Logger.LogError(string.Format("All query attempts failed for UID %1: %2", 
-                        playerUID, lastException.ToString()), 
-                        "STS_PlayerStatsRepository", "LoadPlayerStats", lastException.GetStackTrace());
-                
-                throw lastException;
-            }
+            STS_PlayerStatsEntity entity = m_Repository.FindFirst(condition);
             
             STS_PlayerStats result = null;
             
             if (entity)
             {
+                CacheEntityRef(entity);
+                
                 try
                 {
                     // Convert entity to stats
@@ -477,6 +654,7 @@ class STS_PlayerStatsRepository
             
             // Log operation duration for performance monitoring
             float duration = (System.GetTickCount() / 1000.0) - startTime;
+            m_AdmissionController.RecordLatency(duration * 1000);
             if (m_Logger)
             {
                 if (duration > 0.1) // Log warning if loading took more than 100ms
@@ -563,7 +741,7 @@ class STS_PlayerStatsRepository
             EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").Equals(playerUID);
             
             // Create a callback handler with error handling and validation
-            STS_LoadPlayerStatsCallback callbackHandler = new STS_LoadPlayerStatsCallback(callback, playerUID, m_Logger, startTime);
+            STS_LoadPlayerStatsCallback callbackHandler = new STS_LoadPlayerStatsCallback(callback, playerUID, m_Logger, startTime, this);
             
             // Execute the async find
             m_Repository.FindFirstAsync(condition, callbackHandler);
@@ -601,6 +779,7 @@ class STS_PlayerStatsRepository
             // Convert entities to stats
             foreach (STS_PlayerStatsEntity entity : entities)
             {
+                CacheEntityRef(entity);
                 STS_PlayerStats stats = entity.ToPlayerStats();
                 result.Insert(stats);
             }
@@ -615,6 +794,76 @@ class STS_PlayerStatsRepository
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Rewrite up to maxRecords legacy JSON records in the binary layout.
+    // Returns the number migrated, 0 when none are left, or -1 on failure.
+    int MigrateLegacyRecords(int maxRecords = 100)
+    {
+        if (!m_Repository)
+            return -1;
+        
+        array<ref STS_PlayerStatsEntity> legacy;
+        try
+        {
+            legacy = m_Repository.FindAll(EDF_DbFind.Field("m_iPackedVersion").Equals(0), null, maxRecords);
+        }
+        catch (Exception e)
+        {
+            m_Logger.LogError(string.Format("Exception finding legacy records: %1", e.ToString()), 
+                "STS_PlayerStatsRepository", "MigrateLegacyRecords");
+            return -1;
+        }
+        
+        if (!legacy || legacy.IsEmpty())
+            return 0;
+        
+        EDF_DbTransaction transaction = m_DbContext.BeginTransaction();
+        if (!transaction)
+        {
+            m_Logger.LogError("Failed to create transaction for record migration", "STS_PlayerStatsRepository", "MigrateLegacyRecords");
+            return -1;
+        }
+        
+        int migrated = 0;
+        
+        try
+        {
+            foreach (STS_PlayerStatsEntity entity : legacy)
+            {
+                if (!entity.MigrateToBinary())
+                    continue;
+                
+                EDF_EDbOperationStatusCode statusCode = m_Repository.AddOrUpdate(entity);
+                if (statusCode != EDF_EDbOperationStatusCode.SUCCESS)
+                {
+                    transaction.Rollback();
+                    m_Logger.LogError(string.Format("Failed to migrate record for UID %1 - Status: %2", entity.m_sPlayerUID, statusCode), 
+                        "STS_PlayerStatsRepository", "MigrateLegacyRecords");
+                    return -1;
+                }
+                
+                migrated++;
+            }
+            
+            EDF_EDbOperationStatusCode commitStatus = transaction.Commit();
+            if (commitStatus != EDF_EDbOperationStatusCode.SUCCESS)
+            {
+                m_Logger.LogError(string.Format("Failed to commit migration of %1 records - Status: %2", migrated, commitStatus), 
+                    "STS_PlayerStatsRepository", "MigrateLegacyRecords");
+                return -1;
+            }
+        }
+        catch (Exception e)
+        {
+            transaction.Rollback();
+            m_Logger.LogError(string.Format("Exception in MigrateLegacyRecords: %1", e.ToString()), 
+                "STS_PlayerStatsRepository", "MigrateLegacyRecords", e.GetStackTrace());
+            return -1;
+        }
+        
+        return migrated;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get top players by score (for leaderboards)
     array<ref STS_PlayerStats> GetTopPlayers(int limit = 10)
@@ -636,6 +885,7 @@ class STS_PlayerStatsRepository
             // Convert entities to stats
             foreach (STS_PlayerStatsEntity entity : entities)
             {
+                CacheEntityRef(entity);
                 STS_PlayerStats stats = entity.ToPlayerStats();
                 result.Insert(stats);
             }
@@ -651,9 +901,20 @@ class STS_PlayerStatsRepository
     }
     
     //------------------------------------------------------------------------------------------------
-    // Delete player statistics with comprehensive error handling, transaction support, and retry logic
+    // Delete player statistics with comprehensive error handling and transaction support.
+    // This is a single attempt - use DeletePlayerStatsAsync to have failures retried off the game thread.
     bool DeletePlayerStats(string playerUID)
     {
+        bool notFound;
+        return TryDeletePlayerStats(playerUID, notFound);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Single delete attempt; notFound is set when there was nothing to delete, which is not worth retrying
+    bool TryDeletePlayerStats(string playerUID, out bool notFound)
+    {
+        notFound = false;
+        
         // Start measuring operation time for performance monitoring
         float startTime = System.GetTickCount() / 1000.0;
         
@@ -680,48 +941,9 @@ class STS_PlayerStatsRepository
         
         try
         {
-            // Find player in the database with retry logic
-            STS_PlayerStatsEntity entity = null;
-            Exception lastException = null;
+            // Find player in the database
             EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").Equals(playerUID);
-            
-            // Retry query up to 3 times in case of temporary failures
-            for (int attempt = 1; attempt <= 3; attempt++)
-            {
-                try
-                {
-                    entity = m_Repository.FindFirst(condition);
-                    lastException = null; // Clear exception if query succeeds
-                    break; // Success, exit retry loop
-                }
-                catch (Exception queryEx)
-                {
-                    lastException = queryEx;
-                    
-                    if (m_Logger)
-                        m_Logger.LogWarning(string.Format("Query attempt %1 failed for UID %2: %3", 
-                            attempt, playerUID, queryEx.ToString()), 
-                            "STS_PlayerStatsRepository", "DeletePlayerStats");
-                    
-                    if (attempt < 3)
-                    {
-                        // Sleep before retry with increasing delay
-                        int delayMs = 50 * attempt;
-                        Sleep(delayMs);
-                    }
-                }
-            }
-            
-            // If we have a persistent exception after retries, log and rethrow
-            if (lastException)
-            {
-                if (m_Logger)
-                    m_Logger.LogError(string.Format("All query attempts failed for UID %1: %2", 
-                        playerUID, lastException.ToString()), 
-                        "STS_PlayerStatsRepository", "DeletePlayerStats", lastException.GetStackTrace());
-                
-                throw lastException;
-            }
+            STS_PlayerStatsEntity entity = m_Repository.FindFirst(condition);
             
             if (entity)
             {
@@ -746,34 +968,8 @@ class STS_PlayerStatsRepository
                         m_Logger.LogDebug(string.Format("Found player stats to delete - UID: %1, Name: %2", 
                             playerUID, entity.m_sPlayerName), "STS_PlayerStatsRepository", "DeletePlayerStats");
                     
-                    // Delete with retry logic
-                    EDF_EDbOperationStatusCode statusCode = EDF_EDbOperationStatusCode.ERROR;
-                    
-                    for (int attempt = 1; attempt <= 3; attempt++)
-                    {
-                        try
-                        {
-                            statusCode = m_Repository.Remove(entity);
-                            break; // Success or definitive failure, exit retry loop
-                        }
-                        catch (Exception deleteEx)
-                        {
-                            if (attempt == 3)
-                            {
-                                // Rethrow on final attempt
-                                throw deleteEx;
-                            }
-                            
-                            if (m_Logger)
-                                m_Logger.LogWarning(string.Format("Delete attempt %1 failed for UID %2: %3", 
-                                    attempt, playerUID, deleteEx.ToString()), 
-                                    "STS_PlayerStatsRepository", "DeletePlayerStats");
-                            
-                            // Sleep before retry with increasing delay
-                            int delayMs = 50 * attempt;
-                            Sleep(delayMs);
-                        }
-                    }
+                    // Delete the entity
+                    EDF_EDbOperationStatusCode statusCode = m_Repository.Remove(entity);
                     
                     success = statusCode == EDF_EDbOperationStatusCode.SUCCESS;
                     
@@ -804,6 +1000,8 @@ class STS_PlayerStatsRepository
                         }
                         else
                         {
+                            m_mEntityRefs.Remove(playerUID);
+                            
                             // Log successful deletion with some details for auditing
                             if (m_Logger)
                             {
@@ -844,6 +1042,8 @@ class STS_PlayerStatsRepository
             else
             {
                 // No stats found for this player
+                notFound = true;
+                m_mEntityRefs.Remove(playerUID);
                 if (m_Logger)
                     m_Logger.LogWarning(string.Format("No player stats found for deletion - UID: %1", playerUID), 
                         "STS_PlayerStatsRepository", "DeletePlayerStats");
@@ -882,6 +1082,177 @@ class STS_PlayerStatsRepository
             return false;
         }
     }
+    
+    //------------------------------------------------------------------------------------------------
+    // Look up the cached entity reference for a player, counting hits and misses
+    protected STS_PlayerStatsEntityRef LookupEntityRef(string playerUID)
+    {
+        STS_PlayerStatsEntityRef entityRef = m_mEntityRefs.Get(playerUID);
+        if (entityRef)
+            m_iEntityRefHits++;
+        else
+            m_iEntityRefMisses++;
+        
+        return entityRef;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load the stored entity of a known player by its cached ID, null if that record is gone
+    protected STS_PlayerStatsEntity FindEntityByRef(STS_PlayerStatsEntityRef entityRef)
+    {
+        return m_Repository.FindFirst(EDF_DbFind.Id().Equals(entityRef.m_sEntityId));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Remember the stored ID of an entity that was loaded or written
+    void CacheEntityRef(STS_PlayerStatsEntity entity)
+    {
+        if (!entity || entity.m_sPlayerUID.IsEmpty() || !entity.HasId())
+            return;
+        
+        m_mEntityRefs.Set(entity.m_sPlayerUID, new STS_PlayerStatsEntityRef(entity.GetId(), entity.m_fCreationTime));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Re-check cached IDs against the database, e.g. after a reconnect. Entries whose record is gone or
+    // was recreated under a different ID are dropped. Returns the number of entries removed.
+    int ValidateEntityRefCache()
+    {
+        if (!m_Repository || m_mEntityRefs.IsEmpty())
+            return 0;
+        
+        array<string> cachedUIDs = new array<string>();
+        foreach (string playerUID, STS_PlayerStatsEntityRef entityRef : m_mEntityRefs)
+        {
+            cachedUIDs.Insert(playerUID);
+        }
+        
+        int removed = 0;
+        
+        try
+        {
+            map<string, string> storedIds = new map<string, string>();
+            EDF_DbFindCondition condition = EDF_DbFind.Field("m_sPlayerUID").EqualsAnyOf(EDF_DbValues<string>.From(cachedUIDs));
+            array<ref STS_PlayerStatsEntity> found = m_Repository.FindAll(condition);
+            if (found)
+            {
+                foreach (STS_PlayerStatsEntity entity : found)
+                {
+                    storedIds.Set(entity.m_sPlayerUID, entity.GetId());
+                }
+            }
+            
+            foreach (string playerUID : cachedUIDs)
+            {
+                string storedId;
+                if (!storedIds.Find(playerUID, storedId) || storedId != m_mEntityRefs.Get(playerUID).m_sEntityId)
+                {
+                    m_mEntityRefs.Remove(playerUID);
+                    removed++;
+                }
+            }
+        }
+        catch (Exception e)
+        {
+            // Cannot verify - start cold rather than trust possibly stale IDs
+            removed = m_mEntityRefs.Count();
+            m_mEntityRefs.Clear();
+            
+            if (m_Logger)
+                m_Logger.LogWarning(string.Format("Entity ID cache validation failed, cache cleared: %1", e.ToString()),
+                    "STS_PlayerStatsRepository", "ValidateEntityRefCache");
+        }
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Validated entity ID cache: %1 kept, %2 dropped", m_mEntityRefs.Count(), removed),
+                "STS_PlayerStatsRepository", "ValidateEntityRefCache");
+        
+        return removed;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Hand the cache to a replacement repository (after a reconnect); the receiver validates it
+    map<string, ref STS_PlayerStatsEntityRef> GetEntityRefCache()
+    {
+        return m_mEntityRefs;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void AdoptEntityRefCache(map<string, ref STS_PlayerStatsEntityRef> entityRefs)
+    {
+        if (!entityRefs)
+            return;
+        
+        foreach (string playerUID, STS_PlayerStatsEntityRef entityRef : entityRefs)
+        {
+            m_mEntityRefs.Set(playerUID, entityRef);
+        }
+        
+        ValidateEntityRefCache();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void ClearEntityRefCache()
+    {
+        m_mEntityRefs.Clear();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get entity ID cache statistics
+    void GetEntityRefCacheStatistics(out int hits, out int misses, out int size)
+    {
+        hits = m_iEntityRefHits;
+        misses = m_iEntityRefMisses;
+        size = m_mEntityRefs.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Save player statistics through the retry scheduler. Failed attempts are retried with backoff on
+    // the callqueue; the callback receives the final outcome.
+    void SavePlayerStatsAsync(string playerUID, string playerName, STS_PlayerStats stats, func<bool> callback = null)
+    {
+        // Invalid input will never succeed, so fail fast instead of retrying
+        if (playerUID.IsEmpty() || !stats || !ValidatePlayerStats(stats))
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Invalid save request for %1 (UID: %2) - not scheduled", 
+                    playerName, playerUID), "STS_PlayerStatsRepository", "SavePlayerStatsAsync");
+            
+            if (callback)
+                callback(false);
+            return;
+        }
+        
+        STS_RetryScheduler.GetInstance().Submit(new STS_SavePlayerStatsOperation(this, playerUID, playerName, stats, callback));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load player statistics through the retry scheduler; the callback receives null if every attempt failed
+    void LoadPlayerStatsWithRetry(string playerUID, func<STS_PlayerStats> callback)
+    {
+        if (playerUID.IsEmpty())
+        {
+            if (callback)
+                callback(null);
+            return;
+        }
+        
+        STS_RetryScheduler.GetInstance().Submit(new STS_LoadPlayerStatsOperation(this, playerUID, callback));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Delete player statistics through the retry scheduler. A missing record is not retried.
+    void DeletePlayerStatsAsync(string playerUID, func<bool> callback = null)
+    {
+        if (playerUID.IsEmpty())
+        {
+            if (callback)
+                callback(false);
+            return;
+        }
+        
+        STS_RetryScheduler.GetInstance().Submit(new STS_DeletePlayerStatsOperation(this, playerUID, callback));
+    }
 }
 
 //------------------------------------------------------------------------------------------------
@@ -892,14 +1263,16 @@ class STS_LoadPlayerStatsCallback : EDF_DbFindCallbackSingle<STS_PlayerStatsEnti
     protected string m_sPlayerUID;
     protected STS_LoggingSystem m_Logger;
     protected float m_fStartTime;
+    protected STS_PlayerStatsRepository m_Repository;
     
     //------------------------------------------------------------------------------------------------
-    void STS_LoadPlayerStatsCallback(func<STS_PlayerStats> callback, string playerUID, STS_LoggingSystem logger, float startTime)
+    void STS_LoadPlayerStatsCallback(func<STS_PlayerStats> callback, string playerUID, STS_LoggingSystem logger, float startTime, STS_PlayerStatsRepository repository = null)
     {
         m_Callback = callback;
         m_sPlayerUID = playerUID;
         m_Logger = logger;
         m_fStartTime = startTime;
+        m_Repository = repository;
     }
     
     //------------------------------------------------------------------------------------------------
@@ -911,6 +1284,9 @@ class STS_LoadPlayerStatsCallback : EDF_DbFindCallbackSingle<STS_PlayerStatsEnti
             
             if (result)
             {
+                if (m_Repository)
+                    m_Repository.CacheEntityRef(result);
+                
                 // Convert entity to stats
                 stats = result.ToPlayerStats();
                 
@@ -968,9 +1344,9 @@ class STS_LoadPlayerStatsCallback : EDF_DbFindCallbackSingle<STS_PlayerStatsEnti
                     "STS_LoadPlayerStatsCallback", "OnSuccess", e.GetStackTrace());
             }
             
-            // Ensure callback is called even on error
+            // Ensure callback is called even on error; null so the failure is not taken for a new player
             if (m_Callback)
-                m_Callback(new STS_PlayerStats());
+                m_Callback(null);
         }
     }
     
@@ -991,9 +1367,9 @@ class STS_LoadPlayerStatsCallback : EDF_DbFindCallbackSingle<STS_PlayerStatsEnti
                 "STS_LoadPlayerStatsCallback", "OnFailure");
         }
         
-        // Always return an empty stats object on failure
+        // Null rather than empty stats, so the failure is neither cached nor taken for a new player
         if (m_Callback)
-            m_Callback(new STS_PlayerStats());
+            m_Callback(null);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -1026,4 +1402,129 @@ class STS_LoadPlayerStatsCallback : EDF_DbFindCallbackSingle<STS_PlayerStatsEnti
         
         return true;
     }
-} 
\ No newline at end of file
+} 
+
+//------------------------------------------------------------------------------------------------
+// Retryable save of one player's statistics
+class STS_SavePlayerStatsOperation : STS_RetryableOperation
+{
+    protected STS_PlayerStatsRepository m_Repository;
+    protected string m_sPlayerUID;
+    protected string m_sPlayerName;
+    protected ref STS_PlayerStats m_Stats;
+    protected func<bool> m_Callback;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_SavePlayerStatsOperation(STS_PlayerStatsRepository repository, string playerUID, string playerName, STS_PlayerStats stats, func<bool> callback)
+    {
+        m_sName = "SavePlayerStats(" + playerUID + ")";
+        m_Repository = repository;
+        m_sPlayerUID = playerUID;
+        m_sPlayerName = playerName;
+        m_Stats = stats;
+        m_Callback = callback;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool Execute()
+    {
+        if (!m_Repository)
+        {
+            Abort();
+            return false;
+        }
+        
+        return m_Repository.SavePlayerStats(m_sPlayerUID, m_sPlayerName, m_Stats);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (m_Callback)
+            m_Callback(success);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Retryable load of one player's statistics
+class STS_LoadPlayerStatsOperation : STS_RetryableOperation
+{
+    protected STS_PlayerStatsRepository m_Repository;
+    protected string m_sPlayerUID;
+    protected ref STS_PlayerStats m_Result;
+    protected func<STS_PlayerStats> m_Callback;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_LoadPlayerStatsOperation(STS_PlayerStatsRepository repository, string playerUID, func<STS_PlayerStats> callback)
+    {
+        m_sName = "LoadPlayerStats(" + playerUID + ")";
+        m_Repository = repository;
+        m_sPlayerUID = playerUID;
+        m_Callback = callback;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool Execute()
+    {
+        if (!m_Repository)
+        {
+            Abort();
+            return false;
+        }
+        
+        // LoadPlayerStats returns fresh stats for unknown players and null only on failure
+        m_Result = m_Repository.LoadPlayerStats(m_sPlayerUID);
+        return m_Result != null;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (m_Callback)
+            m_Callback(m_Result);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Retryable delete of one player's statistics
+class STS_DeletePlayerStatsOperation : STS_RetryableOperation
+{
+    protected STS_PlayerStatsRepository m_Repository;
+    protected string m_sPlayerUID;
+    protected func<bool> m_Callback;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_DeletePlayerStatsOperation(STS_PlayerStatsRepository repository, string playerUID, func<bool> callback)
+    {
+        m_sName = "DeletePlayerStats(" + playerUID + ")";
+        m_Repository = repository;
+        m_sPlayerUID = playerUID;
+        m_Callback = callback;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool Execute()
+    {
+        if (!m_Repository)
+        {
+            Abort();
+            return false;
+        }
+        
+        bool notFound;
+        bool success = m_Repository.TryDeletePlayerStats(m_sPlayerUID, notFound);
+        
+        // Nothing to delete - retrying will not change that
+        if (notFound)
+            Abort();
+        
+        return success;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (m_Callback)
+            m_Callback(success);
+    }
+}
@@ -0,0 +1,322 @@
+// STS_PlayerStatsShardStore.c
+// Hash-partitioned file store for player stats. Players are spread over N shard files by a hash of their UID,
+// each shard using the player_stats.json cache layout with its own byte-range index. A save only rewrites the
+// shards that hold changed players, one shard per frame, and shard indexes are loaded in batches across frames.
+
+class STS_PlayerStatsShardStore
+{
+    protected string m_sDirectory;
+    protected int m_iShardCount;
+    
+    // Per-shard byte-range indexes; null until the shard has been loaded
+    protected ref array<ref STS_PlayerStatsFileIndex> m_aShardIndexes = new array<ref STS_PlayerStatsFileIndex>();
+    protected int m_iNextShardToLoad = 0;
+    
+    // Changed players waiting to be written, per shard
+    protected ref map<int, ref map<string, ref STS_PlayerStats>> m_mPendingWrites = new map<int, ref map<string, ref STS_PlayerStats>>();
+    protected ref array<int> m_aDirtyShards = new array<int>();
+    
+    // Configuration
+    protected int m_iShardsLoadedPerFrame = 4;
+    protected int m_iShardsWrittenPerFrame = 1;
+    
+    // Statistics
+    protected int m_iShardWrites = 0;
+    protected int m_iPlayersWritten = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsShardStore(string directory = "$profile:StatTracker/Shards/", int shardCount = 16)
+    {
+        m_sDirectory = directory;
+        m_iShardCount = Math.Max(1, shardCount);
+        m_Logger = STS_LoggingSystem.GetInstance();
+        
+        m_aShardIndexes.Resize(m_iShardCount);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_PlayerStatsShardStore()
+    {
+        GetGame().GetCallqueue().Remove(LoadNextShards);
+        GetGame().GetCallqueue().Remove(WriteNextShards);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Begin loading shard indexes in batches across frames; shards needed earlier are loaded on demand
+    void StartLoading()
+    {
+        if (!FileIO.FileExists(m_sDirectory))
+            FileIO.MakeDirectory(m_sDirectory);
+        
+        m_iNextShardToLoad = 0;
+        GetGame().GetCallqueue().CallLater(LoadNextShards, 0, true);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void LoadNextShards()
+    {
+        int loaded = 0;
+        while (m_iNextShardToLoad < m_iShardCount && loaded < m_iShardsLoadedPerFrame)
+        {
+            EnsureShardLoaded(m_iNextShardToLoad);
+            m_iNextShardToLoad++;
+            loaded++;
+        }
+        
+        if (m_iNextShardToLoad < m_iShardCount)
+            return;
+        
+        GetGame().GetCallqueue().Remove(LoadNextShards);
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Indexed %1 players across %2 stat shards", GetPlayerCount(), m_iShardCount),
+                "STS_PlayerStatsShardStore", "LoadNextShards");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected STS_PlayerStatsFileIndex EnsureShardLoaded(int shard)
+    {
+        STS_PlayerStatsFileIndex index = m_aShardIndexes[shard];
+        if (index)
+            return index;
+        
+        index = new STS_PlayerStatsFileIndex();
+        index.Load(GetShardPath(shard));
+        m_aShardIndexes[shard] = index;
+        return index;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetShard(string playerUID)
+    {
+        return Math.AbsInt(playerUID.Hash()) % m_iShardCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool Contains(string playerUID)
+    {
+        int shard = GetShard(playerUID);
+        map<string, ref STS_PlayerStats> pending = m_mPendingWrites.Get(shard);
+        if (pending && pending.Contains(playerUID))
+            return true;
+        
+        return EnsureShardLoaded(shard).Contains(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read a player's stored stats object; a pending unwritten save is returned first
+    STS_PlayerStats Load(string playerUID)
+    {
+        int shard = GetShard(playerUID);
+        map<string, ref STS_PlayerStats> pending = m_mPendingWrites.Get(shard);
+        if (pending && pending.Contains(playerUID))
+            return pending.Get(playerUID);
+        
+        string json = EnsureShardLoaded(shard).ReadRecord(playerUID);
+        if (json.IsEmpty())
+            return null;
+        
+        STS_PlayerStats stats = new STS_PlayerStats();
+        if (!stats.FromJSON(json))
+            return null;
+        
+        return stats;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queue a changed player; only that player's shard is rewritten. The stats are frozen now so the shard
+    // written frames later holds a consistent view.
+    void MarkChanged(string playerUID, STS_PlayerStats stats)
+    {
+        if (playerUID.IsEmpty() || !stats)
+            return;
+        
+        int shard = GetShard(playerUID);
+        map<string, ref STS_PlayerStats> pending = m_mPendingWrites.Get(shard);
+        if (!pending)
+        {
+            pending = new map<string, ref STS_PlayerStats>();
+            m_mPendingWrites.Set(shard, pending);
+        }
+        
+        pending.Set(playerUID, stats.CreateSnapshot());
+        
+        if (m_aDirtyShards.Find(shard) == -1)
+        {
+            m_aDirtyShards.Insert(shard);
+            
+            if (m_aDirtyShards.Count() == 1)
+                GetGame().GetCallqueue().CallLater(WriteNextShards, 0, true);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void WriteNextShards()
+    {
+        for (int i = 0; i < m_iShardsWrittenPerFrame && !m_aDirtyShards.IsEmpty(); i++)
+        {
+            int shard = m_aDirtyShards[0];
+            m_aDirtyShards.RemoveOrdered(0);
+            WriteShard(shard);
+        }
+        
+        if (m_aDirtyShards.IsEmpty())
+            GetGame().GetCallqueue().Remove(WriteNextShards);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write every dirty shard now, e.g. on shutdown
+    void FlushAll()
+    {
+        GetGame().GetCallqueue().Remove(WriteNextShards);
+        m_aDirtyShards.Clear();
+        
+        // Includes shards whose last write failed
+        array<int> shards = new array<int>();
+        foreach (int shard, map<string, ref STS_PlayerStats> pending : m_mPendingWrites)
+        {
+            shards.Insert(shard);
+        }
+        
+        foreach (int shard : shards)
+        {
+            WriteShard(shard);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Rewrite one shard: unchanged players are copied as raw slices, changed players are re-serialized
+    protected bool WriteShard(int shard)
+    {
+        map<string, ref STS_PlayerStats> pending = m_mPendingWrites.Get(shard);
+        if (!pending || pending.IsEmpty())
+            return true;
+        
+        string shardPath = GetShardPath(shard);
+        string tempPath = shardPath + ".tmp";
+        
+        FileHandle output = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!output)
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Failed to open %1 - shard %2 is retried when it changes again or on shutdown", tempPath, shard),
+                    "STS_PlayerStatsShardStore", "WriteShard");
+            
+            return false;
+        }
+        
+        output.WriteLine("{\"players\":{");
+        
+        // The index is built from the positions the records are written at
+        STS_PlayerStatsFileIndex index = new STS_PlayerStatsFileIndex();
+        index.Begin(shardPath);
+        
+        int written = 0;
+        
+        STS_PlayerStatsFileReader reader = new STS_PlayerStatsFileReader();
+        if (reader.Open(shardPath))
+        {
+            string playerUID;
+            string playerJson;
+            while (reader.Next(playerUID, playerJson))
+            {
+                if (pending.Contains(playerUID))
+                    continue;
+                
+                WriteRecord(output, index, written, playerUID, playerJson);
+                written++;
+            }
+        }
+        
+        foreach (string uid, STS_PlayerStats stats : pending)
+        {
+            WriteRecord(output, index, written, uid, stats.ToJSON());
+            written++;
+        }
+        
+        output.WriteLine("}}");
+        output.Close();
+        
+        // Offsets are about to move; an index left over from a failed copy must not be trusted
+        STS_PlayerStatsFileIndex.Invalidate(shardPath);
+        
+        if (!FileIO.CopyFile(tempPath, shardPath))
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Failed to replace shard %1", shardPath), "STS_PlayerStatsShardStore", "WriteShard");
+            
+            return false;
+        }
+        
+        FileIO.DeleteFile(tempPath);
+        
+        m_iShardWrites++;
+        m_iPlayersWritten += pending.Count();
+        m_mPendingWrites.Remove(shard);
+        
+        index.Save();
+        m_aShardIndexes[shard] = index;
+        
+        if (m_Logger)
+            m_Logger.LogDebug(string.Format("Rewrote stat shard %1: %2 players", shard, written),
+                "STS_PlayerStatsShardStore", "WriteShard");
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write one "uid":{...} line and record where its key and object landed
+    protected void WriteRecord(FileHandle output, STS_PlayerStatsFileIndex index, int position, string playerUID, string playerJson)
+    {
+        string separator = "";
+        if (position > 0)
+            separator = ",";
+        
+        int keyOffset = output.GetPos() + separator.Length();
+        int offset = keyOffset + playerUID.Length() + 3;
+        
+        output.WriteLine(string.Format("%1\"%2\":%3", separator, playerUID, playerJson));
+        index.AddEntry(playerUID, keyOffset, offset, playerJson.Length());
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GetShardPath(int shard)
+    {
+        return string.Format("%1player_stats_%2.json", m_sDirectory, shard.ToString().PadLeft(3, "0"));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Number of indexed players in the shards loaded so far
+    int GetPlayerCount()
+    {
+        int count = 0;
+        foreach (STS_PlayerStatsFileIndex index : m_aShardIndexes)
+        {
+            if (index)
+                count += index.Count();
+        }
+        return count;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetShardCount()
+    {
+        return m_iShardCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetDirtyShardCount()
+    {
+        return m_aDirtyShards.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get shard write statistics
+    void GetStatistics(out int shardWrites, out int playersWritten)
+    {
+        shardWrites = m_iShardWrites;
+        playersWritten = m_iPlayersWritten;
+    }
+}
@@ -0,0 +1,289 @@
+// STS_PlayerStatsWriteBehind.c
+// Write-behind buffer that collects player stat saves and flushes them as one batched upsert
+
+//------------------------------------------------------------------------------------------------
+// A single queued save and its outcome after a flush
+class STS_PlayerStatsSaveRecord
+{
+    string m_sPlayerUID;
+    string m_sPlayerName;
+    ref STS_PlayerStats m_Stats;
+    ref STS_PlayerStats m_Snapshot; // Frozen copy taken when the flush starts; this is what gets written
+    int m_iStatsVersion;    // Stats version captured at enqueue and again at snapshot, used to clear the dirty flags after a save
+    int m_iLoggedVersion;   // Stats version last written to the write-ahead log, -1 if never logged
+    float m_fEnqueueTime;
+    int m_iAttempts;
+    bool m_bSuccess;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsSaveRecord(string playerUID, string playerName, STS_PlayerStats stats)
+    {
+        m_sPlayerUID = playerUID;
+        m_sPlayerName = playerName;
+        m_Stats = stats;
+        m_iStatsVersion = stats.GetVersion();
+        m_fEnqueueTime = System.GetTickCount() / 1000.0;
+        m_iAttempts = 0;
+        m_iLoggedVersion = -1;
+        m_bSuccess = false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // The snapshot while a flush is running, otherwise the live stats
+    STS_PlayerStats GetStatsToWrite()
+    {
+        if (m_Snapshot)
+            return m_Snapshot;
+        
+        return m_Stats;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Per-record result of a flush
+class STS_PlayerStatsFlushResult
+{
+    ref array<string> m_aSucceededUIDs = new array<string>();
+    ref array<string> m_aFailedUIDs = new array<string>();
+    float m_fDurationMs;
+    
+    //------------------------------------------------------------------------------------------------
+    int GetSuccessCount()
+    {
+        return m_aSucceededUIDs.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetFailureCount()
+    {
+        return m_aFailedUIDs.Count();
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_PlayerStatsWriteBehind
+{
+    // Pending saves keyed by player UID - a newer save for the same player replaces the older one
+    protected ref map<string, ref STS_PlayerStatsSaveRecord> m_mPending = new map<string, ref STS_PlayerStatsSaveRecord>();
+    
+    // Configuration
+    protected int m_iMaxBatchSize = 256;         // Records per upsert; larger windows are split
+    protected const int MAX_ATTEMPTS_WARNING = 5; // Warn when a record keeps failing
+    
+    // Statistics
+    protected int m_iTotalFlushes = 0;
+    protected int m_iTotalRecordsSaved = 0;
+    protected int m_iTotalRecordsFailed = 0;
+    protected float m_fTotalSnapshotMs = 0;
+    protected int m_iTotalSnapshots = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    protected STS_PerformanceMonitor m_PerformanceMonitor;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_PlayerStatsWriteBehind()
+    {
+        m_Logger = STS_LoggingSystem.GetInstance();
+        m_PerformanceMonitor = STS_PerformanceMonitor.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queue a player's stats for the next flush
+    void Enqueue(string playerUID, string playerName, STS_PlayerStats stats)
+    {
+        if (playerUID.IsEmpty() || !stats)
+            return;
+        
+        STS_PlayerStatsSaveRecord existing = m_mPending.Get(playerUID);
+        if (existing)
+        {
+            // Coalesce: keep attempt count so repeated failures remain visible
+            existing.m_sPlayerName = playerName;
+            existing.m_Stats = stats;
+            existing.m_iStatsVersion = stats.GetVersion();
+            return;
+        }
+        
+        m_mPending.Insert(playerUID, new STS_PlayerStatsSaveRecord(playerUID, playerName, stats));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write pending records through the repository as batched upserts; at most maxRecords (-1 for all)
+    // are written, the rest stay pending for the next flush
+    STS_PlayerStatsFlushResult Flush(STS_PlayerStatsRepository repository, int maxRecords = -1)
+    {
+        STS_PlayerStatsFlushResult result = new STS_PlayerStatsFlushResult();
+        
+        if (m_mPending.IsEmpty())
+            return result;
+        
+        if (!repository)
+        {
+            if (m_Logger)
+                m_Logger.LogWarning(string.Format("No repository available - keeping %1 pending saves for next flush",
+                    m_mPending.Count()), "STS_PlayerStatsWriteBehind", "Flush");
+            
+            foreach (string uid, STS_PlayerStatsSaveRecord pending : m_mPending)
+            {
+                result.m_aFailedUIDs.Insert(uid);
+            }
+            return result;
+        }
+        
+        float startTime = 0;
+        if (m_PerformanceMonitor)
+            startTime = m_PerformanceMonitor.StartMeasurement("STS_PlayerStatsWriteBehind", "Flush");
+        float flushStart = System.GetTickCount();
+        
+        // Detach the current window so saves queued during the flush land in the next one
+        map<string, ref STS_PlayerStatsSaveRecord> window = m_mPending;
+        m_mPending = new map<string, ref STS_PlayerStatsSaveRecord>();
+        
+        if (maxRecords >= 0 && window.Count() > maxRecords)
+        {
+            // Hand the records beyond the limit back to the pending map
+            int kept = 0;
+            foreach (string windowUID, STS_PlayerStatsSaveRecord windowRecord : window)
+            {
+                if (kept++ >= maxRecords)
+                    m_mPending.Insert(windowUID, windowRecord);
+            }
+            foreach (string deferredUID, STS_PlayerStatsSaveRecord deferred : m_mPending)
+            {
+                window.Remove(deferredUID);
+            }
+        }
+        
+        // Freeze every record at one point in time; gameplay may keep changing the live stats while the batches
+        // are written
+        float snapshotStart = System.GetTickCount();
+        foreach (string snapshotUID, STS_PlayerStatsSaveRecord snapshotRecord : window)
+        {
+            snapshotRecord.m_iStatsVersion = snapshotRecord.m_Stats.GetVersion();
+            snapshotRecord.m_Snapshot = snapshotRecord.m_Stats.CreateSnapshot();
+        }
+        m_fTotalSnapshotMs += System.GetTickCount() - snapshotStart;
+        m_iTotalSnapshots += window.Count();
+        
+        array<ref STS_PlayerStatsSaveRecord> batch = new array<ref STS_PlayerStatsSaveRecord>();
+        foreach (string uid, STS_PlayerStatsSaveRecord record : window)
+        {
+            record.m_iAttempts++;
+            batch.Insert(record);
+            
+            if (batch.Count() >= m_iMaxBatchSize)
+            {
+                FlushBatch(repository, batch, result);
+                batch.Clear();
+            }
+        }
+        
+        if (!batch.IsEmpty())
+            FlushBatch(repository, batch, result);
+        
+        result.m_fDurationMs = System.GetTickCount() - flushStart;
+        
+        if (m_PerformanceMonitor)
+            m_PerformanceMonitor.EndBatchMeasurement("STS_PlayerStatsWriteBehind", "Flush", startTime, window.Count());
+        
+        m_iTotalFlushes++;
+        m_iTotalRecordsSaved += result.GetSuccessCount();
+        m_iTotalRecordsFailed += result.GetFailureCount();
+        
+        if (m_Logger)
+        {
+            m_Logger.LogDebug(string.Format("Flushed %1 records in %2 ms: %3 saved, %4 failed",
+                window.Count(), result.m_fDurationMs, result.GetSuccessCount(), result.GetFailureCount()),
+                "STS_PlayerStatsWriteBehind", "Flush");
+        }
+        
+        return result;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Upsert one batch and requeue the records that failed
+    protected void FlushBatch(STS_PlayerStatsRepository repository, array<ref STS_PlayerStatsSaveRecord> batch, STS_PlayerStatsFlushResult result)
+    {
+        repository.SavePlayerStatsBatch(batch);
+        
+        foreach (STS_PlayerStatsSaveRecord record : batch)
+        {
+            // A requeued record is snapshotted again on its next flush
+            record.m_Snapshot = null;
+            
+            if (record.m_bSuccess)
+            {
+                // Stays dirty if the player changed again while the flush was running
+                record.m_Stats.MarkPersisted(record.m_iStatsVersion);
+                result.m_aSucceededUIDs.Insert(record.m_sPlayerUID);
+                continue;
+            }
+            
+            result.m_aFailedUIDs.Insert(record.m_sPlayerUID);
+            
+            if (record.m_iAttempts >= MAX_ATTEMPTS_WARNING && m_Logger)
+            {
+                m_Logger.LogWarning(string.Format("Save for %1 (UID: %2) has failed %3 flushes in a row",
+                    record.m_sPlayerName, record.m_sPlayerUID, record.m_iAttempts),
+                    "STS_PlayerStatsWriteBehind", "FlushBatch");
+            }
+            
+            // Requeue unless a newer save for this player arrived during the flush
+            if (!m_mPending.Contains(record.m_sPlayerUID))
+                m_mPending.Insert(record.m_sPlayerUID, record);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetPendingCount()
+    {
+        return m_mPending.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool HasPending(string playerUID)
+    {
+        return m_mPending.Contains(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    STS_PlayerStatsSaveRecord GetPending(string playerUID)
+    {
+        return m_mPending.Get(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Collect the records waiting for the next flush
+    void GetPendingRecords(notnull array<STS_PlayerStatsSaveRecord> records)
+    {
+        foreach (string uid, STS_PlayerStatsSaveRecord record : m_mPending)
+        {
+            records.Insert(record);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetMaxBatchSize(int maxBatchSize)
+    {
+        m_iMaxBatchSize = Math.Max(1, maxBatchSize);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get flush statistics
+    void GetStatistics(out int totalFlushes, out int totalSaved, out int totalFailed)
+    {
+        totalFlushes = m_iTotalFlushes;
+        totalSaved = m_iTotalRecordsSaved;
+        totalFailed = m_iTotalRecordsFailed;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Average cost of freezing one player's stats at flush time, in microseconds
+    float GetAverageSnapshotCostUs()
+    {
+        if (m_iTotalSnapshots == 0)
+            return 0;
+        
+        return m_fTotalSnapshotMs * 1000 / m_iTotalSnapshots;
+    }
+}
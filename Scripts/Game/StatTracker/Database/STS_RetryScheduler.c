@@ -0,0 +1,289 @@
+// STS_RetryScheduler.c
+// Non-blocking retry engine: failed database operations are parked on the callqueue with
+// exponential backoff instead of sleeping on the game thread
+
+//------------------------------------------------------------------------------------------------
+// Base class for an operation the scheduler can retry. Subclasses override Execute and OnComplete.
+class STS_RetryableOperation
+{
+    protected string m_sName;       // Used in log messages; set by subclasses
+    int m_iAttempts;                // Attempts made so far
+    int m_iMaxAttempts = -1;        // -1 uses the scheduler default
+    protected bool m_bAborted;      // Set by Execute to stop retrying a failure that will not go away
+    
+    //------------------------------------------------------------------------------------------------
+    // Perform one attempt. Return true on success; returning false or throwing schedules a retry.
+    bool Execute()
+    {
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Called exactly once with the final outcome
+    void OnComplete(bool success)
+    {
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Give up without further retries (e.g. validation failed)
+    void Abort()
+    {
+        m_bAborted = true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsAborted()
+    {
+        return m_bAborted;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    string GetName()
+    {
+        return m_sName;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_RetryScheduler
+{
+    // Singleton instance
+    private static ref STS_RetryScheduler s_Instance;
+    
+    // Operations that are running or waiting for their next attempt; they hold an in-flight slot
+    protected ref array<ref STS_RetryableOperation> m_aInFlight = new array<ref STS_RetryableOperation>();
+    
+    // Operations waiting for a free in-flight slot, oldest first
+    protected ref array<ref STS_RetryableOperation> m_aWaiting = new array<ref STS_RetryableOperation>();
+    
+    // Configuration
+    protected int m_iMaxInFlight = 32;        // Global cap on concurrently active operations
+    protected int m_iMaxAttempts = 5;         // Default attempts before giving up
+    protected int m_iBaseDelayMs = 50;        // Delay before the first retry
+    protected int m_iMaxDelayMs = 5000;       // Backoff ceiling
+    protected float m_fJitter = 0.5;          // Fraction of each delay that is randomized
+    
+    // Statistics
+    protected int m_iTotalSubmitted = 0;
+    protected int m_iTotalSucceeded = 0;
+    protected int m_iTotalFailed = 0;
+    protected int m_iTotalRetries = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_RetryScheduler()
+    {
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    static STS_RetryScheduler GetInstance()
+    {
+        if (!s_Instance)
+            s_Instance = new STS_RetryScheduler();
+        
+        return s_Instance;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Submit an operation. The first attempt runs on the next callqueue tick, never inside the caller.
+    void Submit(STS_RetryableOperation operation)
+    {
+        if (!operation)
+            return;
+        
+        m_iTotalSubmitted++;
+        operation.m_iAttempts = 0;
+        
+        if (m_aInFlight.Count() >= m_iMaxInFlight)
+        {
+            m_aWaiting.Insert(operation);
+            
+            if (m_Logger)
+                m_Logger.LogDebug(string.Format("In-flight cap (%1) reached - parked %2, %3 waiting",
+                    m_iMaxInFlight, operation.GetName(), m_aWaiting.Count()), "STS_RetryScheduler", "Submit");
+            return;
+        }
+        
+        Start(operation, 0);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Start(STS_RetryableOperation operation, int delayMs)
+    {
+        m_aInFlight.Insert(operation);
+        GetGame().GetCallqueue().CallLater(RunAttempt, delayMs, false, operation);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void RunAttempt(STS_RetryableOperation operation)
+    {
+        // Dropped by Shutdown
+        if (m_aInFlight.Find(operation) == -1)
+            return;
+        
+        // No admission token: wait for the bucket to refill without spending an attempt
+        STS_AdmissionController admission = STS_AdmissionController.GetInstance();
+        if (!admission.TryAcquire())
+        {
+            int waitMs = Math.Max(admission.GetWaitTimeMs(), m_iBaseDelayMs);
+            GetGame().GetCallqueue().CallLater(RunAttempt, waitMs, false, operation);
+            return;
+        }
+        
+        operation.m_iAttempts++;
+        
+        bool success = false;
+        string error;
+        
+        try
+        {
+            success = operation.Execute();
+        }
+        catch (Exception e)
+        {
+            error = e.ToString();
+        }
+        
+        if (success)
+        {
+            m_iTotalSucceeded++;
+            Finish(operation, true);
+            return;
+        }
+        
+        int maxAttempts = m_iMaxAttempts;
+        if (operation.m_iMaxAttempts > 0)
+            maxAttempts = operation.m_iMaxAttempts;
+        
+        if (operation.IsAborted() || operation.m_iAttempts >= maxAttempts)
+        {
+            m_iTotalFailed++;
+            
+            if (m_Logger)
+                m_Logger.LogError(string.Format("%1 failed after %2 attempts%3", operation.GetName(), operation.m_iAttempts,
+                    error.IsEmpty() ? "" : ": " + error), "STS_RetryScheduler", "RunAttempt");
+            
+            Finish(operation, false);
+            return;
+        }
+        
+        int delayMs = GetBackoffDelay(operation.m_iAttempts);
+        m_iTotalRetries++;
+        
+        if (m_Logger)
+            m_Logger.LogWarning(string.Format("%1 attempt %2 failed%3 - retrying in %4 ms", operation.GetName(),
+                operation.m_iAttempts, error.IsEmpty() ? "" : ": " + error, delayMs), "STS_RetryScheduler", "RunAttempt");
+        
+        // Keep the in-flight slot while parked so a stalled backend cannot be flooded with new work
+        GetGame().GetCallqueue().CallLater(RunAttempt, delayMs, false, operation);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Exponential backoff with jitter: base * 2^(attempt-1), capped, with part of it randomized
+    protected int GetBackoffDelay(int attempt)
+    {
+        int delayMs = m_iBaseDelayMs;
+        for (int i = 1; i < attempt && delayMs < m_iMaxDelayMs; i++)
+        {
+            delayMs *= 2;
+        }
+        delayMs = Math.Min(delayMs, m_iMaxDelayMs);
+        
+        int jitterMs = delayMs * m_fJitter;
+        if (jitterMs > 0)
+            delayMs = delayMs - jitterMs + Math.RandomInt(0, jitterMs + 1);
+        
+        return delayMs;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Finish(STS_RetryableOperation operation, bool success)
+    {
+        // Hold a reference until the callback has run
+        STS_RetryableOperation finished = operation;
+        m_aInFlight.RemoveItem(operation);
+        
+        try
+        {
+            finished.OnComplete(success);
+        }
+        catch (Exception e)
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Exception in completion callback of %1: %2", finished.GetName(), e.ToString()),
+                    "STS_RetryScheduler", "Finish");
+        }
+        
+        // Hand the free slot to the oldest waiting operation
+        while (!m_aWaiting.IsEmpty() && m_aInFlight.Count() < m_iMaxInFlight)
+        {
+            STS_RetryableOperation next = m_aWaiting[0];
+            m_aWaiting.RemoveOrdered(0);
+            Start(next, 0);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Fail every pending operation, e.g. when the database is shut down
+    void Shutdown()
+    {
+        array<ref STS_RetryableOperation> pending = new array<ref STS_RetryableOperation>();
+        foreach (STS_RetryableOperation operation : m_aInFlight)
+        {
+            pending.Insert(operation);
+        }
+        foreach (STS_RetryableOperation operation : m_aWaiting)
+        {
+            pending.Insert(operation);
+        }
+        
+        m_aInFlight.Clear();
+        m_aWaiting.Clear();
+        GetGame().GetCallqueue().Remove(RunAttempt);
+        
+        foreach (STS_RetryableOperation operation : pending)
+        {
+            m_iTotalFailed++;
+            operation.OnComplete(false);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetMaxInFlight(int maxInFlight)
+    {
+        m_iMaxInFlight = Math.Max(1, maxInFlight);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetRetryPolicy(int maxAttempts, int baseDelayMs, int maxDelayMs, float jitter)
+    {
+        m_iMaxAttempts = Math.Max(1, maxAttempts);
+        m_iBaseDelayMs = Math.Max(1, baseDelayMs);
+        m_iMaxDelayMs = Math.Max(m_iBaseDelayMs, maxDelayMs);
+        m_fJitter = Math.Clamp(jitter, 0, 1);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetInFlightCount()
+    {
+        return m_aInFlight.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetWaitingCount()
+    {
+        return m_aWaiting.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get scheduler statistics
+    void GetStatistics(out int totalSubmitted, out int totalSucceeded, out int totalFailed, out int totalRetries)
+    {
+        totalSubmitted = m_iTotalSubmitted;
+        totalSucceeded = m_iTotalSucceeded;
+        totalFailed = m_iTotalFailed;
+        totalRetries = m_iTotalRetries;
+    }
+}
@@ -0,0 +1,99 @@
+// STS_SyntheticFullBackupJob.c
+// Folds a backup chain into a synthetic full backup. Every manifest already lists all chunks of its data set,
+// so the newest backup of the chain is rewritten as a full manifest after checking that each chunk it lists
+// is still in the store; no live data or chunk content is read. Runs on the time-sliced serializer, one chunk
+// reference per unit.
+
+class STS_SyntheticFullBackupJob : STS_SerializationJob
+{
+    protected string m_sSourcePath;
+    protected STS_ChunkStore m_ChunkStore;
+    protected func<string, bool> m_Callback;
+    
+    protected ref STS_BackupManifest m_Source;
+    protected int m_iFile = 0;
+    protected int m_iChunk = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    // The callback receives the target path and whether the synthetic full backup was written
+    void STS_SyntheticFullBackupJob(string sourcePath, string targetPath, STS_ChunkStore chunkStore, func<string, bool> callback)
+    {
+        m_sSourcePath = sourcePath;
+        m_sTargetPath = targetPath;
+        m_ChunkStore = chunkStore;
+        m_Callback = callback;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void Begin(FileHandle file)
+    {
+        m_Source = STS_BackupManifest.Load(m_sSourcePath);
+        if (!m_Source || !m_Source.IsConsistent() || !m_ChunkStore)
+        {
+            Fail("source manifest is missing or inconsistent");
+            return;
+        }
+        
+        // The synthetic backup holds the data of the source, so it keeps its creation time and digest
+        if (m_Source.m_sDigest.IsEmpty())
+            m_Source.m_sDigest = m_Source.ComputeDigest();
+        
+        m_Source.WriteHeader(file);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool WriteNext(FileHandle file)
+    {
+        if (m_bFailed || m_iFile >= m_Source.m_aFiles.Count())
+            return false;
+        
+        STS_BackupManifestFile entry = m_Source.m_aFiles[m_iFile];
+        if (m_iChunk == 0)
+            STS_BackupManifest.WriteFileHeader(file, entry);
+        
+        if (m_iChunk < entry.m_aChunks.Count())
+        {
+            string chunk = entry.m_aChunks[m_iChunk];
+            if (!m_ChunkStore.HasChunk(chunk))
+            {
+                Fail(string.Format("chunk %1 of %2 is missing", chunk, entry.m_sRelativePath));
+                return false;
+            }
+            
+            file.WriteLine(chunk);
+            m_iChunk++;
+        }
+        
+        if (m_iChunk >= entry.m_aChunks.Count())
+        {
+            m_iFile++;
+            m_iChunk = 0;
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (m_Callback)
+            m_Callback(m_sTargetPath, success);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    string GetSourcePath()
+    {
+        return m_sSourcePath;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Fail(string reason)
+    {
+        m_bFailed = true;
+        
+        STS_LoggingSystem logger = STS_LoggingSystem.GetInstance();
+        if (logger)
+            logger.LogWarning(string.Format("Synthetic full backup from %1 abandoned: %2", m_sSourcePath, reason),
+                "STS_SyntheticFullBackupJob", "Fail");
+    }
+}
@@ -0,0 +1,470 @@
+// STS_WriteAheadLog.c
+// Segmented append-only log of player stat saves that have not yet been acknowledged by the database.
+// Every flush window is written as one append before it reaches the database; acknowledged saves are
+// recorded with a small ack line and segments are deleted once nothing in them is outstanding.
+//
+// Line format:
+//   P <tab> sequence <tab> player UID <tab> player name <tab> stats JSON
+//   A <tab> sequence <tab> player UID
+
+//------------------------------------------------------------------------------------------------
+// One logged save
+class STS_WalEntry
+{
+    int m_iSequence;
+    int m_iSegment;
+    string m_sPlayerUID;
+    string m_sPlayerName;
+    string m_sPayload;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_WalEntry(string playerUID, string playerName, string payload)
+    {
+        m_sPlayerUID = playerUID;
+        m_sPlayerName = playerName;
+        m_sPayload = payload;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_WriteAheadLog
+{
+    protected const string SEGMENT_PREFIX = "wal_";
+    protected const string SEGMENT_EXTENSION = ".log";
+    
+    protected string m_sDirectory;
+    
+    // Active segment
+    protected FileHandle m_ActiveFile;
+    protected int m_iActiveSegment = 0;
+    protected int m_iActiveSegmentLines = 0;
+    protected bool m_bUnsynced = false;
+    
+    // Latest unacknowledged save per player, and how many of those each segment still holds
+    protected ref map<string, ref STS_WalEntry> m_mOutstanding = new map<string, ref STS_WalEntry>();
+    protected ref map<int, int> m_mSegmentOutstanding = new map<int, int>();
+    
+    protected int m_iNextSequence = 1;
+    protected bool m_bOpen = false;
+    
+    // Configuration
+    protected int m_iMaxSegmentLines = 2048;   // Rotate the active segment after this many lines
+    protected int m_iSyncIntervalMs = 1000;    // How often buffered appends are forced to disk
+    
+    // Statistics
+    protected int m_iTotalAppends = 0;
+    protected int m_iTotalEntries = 0;
+    protected int m_iTotalAcknowledged = 0;
+    protected int m_iSegmentsTruncated = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_WriteAheadLog(string directory = "$profile:StatTracker/WAL/")
+    {
+        m_sDirectory = directory;
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_WriteAheadLog()
+    {
+        Close();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Scan the retained segments and return the saves the database never acknowledged, oldest first.
+    // Only segments with outstanding entries survive truncation, so this reads the backlog, not every player.
+    array<ref STS_WalEntry> Open()
+    {
+        array<ref STS_WalEntry> unacknowledged = new array<ref STS_WalEntry>();
+        
+        if (m_bOpen)
+            return unacknowledged;
+        
+        if (!FileIO.FileExists(m_sDirectory))
+            FileIO.MakeDirectory(m_sDirectory);
+        
+        array<int> segments = ListSegments();
+        foreach (int segment : segments)
+        {
+            ReplaySegment(segment);
+            m_iActiveSegment = Math.Max(m_iActiveSegment, segment);
+        }
+        
+        // Never append to a segment written by a previous session - it may end in a torn line
+        m_iActiveSegment++;
+        m_bOpen = true;
+        
+        foreach (int segment : segments)
+        {
+            if (m_mSegmentOutstanding.Get(segment) <= 0)
+                DeleteSegment(segment);
+        }
+        
+        foreach (string uid, STS_WalEntry entry : m_mOutstanding)
+        {
+            unacknowledged.Insert(entry);
+        }
+        unacknowledged.Sort(CompareSequence);
+        
+        GetGame().GetCallqueue().CallLater(Sync, m_iSyncIntervalMs, true);
+        
+        if (m_Logger && !segments.IsEmpty())
+            m_Logger.LogInfo(string.Format("Write-ahead log opened: %1 segments scanned, %2 unacknowledged saves to replay",
+                segments.Count(), unacknowledged.Count()), "STS_WriteAheadLog", "Open");
+        
+        return unacknowledged;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Append a batch of saves as a single write; assigns each entry its sequence number
+    bool Append(array<ref STS_WalEntry> entries)
+    {
+        if (!m_bOpen || !entries || entries.IsEmpty())
+            return false;
+        
+        string block = "";
+        foreach (STS_WalEntry entry : entries)
+        {
+            entry.m_iSequence = m_iNextSequence++;
+            entry.m_iSegment = m_iActiveSegment;
+            
+            if (!block.IsEmpty())
+                block += "\n";
+            block += string.Format("P\t%1\t%2\t%3\t%4", entry.m_iSequence, entry.m_sPlayerUID,
+                SanitizeField(entry.m_sPlayerName), SanitizeField(entry.m_sPayload));
+        }
+        
+        if (!WriteBlock(block, entries.Count()))
+            return false;
+        
+        foreach (STS_WalEntry entry : entries)
+        {
+            // A newer save supersedes the older one, which no longer pins its segment
+            STS_WalEntry previous = m_mOutstanding.Get(entry.m_sPlayerUID);
+            if (previous)
+                ReleaseFromSegment(previous.m_iSegment);
+            
+            m_mOutstanding.Set(entry.m_sPlayerUID, entry);
+            m_mSegmentOutstanding.Set(entry.m_iSegment, m_mSegmentOutstanding.Get(entry.m_iSegment) + 1);
+        }
+        
+        m_iTotalAppends++;
+        m_iTotalEntries += entries.Count();
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Record that the database has stored the latest logged save of these players
+    void Acknowledge(array<string> playerUIDs)
+    {
+        if (!m_bOpen || !playerUIDs || playerUIDs.IsEmpty())
+            return;
+        
+        string block = "";
+        int lines = 0;
+        
+        foreach (string uid : playerUIDs)
+        {
+            STS_WalEntry entry = m_mOutstanding.Get(uid);
+            if (!entry)
+                continue;
+            
+            if (!block.IsEmpty())
+                block += "\n";
+            block += string.Format("A\t%1\t%2", entry.m_iSequence, uid);
+            lines++;
+            
+            m_mOutstanding.Remove(uid);
+            ReleaseFromSegment(entry.m_iSegment);
+            m_iTotalAcknowledged++;
+        }
+        
+        if (lines == 0)
+            return;
+        
+        // Nothing left to recover - drop the whole log instead of recording acks
+        if (m_mOutstanding.IsEmpty())
+        {
+            TruncateAll();
+            return;
+        }
+        
+        WriteBlock(block, lines);
+        TruncateAcknowledgedSegments();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Acknowledge these logged saves only; an entry a newer save of its player has superseded since is
+    // skipped, so the newer one stays outstanding until its own write is stored
+    void AcknowledgeEntries(array<STS_WalEntry> entries)
+    {
+        if (!entries)
+            return;
+        
+        array<string> playerUIDs = new array<string>();
+        foreach (STS_WalEntry entry : entries)
+        {
+            if (entry && m_mOutstanding.Get(entry.m_sPlayerUID) == entry)
+                playerUIDs.Insert(entry.m_sPlayerUID);
+        }
+        
+        Acknowledge(playerUIDs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Force buffered appends to disk by closing the active segment; the next append reopens it
+    void Sync()
+    {
+        if (!m_bUnsynced || !m_ActiveFile)
+            return;
+        
+        FileIO.CloseFile(m_ActiveFile);
+        m_ActiveFile = null;
+        m_bUnsynced = false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Close()
+    {
+        if (!m_bOpen)
+            return;
+        
+        GetGame().GetCallqueue().Remove(Sync);
+        
+        if (m_ActiveFile)
+        {
+            FileIO.CloseFile(m_ActiveFile);
+            m_ActiveFile = null;
+        }
+        
+        m_bUnsynced = false;
+        m_bOpen = false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected bool WriteBlock(string block, int lines)
+    {
+        // Rotate before the write so a segment never grows far past the limit
+        if (m_iActiveSegmentLines > 0 && m_iActiveSegmentLines + lines > m_iMaxSegmentLines)
+            RotateSegment();
+        
+        if (!m_ActiveFile)
+        {
+            m_ActiveFile = FileIO.OpenFile(GetSegmentPath(m_iActiveSegment), FileMode.APPEND);
+            if (!m_ActiveFile)
+            {
+                if (m_Logger)
+                    m_Logger.LogError(string.Format("Failed to open write-ahead log segment %1", GetSegmentPath(m_iActiveSegment)),
+                        "STS_WriteAheadLog", "WriteBlock");
+                return false;
+            }
+        }
+        
+        FileIO.FPrintln(m_ActiveFile, block);
+        m_iActiveSegmentLines += lines;
+        m_bUnsynced = true;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void RotateSegment()
+    {
+        if (m_ActiveFile)
+        {
+            FileIO.CloseFile(m_ActiveFile);
+            m_ActiveFile = null;
+        }
+        
+        m_bUnsynced = false;
+        m_iActiveSegment++;
+        m_iActiveSegmentLines = 0;
+        
+        TruncateAcknowledgedSegments();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void ReleaseFromSegment(int segment)
+    {
+        int remaining = m_mSegmentOutstanding.Get(segment) - 1;
+        if (remaining > 0)
+            m_mSegmentOutstanding.Set(segment, remaining);
+        else
+            m_mSegmentOutstanding.Remove(segment);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Delete completed segments; the active segment is kept until it rotates
+    protected void TruncateAcknowledgedSegments()
+    {
+        array<int> segments = ListSegments();
+        foreach (int segment : segments)
+        {
+            if (segment != m_iActiveSegment && !m_mSegmentOutstanding.Contains(segment))
+                DeleteSegment(segment);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void TruncateAll()
+    {
+        if (m_ActiveFile)
+        {
+            FileIO.CloseFile(m_ActiveFile);
+            m_ActiveFile = null;
+        }
+        
+        array<int> segments = ListSegments();
+        foreach (int segment : segments)
+        {
+            DeleteSegment(segment);
+        }
+        
+        m_mSegmentOutstanding.Clear();
+        m_bUnsynced = false;
+        m_iActiveSegment++;
+        m_iActiveSegmentLines = 0;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void DeleteSegment(int segment)
+    {
+        string path = GetSegmentPath(segment);
+        if (FileIO.DeleteFile(path))
+        {
+            m_iSegmentsTruncated++;
+        }
+        else if (m_Logger)
+        {
+            m_Logger.LogWarning(string.Format("Failed to delete acknowledged write-ahead log segment %1", path),
+                "STS_WriteAheadLog", "DeleteSegment");
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Apply one segment's puts and acks to the outstanding set
+    protected void ReplaySegment(int segment)
+    {
+        FileHandle file = FileIO.OpenFile(GetSegmentPath(segment), FileMode.READ);
+        if (!file)
+            return;
+        
+        string line;
+        while (FileIO.FGets(file, line) >= 0)
+        {
+            array<string> fields = new array<string>();
+            line.Split("\t", fields, false);
+            
+            if (fields.Count() < 3)
+                continue;
+            
+            int sequence = fields[1].ToInt();
+            string uid = fields[2];
+            m_iNextSequence = Math.Max(m_iNextSequence, sequence + 1);
+            
+            STS_WalEntry previous = m_mOutstanding.Get(uid);
+            
+            if (fields[0] == "P" && fields.Count() >= 5)
+            {
+                if (previous && previous.m_iSequence > sequence)
+                    continue;
+                
+                if (previous)
+                    ReleaseFromSegment(previous.m_iSegment);
+                
+                STS_WalEntry entry = new STS_WalEntry(uid, fields[3], fields[4]);
+                entry.m_iSequence = sequence;
+                entry.m_iSegment = segment;
+                m_mOutstanding.Set(uid, entry);
+                m_mSegmentOutstanding.Set(segment, m_mSegmentOutstanding.Get(segment) + 1);
+            }
+            else if (fields[0] == "A" && previous && previous.m_iSequence <= sequence)
+            {
+                m_mOutstanding.Remove(uid);
+                ReleaseFromSegment(previous.m_iSegment);
+            }
+        }
+        
+        FileIO.CloseFile(file);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Segment numbers present on disk, ascending
+    protected array<int> ListSegments()
+    {
+        array<string> files = new array<string>();
+        FileIO.FindFiles(files, m_sDirectory + SEGMENT_PREFIX + "*" + SEGMENT_EXTENSION);
+        
+        array<int> segments = new array<int>();
+        foreach (string file : files)
+        {
+            int start = file.LastIndexOf(SEGMENT_PREFIX) + SEGMENT_PREFIX.Length();
+            int end = file.LastIndexOf(SEGMENT_EXTENSION);
+            if (start < SEGMENT_PREFIX.Length() || end <= start)
+                continue;
+            
+            segments.Insert(file.Substring(start, end - start).ToInt());
+        }
+        
+        segments.Sort();
+        return segments;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GetSegmentPath(int segment)
+    {
+        return m_sDirectory + SEGMENT_PREFIX + segment.ToString().PadLeft(8, "0") + SEGMENT_EXTENSION;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Tabs and line breaks delimit records, so they must not appear inside a field
+    protected string SanitizeField(string value)
+    {
+        value.Replace("\t", " ");
+        value.Replace("\r", " ");
+        value.Replace("\n", " ");
+        return value;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static int CompareSequence(STS_WalEntry a, STS_WalEntry b)
+    {
+        return a.m_iSequence - b.m_iSequence;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Number of saves logged but not yet acknowledged
+    int GetOutstandingCount()
+    {
+        return m_mOutstanding.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetSyncInterval(int intervalMs)
+    {
+        m_iSyncIntervalMs = Math.Max(100, intervalMs);
+        
+        if (m_bOpen)
+        {
+            GetGame().GetCallqueue().Remove(Sync);
+            GetGame().GetCallqueue().CallLater(Sync, m_iSyncIntervalMs, true);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetMaxSegmentLines(int maxLines)
+    {
+        m_iMaxSegmentLines = Math.Max(16, maxLines);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get write-ahead log statistics
+    void GetStatistics(out int totalAppends, out int totalEntries, out int totalAcknowledged, out int segmentsTruncated)
+    {
+        totalAppends = m_iTotalAppends;
+        totalEntries = m_iTotalEntries;
+        totalAcknowledged = m_iTotalAcknowledged;
+        segmentsTruncated = m_iSegmentsTruncated;
+    }
+}
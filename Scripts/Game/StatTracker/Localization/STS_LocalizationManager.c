@@ -395,11 +395,11 @@ class STS_LocalizationManager
         while (pos < content.Length())
         {
             // Find the key (should start with a quote)
-            int keyStart = content.IndexOfFrom("\"", pos);
+            int keyStart = content.IndexOfFrom(pos, "\"");
             if (keyStart == -1)
                 break;
                 
-            int keyEnd = content.IndexOfFrom("\"", keyStart + 1);
+            int keyEnd = content.IndexOfFrom(keyStart + 1, "\"");
             if (keyEnd == -1)
                 break;
                 
@@ -407,11 +407,11 @@ class STS_LocalizationManager
             string key = content.Substring(keyStart + 1, keyEnd - keyStart - 1);
             
             // Find the value (should start after a colon and quote)
-            int colonPos = content.IndexOfFrom(":", keyEnd);
+            int colonPos = content.IndexOfFrom(keyEnd, ":");
             if (colonPos == -1)
                 break;
                 
-            int valueStart = content.IndexOfFrom("\"", colonPos);
+            int valueStart = content.IndexOfFrom(colonPos, "\"");
             if (valueStart == -1)
                 break;
                 
@@ -0,0 +1,332 @@
+// STS_BenchmarkSuite.c
+// Serialization and compression micro-benchmarks over deterministic corpora: player stats JSON round trips,
+// stats file loads and flush snapshots, entity map serialization, heat data saves and every codec of
+// STS_DataCompression, with the compression ratio and MB/s of each codec. Each result is appended to a CSV so
+// runs of different releases can be compared. Runs synchronously and stalls the server for its duration - use
+// it from RCON on a test server or from a headless benchmark world.
+
+//------------------------------------------------------------------------------------------------
+class STS_BenchmarkResult
+{
+    string m_sBenchmark;
+    string m_sCorpus;
+    int m_iOps;
+    float m_fNsPerOp;
+    float m_fBytesPerOp;
+    float m_fRatio; // Output size over input size; 0 where it does not apply
+    float m_fMBPerSecond; // Input megabytes processed per second; 0 where it does not apply
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_BenchmarkSuite : STS_StatsFileBenchmark
+{
+    protected const string RESULTS_FILE = "$profile:StatTracker/Bench/results.csv";
+    protected const string HEAT_SAVE_FILE = "$profile:StatTracker/Bench/heatmap_data.json";
+    protected const string CSV_HEADER = "run,label,benchmark,corpus,ops,ns_per_op,bytes_per_op,ratio,mb_per_s";
+    
+    protected ref array<ref STS_BenchmarkResult> m_aResults = new array<ref STS_BenchmarkResult>();
+    
+    //------------------------------------------------------------------------------------------------
+    // Run every benchmark on corpora of the given sizes and append the results to the CSV under the label.
+    // Default sizes are 1k/10k/100k players and 1M heat points. Returns the number of results.
+    int RunAll(string label = "", array<int> playerCounts = null, int heatPointCount = 1000000, int seed = 1)
+    {
+        if (!playerCounts)
+            playerCounts = {1000, 10000, 100000};
+        
+        m_aResults.Clear();
+        
+        foreach (int playerCount : playerCounts)
+        {
+            RunPlayerCorpus(playerCount, seed);
+        }
+        
+        if (heatPointCount > 0)
+            RunHeatCorpus(heatPointCount, seed);
+        
+        WriteResults(label);
+        return m_aResults.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Stats JSON round trip, entity map serialization and the codecs on the resulting stats file
+    protected void RunPlayerCorpus(int playerCount, int seed)
+    {
+        string corpus = string.Format("players_%1", playerCount);
+        
+        Math.Randomize(seed);
+        array<ref STS_PlayerStats> players = new array<ref STS_PlayerStats>();
+        array<string> uids = new array<string>();
+        for (int i = 0; i < playerCount; i++)
+        {
+            players.Insert(CreateRandomStats());
+            uids.Insert(GenerateUID(i));
+        }
+        
+        // ToJSON
+        array<string> records = new array<string>();
+        records.Resize(playerCount);
+        int jsonBytes = 0;
+        
+        float startTime = System.GetTickCount();
+        for (int j = 0; j < playerCount; j++)
+        {
+            records[j] = players[j].ToJSON();
+        }
+        float elapsedMs = System.GetTickCount() - startTime;
+        
+        foreach (string record : records)
+        {
+            jsonBytes += record.Length();
+        }
+        AddResult("stats_to_json", corpus, playerCount, elapsedMs, jsonBytes, 0);
+        
+        // FromJSON
+        startTime = System.GetTickCount();
+        foreach (string json : records)
+        {
+            STS_PlayerStats parsed = new STS_PlayerStats();
+            parsed.FromJSON(json);
+        }
+        AddResult("stats_from_json", corpus, playerCount, System.GetTickCount() - startTime, jsonBytes, 0);
+        
+        RunEntityMapSerialization(corpus, playerCount, seed);
+        
+        // The stats file in its saved layout, one player per line
+        array<string> lines = new array<string>();
+        lines.Insert("{\"players\":{\n");
+        for (int k = 0; k < playerCount; k++)
+        {
+            string separator = ",\n";
+            if (k == playerCount - 1)
+                separator = "\n";
+            
+            lines.Insert(string.Format("\"%1\":%2", uids[k], records[k]) + separator);
+        }
+        lines.Insert("}}");
+        
+        RunCodecs(corpus, STS_LZCodec.JoinPieces(lines), playerCount);
+        
+        // The fixture is generated from the same seed, so it holds the same players as the records above
+        string fixturePath = GenerateFixture(playerCount, seed);
+        if (!fixturePath.IsEmpty())
+        {
+            int loaded;
+            float loadMs = RunLoad(fixturePath, loaded);
+            AddResult("stats_file_load", corpus, loaded, loadMs, jsonBytes, 0);
+            FileIO.DeleteFile(fixturePath);
+        }
+        
+        float snapshotUs = RunSnapshot(playerCount, seed);
+        AddResult("stats_snapshot", corpus, playerCount, snapshotUs * playerCount / 1000, 0, 0);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // STS_PlayerStatsEntity::SerializeMapToJson on a weapon kills map per player
+    protected void RunEntityMapSerialization(string corpus, int playerCount, int seed)
+    {
+        Math.Randomize(seed);
+        array<ref map<string, int>> maps = new array<ref map<string, int>>();
+        for (int i = 0; i < playerCount; i++)
+        {
+            map<string, int> weaponKills = new map<string, int>();
+            int weapons = Math.RandomInt(1, 20);
+            for (int w = 0; w < weapons; w++)
+            {
+                weaponKills.Set(string.Format("Weapon_%1", Math.RandomInt(0, 40)), Math.RandomInt(1, 500));
+            }
+            
+            maps.Insert(weaponKills);
+        }
+        
+        STS_PlayerStatsEntity entity = new STS_PlayerStatsEntity();
+        int bytes = 0;
+        
+        float startTime = System.GetTickCount();
+        foreach (map<string, int> weaponKills : maps)
+        {
+            bytes += entity.SerializeMapToJson(weaponKills).Length();
+        }
+        AddResult("entity_map_to_json", corpus, playerCount, System.GetTickCount() - startTime, bytes, 0);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // STS_HeatmapManager::SaveHeatData through its save job, plain and compressed, then the codecs on the file
+    protected void RunHeatCorpus(int pointCount, int seed)
+    {
+        string corpus = string.Format("heat_points_%1", pointCount);
+        
+        Math.Randomize(seed);
+        array<string> types = {"kills", "deaths", "vehicles"};
+        map<string, ref array<ref STS_HeatmapPoint>> heatData = new map<string, ref array<ref STS_HeatmapPoint>>();
+        foreach (string type : types)
+        {
+            heatData.Insert(type, new array<ref STS_HeatmapPoint>());
+        }
+        
+        // Points cluster around a few hundred locations like real engagements do
+        for (int i = 0; i < pointCount; i++)
+        {
+            vector center = Vector(Math.RandomInt(0, 64) * 200, 0, Math.RandomInt(0, 64) * 200);
+            vector position = center + Vector(Math.RandomFloat(-100, 100), Math.RandomFloat(0, 50), Math.RandomFloat(-100, 100));
+            
+            STS_HeatmapPoint point = new STS_HeatmapPoint(position, 0, 0, "", 1 + i, -1, 0);
+            point.m_fIntensity = 1.0;
+            heatData.Get(types[i % types.Count()]).Insert(point);
+        }
+        
+        STS_DataCompression compression = STS_DataCompression.GetInstance();
+        
+        RunHeatSave("heat_save", corpus, heatData, pointCount, false);
+        string payload = compression.ReadTextFile(HEAT_SAVE_FILE);
+        
+        RunHeatSave("heat_save_compressed", corpus, heatData, pointCount, true);
+        
+        RunCodecs(corpus, payload, pointCount);
+        FileIO.DeleteFile(HEAT_SAVE_FILE);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void RunHeatSave(string benchmark, string corpus, map<string, ref array<ref STS_HeatmapPoint>> heatData, int pointCount, bool compress)
+    {
+        STS_TimeSlicedSerializer serializer = STS_TimeSlicedSerializer.GetInstance();
+        
+        // Anything already queued is written first so it is not timed
+        serializer.FlushAll();
+        
+        float startTime = System.GetTickCount();
+        serializer.Submit(new STS_HeatDataSaveJob(HEAT_SAVE_FILE, heatData, compress));
+        serializer.FlushAll();
+        float elapsedMs = System.GetTickCount() - startTime;
+        
+        int bytes = STS_DataCompression.GetInstance().ReadTextFile(HEAT_SAVE_FILE).Length();
+        AddResult(benchmark, corpus, pointCount, elapsedMs, bytes, 0);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Compress and decompress a payload with each codec; ops is the number of records it holds
+    protected void RunCodecs(string corpus, string payload, int ops)
+    {
+        if (payload.IsEmpty())
+            return;
+        
+        STS_DataCompression compression = STS_DataCompression.GetInstance();
+        
+        // Dictionary substitution
+        float startTime = System.GetTickCount();
+        string dictionaryEncoded = compression.CompressJsonString(payload);
+        float elapsedMs = System.GetTickCount() - startTime;
+        AddResult("dictionary_compress", corpus, ops, elapsedMs, dictionaryEncoded.Length(), dictionaryEncoded.Length() / (float)payload.Length(), payload.Length());
+        
+        startTime = System.GetTickCount();
+        compression.DecompressJsonString(dictionaryEncoded);
+        AddResult("dictionary_decompress", corpus, ops, System.GetTickCount() - startTime, payload.Length(), 0, payload.Length());
+        
+        RunLZ("lz", corpus, payload, payload, ops);
+        RunLZ("dictionary_lz", corpus, payload, dictionaryEncoded, ops);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // LZ frame of input; the ratio and throughput are taken against the original payload
+    protected void RunLZ(string codec, string corpus, string payload, string input, int ops)
+    {
+        float startTime = System.GetTickCount();
+        string frame = STS_LZCodec.Compress(input);
+        float elapsedMs = System.GetTickCount() - startTime;
+        AddResult(codec + "_compress", corpus, ops, elapsedMs, frame.Length(), frame.Length() / (float)payload.Length(), payload.Length());
+        
+        string decoded;
+        startTime = System.GetTickCount();
+        bool intact = STS_LZCodec.Decompress(frame, decoded);
+        elapsedMs = System.GetTickCount() - startTime;
+        AddResult(codec + "_decompress", corpus, ops, elapsedMs, input.Length(), 0, payload.Length());
+        
+        if (!intact || decoded != input)
+            m_Logger.LogError(string.Format("%1 round trip failed on %2", codec, corpus), "STS_BenchmarkSuite", "RunLZ");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // inputBytes is the data the benchmark consumed, for the throughput; 0 leaves it out
+    protected void AddResult(string benchmark, string corpus, int ops, float elapsedMs, int bytes, float ratio, int inputBytes = 0)
+    {
+        STS_BenchmarkResult result = new STS_BenchmarkResult();
+        result.m_sBenchmark = benchmark;
+        result.m_sCorpus = corpus;
+        result.m_iOps = ops;
+        result.m_fNsPerOp = elapsedMs * 1000000 / Math.Max(1, ops);
+        result.m_fBytesPerOp = bytes / (float)Math.Max(1, ops);
+        result.m_fRatio = ratio;
+        if (inputBytes > 0)
+            result.m_fMBPerSecond = inputBytes / 1000000.0 * 1000 / Math.Max(0.001, elapsedMs);
+        
+        m_aResults.Insert(result);
+        
+        m_Logger.LogInfo(string.Format("%1 [%2]: %3 ns/op, %4 bytes/op, ratio %5, %6 MB/s",
+            benchmark, corpus, result.m_fNsPerOp, result.m_fBytesPerOp, ratio, result.m_fMBPerSecond), "STS_BenchmarkSuite", "AddResult");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Append this run's results to the CSV, writing the header when the file is new. A file with other
+    // columns is moved aside first, so one file never mixes layouts.
+    protected void WriteResults(string label)
+    {
+        if (!FileIO.FileExists(FIXTURE_DIR))
+            FileIO.MakeDirectory(FIXTURE_DIR);
+        
+        if (FileIO.FileExists(RESULTS_FILE) && ReadHeader() != CSV_HEADER)
+        {
+            string archivePath = string.Format("%1.%2.old", RESULTS_FILE, System.GetUnixTime());
+            if (FileIO.CopyFile(RESULTS_FILE, archivePath))
+            {
+                FileIO.DeleteFile(RESULTS_FILE);
+                m_Logger.LogInfo("Moved results with an older column layout to " + archivePath, "STS_BenchmarkSuite", "WriteResults");
+            }
+        }
+        
+        bool isNew = !FileIO.FileExists(RESULTS_FILE);
+        FileHandle file = FileIO.OpenFile(RESULTS_FILE, FileMode.APPEND);
+        if (!file)
+        {
+            m_Logger.LogError("Failed to open " + RESULTS_FILE, "STS_BenchmarkSuite", "WriteResults");
+            return;
+        }
+        
+        if (isNew)
+            file.WriteLine(CSV_HEADER);
+        
+        // Labels are free text from the command line; keep them from breaking the columns
+        string safeLabel = label;
+        safeLabel.Replace(",", "_");
+        int run = System.GetUnixTime();
+        
+        foreach (STS_BenchmarkResult result : m_aResults)
+        {
+            file.WriteLine(string.Format("%1,%2,%3,%4,%5,%6,%7,%8,%9", run, safeLabel, result.m_sBenchmark, result.m_sCorpus,
+                result.m_iOps, result.m_fNsPerOp, result.m_fBytesPerOp, result.m_fRatio, result.m_fMBPerSecond));
+        }
+        
+        file.Close();
+        
+        m_Logger.LogInfo(string.Format("Wrote %1 benchmark results to %2", m_aResults.Count(), RESULTS_FILE),
+            "STS_BenchmarkSuite", "WriteResults");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string ReadHeader()
+    {
+        string header;
+        FileHandle file = FileIO.OpenFile(RESULTS_FILE, FileMode.READ);
+        if (!file)
+            return header;
+        
+        file.ReadLine(header);
+        file.Close();
+        return header;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    array<ref STS_BenchmarkResult> GetResults()
+    {
+        return m_aResults;
+    }
+}
@@ -118,6 +118,30 @@ class STS_PerformanceMonitor
         m_fTotalTimeSpent += elapsed;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // End measuring an operation that processed a batch of items (records, files, points...)
+    void EndBatchMeasurement(string componentName, string operationName, float startTime, int itemCount)
+    {
+        if (!m_bEnabled || startTime == 0)
+            return;
+        
+        float elapsed = GetPerformanceTime() - startTime;
+        
+        STS_PerformanceMetrics metrics;
+        if (!m_mComponentMetrics.Find(componentName, metrics))
+        {
+            if (m_Logger)
+                m_Logger.LogWarning(string.Format("No metrics found for component %1", componentName), "STS_PerformanceMonitor", "EndBatchMeasurement");
+            return;
+        }
+        
+        metrics.EndOperation(operationName, elapsed);
+        metrics.RecordItems(operationName, itemCount);
+        
+        m_iTotalOperations++;
+        m_fTotalTimeSpent += elapsed;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Measure a complete operation
     void MeasureOperation(string componentName, string operationName, float elapsed)
@@ -404,6 +428,15 @@ class STS_PerformanceMetrics
         m_fTotalTimeSpent += elapsed;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Record the number of items processed by the last run of an operation
+    void RecordItems(string operationName, int itemCount)
+    {
+        STS_OperationMetrics metrics;
+        if (m_mOperationMetrics.Find(operationName, metrics))
+            metrics.AddItems(itemCount);
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get total time spent
     float GetTotalTimeSpent()
@@ -453,6 +486,13 @@ class STS_PerformanceMetrics
                 metrics.GetAverageTime(),
                 metrics.GetMinTime(),
                 metrics.GetMaxTime());
+            
+            if (metrics.GetItemCount() > 0)
+            {
+                summary += string.Format("      %1 items, %.1f items/s\n",
+                    metrics.GetItemCount(),
+                    metrics.GetItemsPerSecond());
+            }
         }
         
         return summary;
@@ -471,6 +511,7 @@ class STS_OperationMetrics
     protected float m_fTotalTime = 0;
     protected float m_fMinTime = 999999;  // Initialize to a high value
     protected float m_fMaxTime = 0;
+    protected int m_iItemCount = 0;       // Items processed by batch operations
     
     //------------------------------------------------------------------------------------------------
     // Constructor
@@ -493,6 +534,13 @@ class STS_OperationMetrics
             m_fMaxTime = elapsed;
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Add processed items for throughput reporting
+    void AddItems(int itemCount)
+    {
+        m_iItemCount += itemCount;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get count of measurements
     int GetCount()
@@ -533,4 +581,21 @@ class STS_OperationMetrics
     {
         return m_fMaxTime;
     }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get total items processed
+    int GetItemCount()
+    {
+        return m_iItemCount;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get throughput in items per second (times are in milliseconds)
+    float GetItemsPerSecond()
+    {
+        if (m_fTotalTime <= 0)
+            return 0;
+        
+        return m_iItemCount / (m_fTotalTime / 1000.0);
+    }
 } 
\ No newline at end of file
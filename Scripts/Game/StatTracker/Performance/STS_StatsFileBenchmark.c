@@ -0,0 +1,136 @@
+// STS_StatsFileBenchmark.c
+// Generates large player_stats.json fixtures and times how long the stats file cache takes to load them,
+// and measures the cost of snapshotting player stats for a flush. STS_BenchmarkSuite runs these per corpus.
+
+class STS_StatsFileBenchmark
+{
+    protected const string FIXTURE_DIR = "$profile:StatTracker/Bench/";
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_StatsFileBenchmark()
+    {
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write a stats file with playerCount randomized players in the legacy cache format; returns its path
+    string GenerateFixture(int playerCount, int seed = 1)
+    {
+        if (!FileIO.FileExists(FIXTURE_DIR))
+            FileIO.MakeDirectory(FIXTURE_DIR);
+        
+        string filePath = string.Format("%1player_stats_%2.json", FIXTURE_DIR, playerCount);
+        FileHandle file = FileIO.OpenFile(filePath, FileMode.WRITE);
+        if (!file)
+        {
+            m_Logger.LogError(string.Format("Failed to create benchmark fixture %1", filePath), "STS_StatsFileBenchmark", "GenerateFixture");
+            return "";
+        }
+        
+        Math.Randomize(seed);
+        
+        file.WriteLine("{\"players\":{");
+        for (int i = 0; i < playerCount; i++)
+        {
+            STS_PlayerStats stats = CreateRandomStats();
+            
+            string line = string.Format("\"%1\":%2", GenerateUID(i), stats.ToJSON());
+            if (i < playerCount - 1)
+                line += ",";
+            
+            file.WriteLine(line);
+        }
+        file.WriteLine("}}");
+        file.Close();
+        
+        m_Logger.LogInfo(string.Format("Generated benchmark fixture with %1 players: %2", playerCount, filePath),
+            "STS_StatsFileBenchmark", "GenerateFixture");
+        
+        return filePath;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Stream a stats file and parse every player; returns the elapsed time in ms
+    float RunLoad(string filePath, out int playerCount)
+    {
+        playerCount = 0;
+        
+        STS_PlayerStatsFileReader reader = new STS_PlayerStatsFileReader();
+        int startTime = System.GetTickCount();
+        
+        if (!reader.Open(filePath))
+            return -1;
+        
+        string playerUID;
+        string playerJson;
+        while (reader.Next(playerUID, playerJson))
+        {
+            STS_PlayerStats stats = new STS_PlayerStats();
+            if (stats.FromJSON(playerJson))
+                playerCount++;
+        }
+        
+        return System.GetTickCount() - startTime;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Snapshot playerCount randomized players; returns the cost per player in microseconds
+    float RunSnapshot(int playerCount, int seed = 1)
+    {
+        Math.Randomize(seed);
+        
+        array<ref STS_PlayerStats> players = new array<ref STS_PlayerStats>();
+        for (int i = 0; i < playerCount; i++)
+        {
+            players.Insert(CreateRandomStats());
+        }
+        
+        array<ref STS_PlayerStats> snapshots = new array<ref STS_PlayerStats>();
+        int startTime = System.GetTickCount();
+        
+        foreach (STS_PlayerStats stats : players)
+        {
+            snapshots.Insert(stats.CreateSnapshot());
+        }
+        
+        float elapsedMs = System.GetTickCount() - startTime;
+        return elapsedMs * 1000 / Math.Max(1, playerCount);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected STS_PlayerStats CreateRandomStats()
+    {
+        STS_PlayerStats stats = new STS_PlayerStats();
+        stats.m_iKills = Math.RandomInt(0, 5000);
+        stats.m_iDeaths = Math.RandomInt(0, 5000);
+        stats.m_iBasesCaptured = Math.RandomInt(0, 300);
+        stats.m_iBasesLost = Math.RandomInt(0, 300);
+        stats.m_iTotalXP = Math.RandomInt(0, 1000000);
+        stats.m_iRank = Math.RandomInt(1, 20);
+        stats.m_iSuppliesDelivered = Math.RandomInt(0, 100000);
+        stats.m_iSupplyDeliveryCount = Math.RandomInt(0, 1000);
+        stats.m_iAIKills = Math.RandomInt(0, 10000);
+        stats.m_iVehicleKills = Math.RandomInt(0, 500);
+        stats.m_iAirKills = Math.RandomInt(0, 100);
+        stats.m_fTotalPlaytime = Math.RandomFloat(0, 1000000);
+        stats.m_fLastSessionDuration = Math.RandomFloat(0, 20000);
+        
+        int deaths = Math.RandomInt(0, 10);
+        for (int i = 0; i < deaths; i++)
+        {
+            stats.m_aKilledBy.Insert(string.Format("Player_%1", Math.RandomInt(0, 1000)));
+            stats.m_aKilledByWeapon.Insert(string.Format("Weapon_%1", Math.RandomInt(0, 40)));
+            stats.m_aKilledByTeam.Insert(Math.RandomInt(0, 3));
+        }
+        
+        return stats;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GenerateUID(int index)
+    {
+        return string.Format("%1-%2", index.ToString().PadLeft(8, "0"), Math.RandomInt(100000, 999999));
+    }
+}
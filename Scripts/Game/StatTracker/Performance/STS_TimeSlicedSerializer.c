@@ -0,0 +1,329 @@
+// STS_TimeSlicedSerializer.c
+// Cooperative serializer for whole-server saves. A job writes one small unit (one player, one heat point) at
+// a time into a temporary file; the serializer runs units until the per-frame budget is spent, resumes from
+// the job's cursor on the next frame and only replaces the target file once the job has written everything.
+
+//------------------------------------------------------------------------------------------------
+// Base class for a save the serializer can spread over frames. Subclasses set the target path and keep
+// their own cursor.
+class STS_SerializationJob
+{
+    protected string m_sTargetPath;
+    
+    // Set by a job that found it cannot produce a valid file; the target is then left untouched
+    protected bool m_bFailed = false;
+    
+    //------------------------------------------------------------------------------------------------
+    string GetTargetPath()
+    {
+        return m_sTargetPath;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    string GetTempPath()
+    {
+        return m_sTargetPath + ".tmp";
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool HasFailed()
+    {
+        return m_bFailed;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Called once when the job starts, with the temporary file open; capture the cursor state here
+    void Begin(FileHandle file)
+    {
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write the next unit. Return false once there is nothing left to write.
+    bool WriteNext(FileHandle file)
+    {
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Called after the last unit, before the temporary file is closed
+    void End(FileHandle file)
+    {
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Called exactly once after the target file was replaced (or the job failed)
+    void OnComplete(bool success)
+    {
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Job that writes a JSON object of key -> value with one entry per unit. The keys are captured when the job
+// starts; each value is serialized from live data when its turn comes, so entries removed meanwhile are skipped.
+class STS_KeyedJsonSerializationJob : STS_SerializationJob
+{
+    protected ref array<string> m_aKeys = new array<string>();
+    protected int m_iCursor = 0;
+    protected int m_iWritten = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    // Fill keys with the entries to write
+    protected void CollectKeys(notnull array<string> keys)
+    {
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // JSON value for a key, or an empty string to skip it
+    protected string SerializeValue(string key)
+    {
+        return string.Empty;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void Begin(FileHandle file)
+    {
+        CollectKeys(m_aKeys);
+        file.WriteLine("{");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool WriteNext(FileHandle file)
+    {
+        while (m_iCursor < m_aKeys.Count())
+        {
+            string key = m_aKeys[m_iCursor];
+            m_iCursor++;
+            
+            string value = SerializeValue(key);
+            if (value.IsEmpty())
+                continue;
+            
+            string separator = "";
+            if (m_iWritten > 0)
+                separator = ",";
+            
+            file.WriteLine(separator + "\"" + key + "\":" + value);
+            m_iWritten++;
+            return true;
+        }
+        
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void End(FileHandle file)
+    {
+        file.WriteLine("}");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetWrittenCount()
+    {
+        return m_iWritten;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+class STS_TimeSlicedSerializer
+{
+    // Singleton instance
+    private static ref STS_TimeSlicedSerializer s_Instance;
+    
+    // Jobs in submission order; the first one is active once m_ActiveFile is open
+    protected ref array<ref STS_SerializationJob> m_aJobs = new array<ref STS_SerializationJob>();
+    protected FileHandle m_ActiveFile;
+    protected bool m_bRunning = false;
+    
+    // Configuration
+    protected float m_fFrameBudgetMs = 2.0;
+    
+    // Statistics
+    protected int m_iJobsCompleted = 0;
+    protected int m_iJobsFailed = 0;
+    protected int m_iUnitsWritten = 0;
+    protected float m_fWorstFrameMs = 0;
+    
+    protected STS_LoggingSystem m_Logger;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_TimeSlicedSerializer()
+    {
+        m_Logger = STS_LoggingSystem.GetInstance();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_TimeSlicedSerializer()
+    {
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    static STS_TimeSlicedSerializer GetInstance()
+    {
+        if (!s_Instance)
+            s_Instance = new STS_TimeSlicedSerializer();
+        
+        return s_Instance;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queue a job. A job for the same file that has not started yet already covers it, so the new one is
+    // dropped; a job for a file that is being written right now is queued behind it.
+    void Submit(STS_SerializationJob job)
+    {
+        if (!job)
+            return;
+        
+        for (int i = 0; i < m_aJobs.Count(); i++)
+        {
+            bool started = i == 0 && m_ActiveFile;
+            if (!started && m_aJobs[i].GetTargetPath() == job.GetTargetPath())
+                return;
+        }
+        
+        m_aJobs.Insert(job);
+        
+        if (!m_bRunning)
+        {
+            m_bRunning = true;
+            GetGame().GetCallqueue().CallLater(ProcessFrame, 0, true);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write units until this frame's budget is spent
+    protected void ProcessFrame()
+    {
+        int startTime = System.GetTickCount();
+        
+        while (System.GetTickCount() - startTime < m_fFrameBudgetMs)
+        {
+            if (!RunUnit())
+            {
+                m_bRunning = false;
+                GetGame().GetCallqueue().Remove(ProcessFrame);
+                break;
+            }
+        }
+        
+        m_fWorstFrameMs = Math.Max(m_fWorstFrameMs, System.GetTickCount() - startTime);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Advance the active job by one unit, starting or finishing jobs as needed; false when idle
+    protected bool RunUnit()
+    {
+        if (m_aJobs.IsEmpty())
+            return false;
+        
+        STS_SerializationJob job = m_aJobs[0];
+        
+        if (!m_ActiveFile)
+        {
+            m_ActiveFile = FileIO.OpenFile(job.GetTempPath(), FileMode.WRITE);
+            if (!m_ActiveFile)
+            {
+                if (m_Logger)
+                    m_Logger.LogError(string.Format("Failed to open %1 - save of %2 skipped", job.GetTempPath(), job.GetTargetPath()),
+                        "STS_TimeSlicedSerializer", "RunUnit");
+                
+                Complete(false);
+                return true;
+            }
+            
+            job.Begin(m_ActiveFile);
+            return true;
+        }
+        
+        if (job.WriteNext(m_ActiveFile))
+        {
+            m_iUnitsWritten++;
+            return true;
+        }
+        
+        job.End(m_ActiveFile);
+        m_ActiveFile.Close();
+        m_ActiveFile = null;
+        
+        if (job.HasFailed())
+        {
+            FileIO.DeleteFile(job.GetTempPath());
+            Complete(false);
+            return true;
+        }
+        
+        // Swap the finished file in; readers never see a partially written target
+        bool success = FileIO.CopyFile(job.GetTempPath(), job.GetTargetPath());
+        if (success)
+            FileIO.DeleteFile(job.GetTempPath());
+        else if (m_Logger)
+            m_Logger.LogError(string.Format("Failed to replace %1", job.GetTargetPath()), "STS_TimeSlicedSerializer", "RunUnit");
+        
+        Complete(success);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Complete(bool success)
+    {
+        // Hold a reference until the callback has run
+        STS_SerializationJob job = m_aJobs[0];
+        m_aJobs.RemoveOrdered(0);
+        
+        if (m_ActiveFile)
+        {
+            m_ActiveFile.Close();
+            m_ActiveFile = null;
+        }
+        
+        if (success)
+            m_iJobsCompleted++;
+        else
+            m_iJobsFailed++;
+        
+        try
+        {
+            job.OnComplete(success);
+        }
+        catch (Exception e)
+        {
+            if (m_Logger)
+                m_Logger.LogError(string.Format("Exception completing save of %1: %2", job.GetTargetPath(), e.ToString()),
+                    "STS_TimeSlicedSerializer", "Complete");
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Run every queued job to completion now, ignoring the budget (e.g. on shutdown)
+    void FlushAll()
+    {
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+        m_bRunning = false;
+        
+        while (RunUnit())
+        {
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetFrameBudget(float budgetMs)
+    {
+        m_fFrameBudgetMs = Math.Max(0.1, budgetMs);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetQueuedJobCount()
+    {
+        return m_aJobs.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Get serializer statistics
+    void GetStatistics(out int jobsCompleted, out int jobsFailed, out int unitsWritten, out float worstFrameMs)
+    {
+        jobsCompleted = m_iJobsCompleted;
+        jobsFailed = m_iJobsFailed;
+        unitsWritten = m_iUnitsWritten;
+        worstFrameMs = m_fWorstFrameMs;
+    }
+}
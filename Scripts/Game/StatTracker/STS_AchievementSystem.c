@@ -163,6 +163,52 @@ class PlayerAchievements
     }
 }
 
+//------------------------------------------------------------------------------------------------
+// Writes the achievement file one player per unit through the time-sliced serializer
+class STS_AchievementSaveJob : STS_KeyedJsonSerializationJob
+{
+    protected map<int, ref PlayerAchievements> m_mData;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_AchievementSaveJob(string targetPath, map<int, ref PlayerAchievements> data)
+    {
+        m_sTargetPath = targetPath;
+        m_mData = data;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override protected void CollectKeys(notnull array<string> keys)
+    {
+        if (!m_mData)
+            return;
+        
+        foreach (int playerID, PlayerAchievements achievements : m_mData)
+        {
+            keys.Insert(playerID.ToString());
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override protected string SerializeValue(string key)
+    {
+        if (!m_mData)
+            return string.Empty;
+        
+        PlayerAchievements achievements = m_mData.Get(key.ToInt());
+        if (!achievements)
+            return string.Empty;
+        
+        return achievements.ToJSON();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (success)
+            Print(string.Format("[StatTracker] Saved achievement data for %1 players", GetWrittenCount()));
+    }
+}
+
 class STS_AchievementSystem
 {
     // Singleton instance
@@ -367,32 +413,15 @@ class STS_AchievementSystem
     }
     
     //------------------------------------------------------------------------------------------------
-    // Save achievement data to file
+    // Save achievement data to file. The write is spread over frames by the time-sliced serializer; a save
+    // requested while one is still queued is covered by it.
     void SaveAchievementData()
     {
-        string fileContent = "{";
-        
-        int count = 0;
-        foreach (int playerID, PlayerAchievements achievements : m_mPlayerAchievements)
-        {
-            fileContent += "\"" + playerID.ToString() + "\":" + achievements.ToJSON();
-            
-            if (count < m_mPlayerAchievements.Count() - 1)
-                fileContent += ",";
-                
-            count++;
-        }
-        
-        fileContent += "}";
-        
         // Ensure directory exists
         string dir = "$profile:StatTracker";
         FileIO.MakeDirectory(dir);
         
-        // Write to file
-        FileIO.FileWrite(ACHIEVEMENTS_DATA_PATH, fileContent);
-        
-        Print(string.Format("[StatTracker] Saved achievement data for %1 players", m_mPlayerAchievements.Count()));
+        STS_TimeSlicedSerializer.GetInstance().Submit(new STS_AchievementSaveJob(ACHIEVEMENTS_DATA_PATH, m_mPlayerAchievements));
     }
     
     //------------------------------------------------------------------------------------------------
@@ -10,15 +10,20 @@ class STS_BackupManager
     protected ref STS_LoggingSystem m_Logger;
     protected ref STS_Config m_Config;
     
-    // Backup configuration
+    // Backup configuration. Backups are manifests in the database manager's chunk store, so unchanged
+    // data is shared between them.
+    protected const string BACKUP_EXTENSION = ".manifest";
+    protected const string BACKUP_PATTERN = "*.manifest";
     protected string m_sBackupDir = "$profile:StatTracker/Backups/";
     protected string m_sCloudBackupDir = "$profile:StatTracker/CloudBackups/";
+    protected const string CLOUD_CHUNK_SUBDIR = "Chunks/";
     protected int m_iMaxLocalBackups = 10;
     protected int m_iMaxCloudBackups = 30;
     protected int m_iBackupIntervalHours = 6;
     protected bool m_bEnableDifferentialBackups = true;
     protected bool m_bEnableCloudBackups = false;
     protected bool m_bAutoVerifyBackups = true;
+    protected int m_iMaxDifferentialChain = 6; // Differentials after a full backup before they are compacted
     
     // Cloud provider settings
     protected string m_sCloudProvider = "S3"; // Options: "S3", "GCP", "Azure", "None"
@@ -38,11 +43,19 @@ class STS_BackupManager
     protected string m_sLastBackupFile = "";
     protected string m_sLastFullBackupFile = "";
     protected bool m_bBackupInProgress = false;
+    
+    // Differentials created since the last full backup, oldest first, and the part of that chain being compacted
+    protected ref array<string> m_aDifferentialChain = new array<string>();
+    protected ref array<string> m_aCompactingChain = new array<string>();
     protected ref array<string> m_aPendingCloudUploads = new array<string>();
     
     // Integrity verification
     protected ref map<string, string> m_mBackupChecksums = new map<string, string>();
     protected ref array<string> m_aCorruptedBackups = new array<string>();
+    protected ref STS_BackupVerifier m_Verifier;
+    
+    // Chunks of the manifests copied to the local cloud directory (provider "None")
+    protected ref STS_ChunkStore m_CloudChunkStore;
     
     // Pending restore info
     protected string m_sPendingRestoreFile = "";
@@ -57,6 +70,15 @@ class STS_BackupManager
         // Create backup directories
         CreateDirectories();
         
+        // Chunks referenced by our manifests must survive the database manager's garbage collection
+        STS_DatabaseManager dbManager = STS_DatabaseManager.GetInstance();
+        if (dbManager && dbManager.GetBackupChunkStore())
+        {
+            dbManager.GetBackupChunkStore().AddManifestDirectory(m_sBackupDir + "Full/");
+            dbManager.GetBackupChunkStore().AddManifestDirectory(m_sBackupDir + "Differential/");
+            m_Verifier = new STS_BackupVerifier(dbManager.GetBackupChunkStore());
+        }
+        
         // Load configuration from main config
         LoadBackupConfig();
         
@@ -135,6 +157,7 @@ class STS_BackupManager
         m_bEnableDifferentialBackups = m_Config.GetConfigValueBool("enableDifferentialBackups", m_bEnableDifferentialBackups);
         m_bEnableCloudBackups = m_Config.GetConfigValueBool("enableCloudBackups", m_bEnableCloudBackups);
         m_bAutoVerifyBackups = m_Config.GetConfigValueBool("autoVerifyBackups", m_bAutoVerifyBackups);
+        m_iMaxDifferentialChain = m_Config.GetConfigValueInt("maxDifferentialChain", m_iMaxDifferentialChain);
         
         // Cloud provider settings
         m_sCloudProvider = m_Config.GetConfigValueString("cloudProvider", m_sCloudProvider);
@@ -172,6 +195,9 @@ class STS_BackupManager
         if (changedValues.Contains("autoVerifyBackups"))
             m_bAutoVerifyBackups = changedValues.Get("autoVerifyBackups").ToBool();
             
+        if (changedValues.Contains("maxDifferentialChain"))
+            m_iMaxDifferentialChain = changedValues.Get("maxDifferentialChain").ToInt();
+        
         // Cloud provider settings
         if (changedValues.Contains("cloudProvider"))
             m_sCloudProvider = changedValues.Get("cloudProvider");
@@ -221,7 +247,7 @@ class STS_BackupManager
             bool isDifferential = m_bEnableDifferentialBackups && !forceFull && m_sLastFullBackupFile != "";
             string backupType = isDifferential ? "Differential" : "Full";
             string backupPath = m_sBackupDir + backupType + "/";
-            string backupFileName = "StatTracker_" + backupType + "_" + timestamp + ".zip";
+            string backupFileName = "StatTracker_" + backupType + "_" + timestamp + BACKUP_EXTENSION;
             string fullBackupPath = backupPath + backupFileName;
             
             m_Logger.LogInfo("Creating " + backupType + " backup: " + fullBackupPath, 
@@ -238,7 +264,7 @@ class STS_BackupManager
                         "STS_BackupManager", "CreateBackup");
                     backupType = "Full";
                     backupPath = m_sBackupDir + backupType + "/";
-                    backupFileName = "StatTracker_" + backupType + "_" + timestamp + ".zip";
+                    backupFileName = "StatTracker_" + backupType + "_" + timestamp + BACKUP_EXTENSION;
                     fullBackupPath = backupPath + backupFileName;
                     isDifferential = false;
                 }
@@ -253,6 +279,11 @@ class STS_BackupManager
                     return false;
                 }
                 m_sLastFullBackupFile = fullBackupPath;
+                m_aDifferentialChain.Clear();
+            }
+            else
+            {
+                m_aDifferentialChain.Insert(fullBackupPath);
             }
             
             m_sLastBackupFile = fullBackupPath;
@@ -269,6 +300,10 @@ class STS_BackupManager
             // Clean up old backups
             CleanupOldBackups();
             
+            // Fold a long differential chain into a synthetic full backup
+            if (isDifferential && m_aDifferentialChain.Count() >= m_iMaxDifferentialChain)
+                CompactBackupChain();
+            
             // Upload to cloud if enabled
             if (m_bEnableCloudBackups)
             {
@@ -322,6 +357,73 @@ class STS_BackupManager
         return dbManager.CreateDifferentialBackup(diffBackupPath, baseFullBackup);
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Fold the current differential chain into a synthetic full backup built from its newest manifest, so
+    // restores read one self-contained backup and the folded differentials can be dropped. The new manifest
+    // is written over several frames; returns false if there is nothing to compact or a compaction is running.
+    bool CompactBackupChain()
+    {
+        if (!m_aCompactingChain.IsEmpty() || m_aDifferentialChain.IsEmpty())
+            return false;
+        
+        STS_DatabaseManager dbManager = STS_DatabaseManager.GetInstance();
+        if (!dbManager || !dbManager.GetBackupChunkStore())
+        {
+            m_Logger.LogError("Database manager not available", "STS_BackupManager", "CompactBackupChain");
+            return false;
+        }
+        
+        m_aCompactingChain.Copy(m_aDifferentialChain);
+        string sourcePath = m_aCompactingChain[m_aCompactingChain.Count() - 1];
+        string targetPath = m_sBackupDir + "Full/StatTracker_Full_" + GetTimestampString() + "_synthetic" + BACKUP_EXTENSION;
+        
+        m_Logger.LogInfo(string.Format("Compacting %1 differential backups into %2", m_aCompactingChain.Count(), targetPath), 
+            "STS_BackupManager", "CompactBackupChain");
+        
+        STS_TimeSlicedSerializer.GetInstance().Submit(
+            new STS_SyntheticFullBackupJob(sourcePath, targetPath, dbManager.GetBackupChunkStore(), OnSyntheticFullBackupComplete));
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void OnSyntheticFullBackupComplete(string targetPath, bool success)
+    {
+        if (!success)
+        {
+            // The chain is left as it is and compaction is tried again after the next differential
+            m_Logger.LogWarning("Synthetic full backup failed: " + targetPath, "STS_BackupManager", "OnSyntheticFullBackupComplete");
+            m_aCompactingChain.Clear();
+            return;
+        }
+        
+        m_sLastFullBackupFile = targetPath;
+        
+        string checksum = CalculateBackupChecksum(targetPath);
+        if (checksum != "")
+            m_mBackupChecksums.Set(targetPath, checksum);
+        
+        // The synthetic backup supersedes every differential it was folded from; later ones stay in the chain
+        foreach (string diffPath : m_aCompactingChain)
+        {
+            m_aDifferentialChain.RemoveItem(diffPath);
+            m_mBackupChecksums.Remove(diffPath);
+            m_aCorruptedBackups.RemoveItem(diffPath);
+            
+            if (FileIO.FileExists(diffPath) && !FileIO.DeleteFile(diffPath))
+                m_Logger.LogWarning("Failed to delete compacted backup: " + diffPath, "STS_BackupManager", "OnSyntheticFullBackupComplete");
+        }
+        
+        m_Logger.LogInfo(string.Format("Compacted %1 differential backups into %2", m_aCompactingChain.Count(), targetPath), 
+            "STS_BackupManager", "OnSyntheticFullBackupComplete");
+        m_aCompactingChain.Clear();
+        
+        SaveBackupChecksums();
+        CleanupOldBackups();
+        
+        if (m_bEnableCloudBackups)
+            m_aPendingCloudUploads.Insert(targetPath);
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Clean up old backups
     protected void CleanupOldBackups()
@@ -336,14 +438,20 @@ class STS_BackupManager
         if (m_sCloudProvider == "None" && FileIO.FileExists(m_sCloudBackupDir))
         {
             CleanupBackupDirectory(m_sCloudBackupDir, m_iMaxCloudBackups);
+            GetCloudChunkStore().CollectGarbage();
         }
+        
+        // Drop chunks that no retained backup refers to any more
+        STS_DatabaseManager dbManager = STS_DatabaseManager.GetInstance();
+        if (dbManager && dbManager.GetBackupChunkStore())
+            dbManager.GetBackupChunkStore().CollectGarbage();
     }
     
     //------------------------------------------------------------------------------------------------
     // Clean up backup directory to keep only the specified number of most recent backups
     protected void CleanupBackupDirectory(string directory, int maxFiles)
     {
-        array<FindFileResult> files = FindFiles(directory, "*.zip", FindFileFlags.ALL);
+        array<FindFileResult> files = FindFiles(directory, BACKUP_PATTERN, FindFileFlags.ALL);
         
         if (files.Count() <= maxFiles)
             return;
@@ -416,20 +524,52 @@ class STS_BackupManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Upload backup to cloud storage
+    // Upload backup to cloud storage. A backup is a manifest of chunks, so the chunks it lists go up with it;
+    // they are copied first so an uploaded manifest never refers to chunks that are not there.
     protected bool UploadToCloud(string backupFile)
     {
+        STS_BackupManifest manifest = STS_BackupManifest.Load(backupFile);
+        if (!manifest)
+        {
+            m_Logger.LogWarning("Cannot upload unreadable backup manifest: " + backupFile, 
+                "STS_BackupManager", "UploadToCloud");
+            return false;
+        }
+        
+        STS_DatabaseManager dbManager = STS_DatabaseManager.GetInstance();
+        if (!dbManager || !dbManager.GetBackupChunkStore())
+            return false;
+        
         if (m_sCloudProvider == "None")
         {
             // Just copy to cloud backup dir
+            if (!dbManager.GetBackupChunkStore().ExportChunks(manifest, m_sCloudBackupDir + CLOUD_CHUNK_SUBDIR))
+                return false;
+            
             string fileName = GetFileNameOnly(backupFile);
             string destPath = m_sCloudBackupDir + fileName;
             return FileIO.CopyFile(backupFile, destPath);
         }
         
+        set<string> chunks = new set<string>();
+        foreach (STS_BackupManifestFile entry : manifest.m_aFiles)
+        {
+            foreach (string chunk : entry.m_aChunks)
+            {
+                if (!dbManager.GetBackupChunkStore().HasChunk(chunk))
+                {
+                    m_Logger.LogWarning("Backup " + backupFile + " refers to missing chunk " + chunk, 
+                        "STS_BackupManager", "UploadToCloud");
+                    return false;
+                }
+                
+                chunks.Insert(chunk);
+            }
+        }
+        
         // For actual cloud providers, we'd integrate with their APIs
         // For now, we'll simulate the upload and assume it succeeded
-        m_Logger.LogInfo("Simulating cloud upload to " + m_sCloudProvider + ": " + backupFile, 
+        m_Logger.LogInfo(string.Format("Simulating cloud upload to %1: %2 with %3 chunks", m_sCloudProvider, backupFile, chunks.Count()), 
             "STS_BackupManager", "UploadToCloud");
             
         // In a real implementation, code to upload to each provider would go here
@@ -438,18 +578,28 @@ class STS_BackupManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Calculate checksum for backup integrity verification
+    // Garbage collection for the local cloud copy keeps the chunks of the manifests retained there
+    protected STS_ChunkStore GetCloudChunkStore()
+    {
+        if (!m_CloudChunkStore)
+        {
+            m_CloudChunkStore = new STS_ChunkStore(m_sCloudBackupDir + CLOUD_CHUNK_SUBDIR);
+            m_CloudChunkStore.AddManifestDirectory(m_sCloudBackupDir);
+        }
+        
+        return m_CloudChunkStore;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Checksum of a backup: the manifest digest, computed while the backup was written. Only the small
+    // manifest is read; the chunks it lists are checked by the background verifier.
     protected string CalculateBackupChecksum(string backupFile)
     {
-        if (!FileIO.FileExists(backupFile))
+        STS_BackupManifest manifest = STS_BackupManifest.Load(backupFile);
+        if (!manifest || !manifest.IsConsistent())
             return "";
-            
-        // For now, we'll use a simple file size and modification time as a pseudo-checksum
-        // In a real implementation, we would use SHA-256 or another secure hash
-        int fileSize = FileIO.GetFileSize(backupFile);
-        string modTime = GetFileModifiedTime(backupFile);
         
-        return string.Format("%1_%2", fileSize, modTime);
+        return manifest.ComputeDigest();
     }
     
     //------------------------------------------------------------------------------------------------
@@ -529,23 +679,29 @@ class STS_BackupManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Verify the integrity of all backups
+    // Verify the integrity of all backups. Manifest digests are checked right away; chunk contents are
+    // re-hashed by a time-sliced background run that continues where the previous one stopped.
     void VerifyBackupIntegrity()
     {
         if (m_mBackupChecksums.Count() == 0)
             return;
+        
+        if (m_Verifier && m_Verifier.IsRunning())
+            return;
             
         m_Logger.LogInfo("Starting backup integrity verification", "STS_BackupManager", "VerifyBackupIntegrity");
         
         // Clear previous corrupted list
         m_aCorruptedBackups.Clear();
         
+        array<string> missing = new array<string>();
+        array<string> intact = new array<string>();
+        
         foreach (string backupPath, string storedChecksum : m_mBackupChecksums)
         {
             if (!FileIO.FileExists(backupPath))
             {
-                // File is missing, remove from checksums
-                m_mBackupChecksums.Remove(backupPath);
+                missing.Insert(backupPath);
                 continue;
             }
             
@@ -556,12 +712,46 @@ class STS_BackupManager
                 m_Logger.LogWarning("Backup integrity verification failed for: " + backupPath, 
                     "STS_BackupManager", "VerifyBackupIntegrity");
                 m_aCorruptedBackups.Insert(backupPath);
+                continue;
             }
+            
+            intact.Insert(backupPath);
+        }
+        
+        // Missing files are removed from checksums
+        foreach (string missingPath : missing)
+        {
+            m_mBackupChecksums.Remove(missingPath);
         }
         
         // Save updated checksums
         SaveBackupChecksums();
         
+        if (m_Verifier && !intact.IsEmpty())
+            m_Verifier.Start(intact, OnChunkVerificationComplete);
+        else
+            ReportVerificationResult();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void OnChunkVerificationComplete(array<string> corruptBackups, int chunksChecked)
+    {
+        foreach (string backupPath : corruptBackups)
+        {
+            if (m_aCorruptedBackups.Find(backupPath) == -1)
+            {
+                m_Logger.LogWarning("Backup references a corrupt chunk: " + backupPath, 
+                    "STS_BackupManager", "OnChunkVerificationComplete");
+                m_aCorruptedBackups.Insert(backupPath);
+            }
+        }
+        
+        ReportVerificationResult();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void ReportVerificationResult()
+    {
         if (m_aCorruptedBackups.Count() > 0)
         {
             m_Logger.LogError(string.Format("Found %1 corrupted backups", m_aCorruptedBackups.Count()), 
@@ -585,38 +775,14 @@ class STS_BackupManager
             return false;
         }
         
-        // Check if this is a differential backup
+        // Every manifest lists all chunks of the data set, so a differential backup restores on its own in a
+        // single pass; long chains are additionally compacted into synthetic full backups
         bool isDifferential = backupFile.IndexOf("Differential") >= 0;
         
         if (isDifferential)
-        {
-            m_Logger.LogInfo("Attempting to restore from differential backup, need full backup first", 
-                "STS_BackupManager", "RestoreFromBackup");
-                
-            // For differential, we need the base full backup
-            if (m_sLastFullBackupFile == "" || !FileIO.FileExists(m_sLastFullBackupFile))
-            {
-                m_Logger.LogError("Cannot restore differential backup without valid full backup", 
-                    "STS_BackupManager", "RestoreFromBackup");
-                return false;
-            }
-            
-            // First restore the full backup
-            if (!RestoreFullBackup(m_sLastFullBackupFile))
-            {
-                m_Logger.LogError("Failed to restore base full backup", 
-                    "STS_BackupManager", "RestoreFromBackup");
-                return false;
-            }
-            
-            // Then apply the differential
             return RestoreDifferentialBackup(backupFile);
-        }
-        else
-        {
-            // Simple full backup restore
-            return RestoreFullBackup(backupFile);
-        }
+        
+        return RestoreFullBackup(backupFile);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -719,7 +885,7 @@ class STS_BackupManager
         array<ref STS_BackupInfo> backups = new array<ref STS_BackupInfo>();
         
         // Find full backups
-        array<FindFileResult> fullFiles = FindFiles(m_sBackupDir + "Full/", "*.zip", FindFileFlags.ALL);
+        array<FindFileResult> fullFiles = FindFiles(m_sBackupDir + "Full/", BACKUP_PATTERN, FindFileFlags.ALL);
         foreach (FindFileResult file : fullFiles)
         {
             string fullPath = m_sBackupDir + "Full/" + file.GetFilename();
@@ -735,7 +901,7 @@ class STS_BackupManager
         }
         
         // Find differential backups
-        array<FindFileResult> diffFiles = FindFiles(m_sBackupDir + "Differential/", "*.zip", FindFileFlags.ALL);
+        array<FindFileResult> diffFiles = FindFiles(m_sBackupDir + "Differential/", BACKUP_PATTERN, FindFileFlags.ALL);
         foreach (FindFileResult file : diffFiles)
         {
             string fullPath = m_sBackupDir + "Differential/" + file.GetFilename();
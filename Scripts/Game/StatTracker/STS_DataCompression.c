@@ -9,13 +9,29 @@ class STS_DataCompression
     // Config reference
     protected STS_Config m_Config;
     
-    // Compression dictionary for common strings
-    protected ref map<string, int> m_CompressionDictionary;
-    protected ref array<string> m_DecompressionDictionary;
+    // Compression dictionaries by ID. Every compressed blob is tagged with the ID of the dictionary it was
+    // encoded with; new blobs use the active one, normally the newest trained dictionary.
+    protected ref map<int, ref STS_CompressionDictionary> m_mDictionaries;
+    protected STS_CompressionDictionary m_ActiveDictionary;
     
     // Dictionary constants
-    protected const int DICTIONARY_START = 1000; // Start codes at 1000 to avoid conflicts
-    protected const int DICTIONARY_VERSION = 1;  // Version of the dictionary format
+    protected const int BUILTIN_DICTIONARY_ID = 1; // The hardcoded key list, always available
+    protected const string DICTIONARY_DIR = "$profile:StatTracker/Dictionaries/";
+    
+    // Dictionary training
+    protected const int TRAINING_INTERVAL_MS = 86400000; // Once a day
+    protected const int MAX_TRAINED_ENTRIES = 512;
+    protected const float MIN_TRAINING_GAIN = 1.05; // A trained dictionary must save 5% more to be adopted
+    protected static const ref array<string> TRAINING_SOURCES = {
+        "$profile:StatTracker/heatmap_data.json",
+        "$profile:StatTracker/achievements.json",
+        "$profile:StatTracker/progression.json"
+    };
+    
+    // Player stats are saved to hash-partitioned shard files; players are spread evenly over them, so a few
+    // shards are a representative sample
+    protected const string TRAINING_SHARD_PATTERN = "$profile:StatTracker/Shards/player_stats_*.json";
+    protected const int MAX_TRAINING_SHARDS = 4;
     
     //------------------------------------------------------------------------------------------------
     // Constructor
@@ -24,8 +40,11 @@ class STS_DataCompression
         m_Config = STS_Config.GetInstance();
         
         InitializeDictionaries();
+        LoadTrainedDictionaries();
+        
+        GetGame().GetCallqueue().CallLater(TrainDictionary, TRAINING_INTERVAL_MS, true);
         
-        Print("[StatTracker] Data Compression initialized");
+        Print(string.Format("[StatTracker] Data Compression initialized (dictionary %1)", m_ActiveDictionary.GetId()));
     }
     
     //------------------------------------------------------------------------------------------------
@@ -41,11 +60,12 @@ class STS_DataCompression
     }
     
     //------------------------------------------------------------------------------------------------
-    // Initialize the compression dictionaries
+    // Initialize the built-in dictionary. Its entries must never change: blobs tagged with its ID decode with it.
     void InitializeDictionaries()
     {
-        m_CompressionDictionary = new map<string, int>();
-        m_DecompressionDictionary = new array<string>();
+        m_mDictionaries = new map<int, ref STS_CompressionDictionary>();
+        m_ActiveDictionary = new STS_CompressionDictionary(BUILTIN_DICTIONARY_ID);
+        m_mDictionaries.Insert(BUILTIN_DICTIONARY_ID, m_ActiveDictionary);
         
         // Add common keys to the dictionary
         AddToDictionary("kills");
@@ -91,24 +111,155 @@ class STS_DataCompression
         AddToDictionary("deaths_by_weapon");
         AddToDictionary("deaths_by_player");
         
-        // Add weapon names, vehicles, locations, etc.
-        // This would be expanded based on the specific game's requirements
+        // Weapon names, vehicles, locations etc. are picked up by the trained dictionaries
     }
     
     //------------------------------------------------------------------------------------------------
-    // Add a string to the dictionary
+    // Add a string to the built-in dictionary
     protected void AddToDictionary(string value)
     {
-        if (!m_CompressionDictionary.Contains(value))
+        m_mDictionaries.Get(BUILTIN_DICTIONARY_ID).Add(value);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load the trained dictionaries saved so far; the newest one becomes active
+    protected void LoadTrainedDictionaries()
+    {
+        array<string> files = new array<string>();
+        FileIO.FindFiles(files, DICTIONARY_DIR + "dict_*.txt");
+        
+        foreach (string path : files)
+        {
+            STS_CompressionDictionary dictionary = STS_CompressionDictionary.Load(path);
+            if (!dictionary || m_mDictionaries.Contains(dictionary.GetId()))
+            {
+                Print("[StatTracker] Warning: Skipping unreadable compression dictionary " + path);
+                continue;
+            }
+            
+            m_mDictionaries.Insert(dictionary.GetId(), dictionary);
+            if (dictionary.GetId() > m_ActiveDictionary.GetId())
+                m_ActiveDictionary = dictionary;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Dictionary with the given ID, loaded from disk if another server wrote it since start; null if unknown
+    protected STS_CompressionDictionary GetDictionary(int id)
+    {
+        STS_CompressionDictionary dictionary = m_mDictionaries.Get(id);
+        if (dictionary)
+            return dictionary;
+        
+        dictionary = STS_CompressionDictionary.Load(GetDictionaryPath(id));
+        if (!dictionary || dictionary.GetId() != id)
+            return null;
+        
+        m_mDictionaries.Insert(id, dictionary);
+        return dictionary;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // One above the highest ID in memory or on disk; the directory is shared, so other servers may have saved
+    // dictionaries since this one started
+    protected int GetNextDictionaryId()
+    {
+        int highestId = BUILTIN_DICTIONARY_ID;
+        foreach (int id, STS_CompressionDictionary known : m_mDictionaries)
+        {
+            highestId = Math.Max(highestId, id);
+        }
+        
+        array<string> files = new array<string>();
+        FileIO.FindFiles(files, DICTIONARY_DIR + "dict_*.txt");
+        
+        foreach (string path : files)
+        {
+            int idStart = path.LastIndexOf("dict_") + 5;
+            int idEnd = path.LastIndexOf(".txt");
+            if (idEnd > idStart)
+                highestId = Math.Max(highestId, path.Substring(idStart, idEnd - idStart).ToInt());
+        }
+        
+        int nextId = highestId + 1;
+        while (FileIO.FileExists(GetDictionaryPath(nextId)))
+        {
+            nextId++;
+        }
+        
+        return nextId;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected string GetDictionaryPath(int id)
+    {
+        return string.Format("%1dict_%2.txt", DICTIONARY_DIR, id.ToString().PadLeft(4, "0"));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Train a dictionary on the saved payloads and adopt it if it beats the active one on the same sample.
+    // The new dictionary gets the next free ID and is saved next to the older ones, which stay for decoding.
+    bool TrainDictionary()
+    {
+        if (!m_Config.m_bCompressData)
+            return false;
+        
+        array<string> shardFiles = new array<string>();
+        FileIO.FindFiles(shardFiles, TRAINING_SHARD_PATTERN);
+        shardFiles.Sort();
+        
+        array<string> sources = new array<string>();
+        for (int i = 0; i < shardFiles.Count() && i < MAX_TRAINING_SHARDS; i++)
+        {
+            sources.Insert(shardFiles[i]);
+        }
+        sources.InsertAll(TRAINING_SOURCES);
+        
+        STS_DictionaryTrainer trainer = new STS_DictionaryTrainer();
+        foreach (string source : sources)
+        {
+            // Saved files may be compressed themselves; train on what the payload looks like before encoding.
+            // Only as much as the trainer samples is read and decoded.
+            string payload = LoadCompressedData(source, STS_DictionaryTrainer.MAX_SAMPLE_BYTES);
+            if (!payload.IsEmpty())
+                trainer.AddSample(payload);
+        }
+        
+        if (trainer.GetSampledBytes() == 0)
+            return false;
+        
+        int nextId = GetNextDictionaryId();
+        STS_CompressionDictionary candidate = trainer.Build(nextId, MAX_TRAINED_ENTRIES);
+        int candidateSavings = candidate.EstimateSavings(trainer.GetCounts());
+        int activeSavings = m_ActiveDictionary.EstimateSavings(trainer.GetCounts());
+        
+        if (candidateSavings <= activeSavings * MIN_TRAINING_GAIN)
+        {
+            Print(string.Format("[StatTracker] Keeping compression dictionary %1 (saves %2 bytes on %3 sampled, trained would save %4)",
+                m_ActiveDictionary.GetId(), activeSavings, trainer.GetSampledBytes(), candidateSavings));
+            return false;
+        }
+        
+        if (!FileIO.FileExists(DICTIONARY_DIR))
+            FileIO.MakeDirectory(DICTIONARY_DIR);
+        
+        if (!candidate.Save(GetDictionaryPath(nextId)))
         {
-            int code = DICTIONARY_START + m_DecompressionDictionary.Count();
-            m_CompressionDictionary.Insert(value, code);
-            m_DecompressionDictionary.Insert(value);
+            Print("[StatTracker] Error: Failed to save compression dictionary " + GetDictionaryPath(nextId) + " (write failed or the ID was taken)");
+            return false;
         }
+        
+        m_mDictionaries.Insert(nextId, candidate);
+        m_ActiveDictionary = candidate;
+        
+        Print(string.Format("[StatTracker] Adopted compression dictionary %1 with %2 entries (saves %3 bytes on %4 sampled, was %5)",
+            nextId, candidate.Count(), candidateSavings, trainer.GetSampledBytes(), activeSavings));
+        return true;
     }
     
     //------------------------------------------------------------------------------------------------
-    // Compress a JSON string using dictionary substitution
+    // Compress a JSON string using dictionary substitution: every quoted string that is in the dictionary is
+    // replaced by its code, "key" -> "~code~", in one pass over the payload
     string CompressJsonString(string jsonString)
     {
         if (!m_Config.m_bCompressData)
@@ -117,23 +268,43 @@ class STS_DataCompression
         if (jsonString.Length() == 0)
             return "";
             
-        // Replace dictionary keys with shorter codes
-        string compressedJson = jsonString;
+        string compressedJson = SubstituteQuotedStrings(jsonString, m_ActiveDictionary, true);
         
-        // Iterate through dictionary and replace strings
-        foreach (string key, int code : m_CompressionDictionary)
-        {
-            // The format is "key" -> "~code~"
-            string pattern = "\"" + key + "\"";
-            string replacement = "\"~" + code.ToString() + "~\"";
-            
-            compressedJson = compressedJson.Replace(pattern, replacement);
-        }
+        return TagDictionary(compressedJson, m_ActiveDictionary.GetId());
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Dictionary for a document compressed piece by piece with CompressJsonPiece, or null when JSON compression
+    // is off. Take it once per document so every piece uses the same one even if a new dictionary is adopted.
+    STS_CompressionDictionary GetActiveDictionary()
+    {
+        if (!m_Config.m_bCompressData)
+            return null;
+        
+        return m_ActiveDictionary;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Dictionary-compress one piece of a JSON document. Pieces must not split a quoted string. The first piece
+    // starts the document and carries the dictionary tag, so the joined pieces decode with DecompressJsonString
+    // exactly like the output of CompressJsonString.
+    string CompressJsonPiece(string piece, STS_CompressionDictionary dictionary, bool first)
+    {
+        if (!dictionary || piece.IsEmpty())
+            return piece;
         
-        // Add dictionary version marker at the start
-        compressedJson = "{\"~v~\":" + DICTIONARY_VERSION.ToString() + "," + compressedJson.Substring(1);
+        string compressedPiece = SubstituteQuotedStrings(piece, dictionary, true);
+        if (first)
+            compressedPiece = TagDictionary(compressedPiece, dictionary.GetId());
         
-        return compressedJson;
+        return compressedPiece;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Tag a compressed JSON object with the dictionary it was encoded with
+    protected string TagDictionary(string compressedJson, int dictionaryId)
+    {
+        return "{\"~v~\":" + dictionaryId.ToString() + "," + compressedJson.Substring(1, compressedJson.Length() - 1);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -148,42 +319,93 @@ class STS_DataCompression
             return compressedJson; // Not compressed or wrong format
             
         // Extract version
-        int versionStart = compressedJson.IndexOf("\"~v~\":") + 6;
-        int versionEnd = compressedJson.IndexOf(",", versionStart);
+        int versionStart = 7;
+        int versionEnd = compressedJson.IndexOfFrom(versionStart, ",");
         
         if (versionEnd == -1)
             return compressedJson; // Invalid format
             
         string versionStr = compressedJson.Substring(versionStart, versionEnd - versionStart);
-        int version = versionStr.ToInt();
+        STS_CompressionDictionary dictionary = GetDictionary(versionStr.ToInt());
         
-        if (version != DICTIONARY_VERSION)
+        if (!dictionary)
         {
-            Print(string.Format("[StatTracker] Warning: Compressed data version mismatch. Expected %1, got %2", 
-                DICTIONARY_VERSION, version));
+            Print("[StatTracker] Error: Compressed data uses unknown dictionary " + versionStr);
+            return "";
         }
         
-        // Remove version marker
-        compressedJson = "{" + compressedJson.Substring(versionEnd + 1);
+        // Remove version marker and replace codes with original strings
+        compressedJson = "{" + compressedJson.Substring(versionEnd + 1, compressedJson.Length() - versionEnd - 1);
         
-        // Replace codes with original strings
-        string decompressedJson = compressedJson;
+        return SubstituteQuotedStrings(compressedJson, dictionary, false);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Single pass over the quoted strings of a JSON text. When compressing, strings found in the dictionary map
+    // are replaced by their "~code~"; when decompressing, "~code~" strings are looked up in the code table.
+    // Text between replacements is copied in whole runs, so the cost depends on the payload, not the dictionary.
+    protected string SubstituteQuotedStrings(string json, STS_CompressionDictionary dictionary, bool compress)
+    {
+        array<string> pieces = new array<string>();
+        int length = json.Length();
+        int copiedTo = 0; // Everything before this offset has been emitted
+        int pos = 0;
         
-        // Use regex to find all code patterns "~CODE~"
-        for (int code = DICTIONARY_START; code < DICTIONARY_START + m_DecompressionDictionary.Count(); code++)
+        while (pos < length)
         {
-            int index = code - DICTIONARY_START;
+            int open = json.IndexOfFrom(pos, "\"");
+            if (open == -1)
+                break;
             
-            if (index < 0 || index >= m_DecompressionDictionary.Count())
+            int close = FindClosingQuote(json, open + 1);
+            if (close == -1)
+                break;
+            
+            pos = close + 1;
+            
+            string token = json.Substring(open + 1, close - open - 1);
+            string replacement;
+            if (compress)
+                replacement = dictionary.Encode(token);
+            else
+                replacement = dictionary.Decode(token);
+            
+            if (replacement.IsEmpty())
                 continue;
-                
-            string pattern = "\"~" + code.ToString() + "~\"";
-            string replacement = "\"" + m_DecompressionDictionary[index] + "\"";
             
-            decompressedJson = decompressedJson.Replace(pattern, replacement);
+            pieces.Insert(json.Substring(copiedTo, open + 1 - copiedTo));
+            pieces.Insert(replacement);
+            copiedTo = close;
+        }
+        
+        if (pieces.IsEmpty())
+            return json;
+        
+        pieces.Insert(json.Substring(copiedTo, length - copiedTo));
+        return STS_LZCodec.JoinPieces(pieces);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Offset of the quote that ends a string starting at start, skipping escaped quotes; -1 if unterminated
+    static int FindClosingQuote(string json, int start)
+    {
+        int pos = json.IndexOfFrom(start, "\"");
+        while (pos != -1)
+        {
+            // The quote is escaped if an odd number of backslashes precede it
+            int backslashes = 0;
+            while (pos - backslashes - 1 >= start && json.Get(pos - backslashes - 1) == "\\")
+            {
+                backslashes++;
+            }
+            
+            if (backslashes % 2 == 0)
+                return pos;
+            
+            pos = json.IndexOfFrom(pos + 1, "\"");
         }
         
-        return decompressedJson;
+        return -1;
     }
     
     //------------------------------------------------------------------------------------------------
@@ -292,55 +514,145 @@ class STS_DataCompression
     }
     
     //------------------------------------------------------------------------------------------------
-    // Simple string compression for heatmap data or other large datasets
-    // Uses run-length encoding and dictionary compression
+    // Compress a string for storage with the LZ77 codec; see STS_LZCodec for the frame format
     string CompressString(string data)
     {
         if (!m_Config.m_bCompressData || data.Length() == 0)
             return data;
             
-        // Convert string to array of character codes
-        array<int> charCodes = new array<int>();
-        for (int i = 0; i < data.Length(); i++)
+        return STS_LZCodec.Compress(data);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Decompress a string produced by CompressString. Unframed input is returned unchanged and data from the
+    // old run-length encoder is still understood; a corrupt frame yields an empty string.
+    string DecompressString(string compressed)
+    {
+        if (compressed.Length() == 0)
+            return "";
+        
+        if (compressed.IndexOf("RLE1:") == 0)
+            return DecompressLegacyString(compressed);
+        
+        if (!STS_LZCodec.IsFramed(compressed))
+            return compressed; // Not compressed
+        
+        string data;
+        if (!STS_LZCodec.Decompress(compressed, data))
+        {
+            Print("[StatTracker] Error: Compressed data is corrupt or from an unsupported format version");
+            return "";
+        }
+        
+        return data;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write data to a file as a compressed frame; the file is replaced only once the frame is complete
+    bool SaveCompressedData(string filePath, string data)
+    {
+        string tempPath = filePath + ".tmp";
+        FileHandle file = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!file)
         {
-            charCodes.Insert(data.CharAt(i));
+            Print("[StatTracker] Error: Failed to open " + tempPath + " for writing");
+            return false;
         }
         
-        // Run-length encode the character codes
-        array<int> encoded = RunLengthEncode(charCodes);
+        file.Write(STS_LZCodec.Compress(data));
+        file.Close();
         
-        // Convert encoded data back to string
-        string compressed = "RLE1:"; // Marker and version
+        if (!FileIO.CopyFile(tempPath, filePath))
+            return false;
         
-        for (int i = 0; i < encoded.Count(); i++)
+        FileIO.DeleteFile(tempPath);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read a file written by SaveCompressedData, or by a save that dictionary-compressed its JSON first and may
+    // have written it as one frame per line; plain files are returned as they are. Returns an empty string if
+    // the file is missing or corrupt. With maxBytes set, reading stops once that much has been loaded: frames
+    // are decoded one at a time, so at most one frame past the limit is, and the result is only a prefix.
+    string LoadCompressedData(string filePath, int maxBytes = -1)
+    {
+        FileHandle file = FileIO.OpenFile(filePath, FileMode.READ);
+        if (!file)
+            return "";
+        
+        // Frames never contain a raw newline, so in a framed file each line is one frame
+        array<string> blocks = new array<string>();
+        int loadedBytes = 0;
+        bool framed = false;
+        
+        string line;
+        while ((maxBytes < 0 || loadedBytes < maxBytes) && file.ReadLine(line) >= 0)
         {
-            // Use a character we're unlikely to see in normal data as separator
-            if (i > 0)
-                compressed += "|";
+            if (blocks.IsEmpty())
+                framed = STS_LZCodec.IsFramed(line);
+            
+            if (framed)
+            {
+                if (line.IsEmpty())
+                    continue;
                 
-            compressed += encoded[i].ToString();
+                string data;
+                if (!STS_LZCodec.Decompress(line, data))
+                {
+                    file.Close();
+                    Print("[StatTracker] Error: Compressed file is corrupt: " + filePath);
+                    return "";
+                }
+                
+                line = data;
+            }
+            else if (!blocks.IsEmpty())
+            {
+                line = "\n" + line;
+            }
+            
+            blocks.Insert(line);
+            loadedBytes += line.Length();
         }
         
-        return compressed;
+        file.Close();
+        
+        string content = STS_LZCodec.JoinPieces(blocks);
+        if (content.IsEmpty())
+            return "";
+        
+        return DecompressJsonString(content);
     }
     
     //------------------------------------------------------------------------------------------------
-    // Decompress a string that was compressed using CompressString
-    string DecompressString(string compressed)
+    // Whole content of a text file, lines joined with newlines
+    string ReadTextFile(string filePath)
     {
-        if (compressed.Length() == 0)
+        FileHandle file = FileIO.OpenFile(filePath, FileMode.READ);
+        if (!file)
             return "";
+        
+        array<string> lines = new array<string>();
+        string line;
+        while (file.ReadLine(line) >= 0)
+        {
+            if (!lines.IsEmpty())
+                line = "\n" + line;
             
-        // Check if this is a compressed string
-        if (compressed.IndexOf("RLE1:") != 0)
-            return compressed; // Not compressed or wrong format
-            
-        // Remove marker and version
-        compressed = compressed.Substring(5);
+            lines.Insert(line);
+        }
+        file.Close();
         
+        return STS_LZCodec.JoinPieces(lines);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Decode the "RLE1:" format of the old run-length encoder
+    protected string DecompressLegacyString(string compressed)
+    {
         // Split into array of integers
         array<string> parts = new array<string>();
-        compressed.Split("|", parts);
+        compressed.Substring(5, compressed.Length() - 5).Split("|", parts);
         
         array<int> encoded = new array<int>();
         foreach (string part : parts)
@@ -348,16 +660,14 @@ class STS_DataCompression
             encoded.Insert(part.ToInt());
         }
         
-        // Run-length decode
+        // Run-length decode; the bytes are joined pairwise rather than appended one at a time
         array<int> charCodes = RunLengthDecode(encoded);
-        
-        // Convert character codes back to string
-        string decompressed = "";
+        array<string> pieces = new array<string>();
         foreach (int code : charCodes)
         {
-            decompressed += String.FromAscii(code);
+            pieces.Insert(string.FromAscii(code));
         }
         
-        return decompressed;
+        return STS_LZCodec.JoinPieces(pieces);
     }
 } 
\ No newline at end of file
@@ -0,0 +1,245 @@
+// STS_DictionaryTrainer.c
+// Numbered compression dictionaries for JSON payloads and the trainer that builds them from saved data.
+// A dictionary never changes once it has been saved; every compressed blob names the dictionary it was encoded
+// with, so new dictionaries can be adopted as the data changes while older blobs keep decoding.
+//
+// Dictionary file format (line based):
+//   STSDICT <id>
+//   <entry>                (one per line; the entry on line n + 2 has code CODE_START + n)
+
+//------------------------------------------------------------------------------------------------
+class STS_CompressionDictionary
+{
+    static const int CODE_START = 1000; // Codes start at 1000 so every code has the same length
+    
+    protected int m_iId;
+    protected ref array<string> m_aEntries = new array<string>();
+    protected ref map<string, int> m_mCodes = new map<string, int>();
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_CompressionDictionary(int id)
+    {
+        m_iId = id;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Append an entry; false if it is already present
+    bool Add(string value)
+    {
+        if (m_mCodes.Contains(value))
+            return false;
+        
+        m_mCodes.Insert(value, CODE_START + m_aEntries.Count());
+        m_aEntries.Insert(value);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // "~code~" for an entry, or an empty string if it is not in the dictionary
+    string Encode(string token)
+    {
+        int code;
+        if (!m_mCodes.Find(token, code))
+            return string.Empty;
+        
+        return "~" + code.ToString() + "~";
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Entry for a "~code~" token, or an empty string if the token is not a code of this dictionary
+    string Decode(string token)
+    {
+        int length = token.Length();
+        if (length < 3 || token.Get(0) != "~" || token.Get(length - 1) != "~")
+            return string.Empty;
+        
+        int index = token.Substring(1, length - 2).ToInt() - CODE_START;
+        if (index < 0 || index >= m_aEntries.Count())
+            return string.Empty;
+        
+        return m_aEntries[index];
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Bytes this dictionary would save on strings occurring with the given counts
+    int EstimateSavings(map<string, int> counts)
+    {
+        int savings = 0;
+        foreach (string token, int count : counts)
+        {
+            string code = Encode(token);
+            if (!code.IsEmpty())
+                savings += count * (token.Length() - code.Length());
+        }
+        
+        return savings;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetId()
+    {
+        return m_iId;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_aEntries.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write the dictionary to path; false if it could not be written or a file is already there, since
+    // blobs of another dictionary with the same ID may depend on it
+    bool Save(string path)
+    {
+        if (FileIO.FileExists(path))
+            return false;
+        
+        string tempPath = path + ".tmp";
+        FileHandle file = FileIO.OpenFile(tempPath, FileMode.WRITE);
+        if (!file)
+            return false;
+        
+        file.WriteLine("STSDICT " + m_iId.ToString());
+        foreach (string entry : m_aEntries)
+        {
+            file.WriteLine(entry);
+        }
+        file.Close();
+        
+        // Another server may have claimed the ID while the file was written
+        if (FileIO.FileExists(path) || !FileIO.CopyFile(tempPath, path))
+        {
+            FileIO.DeleteFile(tempPath);
+            return false;
+        }
+        
+        FileIO.DeleteFile(tempPath);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Read a dictionary file; returns null if it is missing or malformed
+    static STS_CompressionDictionary Load(string path)
+    {
+        FileHandle file = FileIO.OpenFile(path, FileMode.READ);
+        if (!file)
+            return null;
+        
+        string line;
+        if (file.ReadLine(line) < 0 || !line.StartsWith("STSDICT "))
+        {
+            file.Close();
+            return null;
+        }
+        
+        int id = line.Substring(8, line.Length() - 8).ToInt();
+        if (id <= 0)
+        {
+            file.Close();
+            return null;
+        }
+        
+        STS_CompressionDictionary dictionary = new STS_CompressionDictionary(id);
+        while (file.ReadLine(line) >= 0)
+        {
+            // Entries are unique when saved; a duplicate would shift every later code
+            if (!dictionary.Add(line))
+            {
+                file.Close();
+                return null;
+            }
+        }
+        file.Close();
+        
+        return dictionary;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Counts the quoted strings (keys and string values) of sample payloads and turns the ones that save the most
+// bytes into a new dictionary
+class STS_DictionaryTrainer
+{
+    // Bounds on what is sampled, so training stays cheap on large files
+    static const int MAX_SAMPLE_BYTES = 262144;
+    protected const int MAX_DISTINCT_TOKENS = 50000;
+    protected const int MAX_TOKEN_LENGTH = 64;
+    
+    protected ref map<string, int> m_mCounts = new map<string, int>();
+    protected int m_iSampledBytes = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    // Count the quoted strings of a payload; only its first MAX_SAMPLE_BYTES bytes are looked at
+    void AddSample(string payload)
+    {
+        int length = Math.Min(payload.Length(), MAX_SAMPLE_BYTES);
+        m_iSampledBytes += length;
+        
+        int pos = 0;
+        while (pos < length)
+        {
+            int open = payload.IndexOfFrom(pos, "\"");
+            if (open == -1 || open >= length)
+                break;
+            
+            int close = STS_DataCompression.FindClosingQuote(payload, open + 1);
+            if (close == -1 || close >= length)
+                break;
+            
+            pos = close + 1;
+            
+            // Strings that already look like codes would be ambiguous when decoding
+            string token = payload.Substring(open + 1, close - open - 1);
+            if (token.IsEmpty() || token.Length() > MAX_TOKEN_LENGTH || token.Contains("~"))
+                continue;
+            
+            int count = m_mCounts.Get(token);
+            if (count == 0 && m_mCounts.Count() >= MAX_DISTINCT_TOKENS)
+                continue;
+            
+            m_mCounts.Set(token, count + 1);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Dictionary of up to maxEntries strings, highest yield first; strings seen once or too short to gain
+    // from a code are left out
+    STS_CompressionDictionary Build(int id, int maxEntries)
+    {
+        int codeLength = ("~" + STS_CompressionDictionary.CODE_START.ToString() + "~").Length();
+        
+        // Yield is zero-padded in front of each candidate so a plain string sort ranks them
+        array<string> ranked = new array<string>();
+        foreach (string token, int count : m_mCounts)
+        {
+            int yield = count * (token.Length() - codeLength);
+            if (count < 2 || yield <= 0)
+                continue;
+            
+            ranked.Insert(yield.ToString().PadLeft(10, "0") + token);
+        }
+        
+        ranked.Sort(true);
+        
+        STS_CompressionDictionary dictionary = new STS_CompressionDictionary(id);
+        for (int i = 0; i < ranked.Count() && dictionary.Count() < maxEntries; i++)
+        {
+            dictionary.Add(ranked[i].Substring(10, ranked[i].Length() - 10));
+        }
+        
+        return dictionary;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    map<string, int> GetCounts()
+    {
+        return m_mCounts;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetSampledBytes()
+    {
+        return m_iSampledBytes;
+    }
+}
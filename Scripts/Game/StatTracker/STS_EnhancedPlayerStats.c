@@ -84,6 +84,48 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         m_iBestLeaderboardRank = 0;
     }
     
+    //------------------------------------------------------------------------------------------------
+    override protected void CopySnapshotTo(STS_PlayerStats snapshot)
+    {
+        super.CopySnapshotTo(snapshot);
+        
+        STS_EnhancedPlayerStats enhanced = STS_EnhancedPlayerStats.Cast(snapshot);
+        if (!enhanced)
+            return;
+        
+        enhanced.m_sUID = m_sUID;
+        enhanced.m_sSteamID = m_sSteamID;
+        enhanced.m_fFirstLogin = m_fFirstLogin;
+        enhanced.m_fLastLogin = m_fLastLogin;
+        enhanced.m_fLastLogout = m_fLastLogout;
+        enhanced.m_iTotalSessions = m_iTotalSessions;
+        
+        enhanced.m_iHeadshotKills = m_iHeadshotKills;
+        enhanced.m_iLongestKill = m_iLongestKill;
+        enhanced.m_mKillsByWeapon.Copy(m_mKillsByWeapon);
+        
+        enhanced.m_fDistanceTraveled = m_fDistanceTraveled;
+        enhanced.m_fDistanceOnFoot = m_fDistanceOnFoot;
+        enhanced.m_fDistanceInVehicles = m_fDistanceInVehicles;
+        enhanced.m_aVisitedLocations.Copy(m_aVisitedLocations);
+        
+        enhanced.m_fDamageDealt = m_fDamageDealt;
+        enhanced.m_fDamageTaken = m_fDamageTaken;
+        enhanced.m_iTimesBled = m_iTimesBled;
+        enhanced.m_iTimesUnconcious = m_iTimesUnconcious;
+        
+        enhanced.m_iMoneyEarned = m_iMoneyEarned;
+        enhanced.m_iMoneySpent = m_iMoneySpent;
+        enhanced.m_mItemsBought.Copy(m_mItemsBought);
+        enhanced.m_mItemsSold.Copy(m_mItemsSold);
+        
+        enhanced.m_aAchievements.Copy(m_aAchievements);
+        enhanced.m_mChallenges.Copy(m_mChallenges);
+        
+        enhanced.m_iLastLeaderboardRank = m_iLastLeaderboardRank;
+        enhanced.m_iBestLeaderboardRank = m_iBestLeaderboardRank;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Record a player kill with detailed information
     void RecordKill(string weaponName, float distance, bool isHeadshot = false)
@@ -104,6 +146,8 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         // Update longest kill if applicable
         if (distance > m_iLongestKill)
             m_iLongestKill = distance;
+        
+        MarkDirty(STS_EStatsDirtyFlags.COMBAT | STS_EStatsDirtyFlags.WEAPONS);
             
         // Check for achievements
         CheckKillAchievements();
@@ -124,6 +168,8 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
             
         m_fLastLogin = currentTime;
         m_iTotalSessions++;
+        
+        MarkDirty(STS_EStatsDirtyFlags.SESSION | STS_EStatsDirtyFlags.IDENTITY);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -137,6 +183,8 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         float sessionDuration = m_fLastLogout - m_fLastLogin;
         if (sessionDuration > 0)
             m_fTotalPlaytime += sessionDuration;
+        
+        MarkDirty(STS_EStatsDirtyFlags.SESSION);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -144,6 +192,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
     void RecordDamageDealt(float amount, EDamageType damageType, int hitZone)
     {
         m_fDamageDealt += amount;
+        MarkDirty(STS_EStatsDirtyFlags.DAMAGE);
         
         // Check for specific damage achievements
         if (amount > 50)
@@ -159,6 +208,8 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         // Check if this damage caused bleeding
         if (damageType == EDamageType.BLEEDING)
             m_iTimesBled++;
+        
+        MarkDirty(STS_EStatsDirtyFlags.DAMAGE);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -171,6 +222,8 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
             m_fDistanceInVehicles += distance;
         else
             m_fDistanceOnFoot += distance;
+        
+        MarkDirty(STS_EStatsDirtyFlags.MOVEMENT);
             
         // Check for movement-based achievements
         if (m_fDistanceTraveled > 10000)
@@ -198,6 +251,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         if (!alreadyVisited)
         {
             m_aVisitedLocations.Insert(position);
+            MarkDirty(STS_EStatsDirtyFlags.MOVEMENT);
             
             // Update visited locations count in challenges
             IncrementChallenge("LocationsVisited");
@@ -213,6 +267,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
             
         m_mItemsBought[itemName] += count;
         m_iMoneySpent += price;
+        MarkDirty(STS_EStatsDirtyFlags.ECONOMY);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -224,6 +279,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
             
         m_mItemsSold[itemName] += count;
         m_iMoneyEarned += price;
+        MarkDirty(STS_EStatsDirtyFlags.ECONOMY);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -231,16 +287,22 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
     void RecordUnconsciousness()
     {
         m_iTimesUnconcious++;
+        MarkDirty(STS_EStatsDirtyFlags.DAMAGE);
     }
     
     //------------------------------------------------------------------------------------------------
     // Update player's rank on leaderboard
     void UpdateLeaderboardRank(int newRank)
     {
+        if (newRank == m_iLastLeaderboardRank)
+            return;
+        
         m_iLastLeaderboardRank = newRank;
         
         if (m_iBestLeaderboardRank == 0 || newRank < m_iBestLeaderboardRank)
             m_iBestLeaderboardRank = newRank;
+        
+        MarkDirty(STS_EStatsDirtyFlags.LEADERBOARD);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -255,6 +317,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
         }
         
         m_aAchievements.Insert(achievementName);
+        MarkDirty(STS_EStatsDirtyFlags.ACHIEVEMENTS);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -265,6 +328,7 @@ class STS_EnhancedPlayerStats : STS_PlayerStats
             m_mChallenges.Insert(challengeName, 0);
             
         m_mChallenges[challengeName] += amount;
+        MarkDirty(STS_EStatsDirtyFlags.ACHIEVEMENTS);
         
         // Check if the challenge is completed based on thresholds
         CheckChallengeCompletion(challengeName);
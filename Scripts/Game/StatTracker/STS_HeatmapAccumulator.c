@@ -0,0 +1,268 @@
+// STS_HeatmapAccumulator.c
+// Live raster for one heatmap type at one resolution. Every heat point is stamped into the grid once, when it
+// is added, so serving a request only needs the normalization pass. Rows touched since the last serialization
+// are tracked; as long as the maximum is unchanged only those rows are written again.
+
+class STS_HeatmapAccumulator
+{
+    protected string m_sType;
+    protected int m_iResolution;
+    protected float m_fCellSizeX;
+    protected float m_fCellSizeZ;
+    protected int m_iRadiusCells;
+    
+    // Cell values, row-major with x as the row like the "data" array of the JSON
+    protected ref array<float> m_aCells = new array<float>();
+    protected float m_fMaxValue = 0;
+    
+    // Gaussian falloff for every offset of the stamp, (2r + 1)^2 entries; -1 outside the radius
+    protected ref array<float> m_aKernel = new array<float>();
+    
+    // Serialized rows and the maximum they were normalized with
+    protected ref array<string> m_aRowJson = new array<string>();
+    protected ref array<bool> m_aRowDirty = new array<bool>();
+    protected float m_fSerializedMax = -1;
+    protected string m_sJson;
+    
+    // Bounding box of the cells changed since the last serialization
+    protected bool m_bDirty = true;
+    protected int m_iDirtyMinX;
+    protected int m_iDirtyMaxX;
+    protected int m_iDirtyMinZ;
+    protected int m_iDirtyMaxZ;
+    
+    // Set when the points changed in a way stamps cannot follow (decay, removal, reload)
+    protected bool m_bStale = true;
+    protected int m_iLastUsed = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_HeatmapAccumulator(string type, int resolution, vector worldSize, float pointRadius)
+    {
+        m_sType = type;
+        m_iResolution = Math.Max(1, resolution);
+        m_fCellSizeX = worldSize[0] / m_iResolution;
+        m_fCellSizeZ = worldSize[2] / m_iResolution;
+        m_iRadiusCells = Math.Clamp(Math.Round(pointRadius / m_fCellSizeX), 1, Math.Max(1, m_iResolution / 4));
+        
+        m_aCells.Resize(m_iResolution * m_iResolution);
+        m_aRowJson.Resize(m_iResolution);
+        m_aRowDirty.Resize(m_iResolution);
+        
+        int r = m_iRadiusCells;
+        for (int dx = -r; dx <= r; dx++)
+        {
+            for (int dz = -r; dz <= r; dz++)
+            {
+                float distance = Math.Sqrt(dx * dx + dz * dz);
+                if (distance <= r)
+                    m_aKernel.Insert(Math.Exp(-(distance * distance) / (2 * r * r)));
+                else
+                    m_aKernel.Insert(-1);
+            }
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Add the heat of one point to the cells within its radius
+    void Stamp(vector position, float intensity)
+    {
+        int resolution = m_iResolution;
+        int r = m_iRadiusCells;
+        int gridX = Math.Clamp(Math.Round(position[0] / m_fCellSizeX), 0, resolution - 1);
+        int gridZ = Math.Clamp(Math.Round(position[2] / m_fCellSizeZ), 0, resolution - 1);
+        
+        int minX = Math.Max(0, gridX - r);
+        int maxX = Math.Min(resolution - 1, gridX + r);
+        int minZ = Math.Max(0, gridZ - r);
+        int maxZ = Math.Min(resolution - 1, gridZ + r);
+        int kernelSize = 2 * r + 1;
+        
+        for (int x = minX; x <= maxX; x++)
+        {
+            int rowStart = x * resolution;
+            int kernelRow = (x - gridX + r) * kernelSize;
+            
+            for (int z = minZ; z <= maxZ; z++)
+            {
+                float weight = m_aKernel[kernelRow + z - gridZ + r];
+                if (weight < 0)
+                    continue;
+                
+                float value = m_aCells[rowStart + z] + intensity * weight;
+                m_aCells[rowStart + z] = value;
+                if (value > m_fMaxValue)
+                    m_fMaxValue = value;
+            }
+            
+            m_aRowDirty[x] = true;
+        }
+        
+        // Negative heat can lower the maximum, which only a full scan finds
+        if (intensity < 0)
+            RecomputeMax();
+        
+        MarkDirty(minX, maxX, minZ, maxZ);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Reset the grid and stamp every point again
+    void Rebuild(array<ref STS_HeatmapPoint> points)
+    {
+        for (int i = 0; i < m_aCells.Count(); i++)
+        {
+            m_aCells[i] = 0;
+        }
+        
+        m_fMaxValue = 0;
+        
+        if (points)
+        {
+            foreach (STS_HeatmapPoint point : points)
+            {
+                Stamp(point.m_vPosition, point.m_fIntensity);
+            }
+        }
+        
+        for (int x = 0; x < m_iResolution; x++)
+        {
+            m_aRowDirty[x] = true;
+        }
+        
+        MarkDirty(0, m_iResolution - 1, 0, m_iResolution - 1);
+        m_bStale = false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Heatmap JSON normalized to the current maximum; rows are only serialized again when they changed or the
+    // maximum moved
+    string ToJSON()
+    {
+        if (!m_bDirty && m_fMaxValue == m_fSerializedMax)
+            return m_sJson;
+        
+        bool allRows = m_fMaxValue != m_fSerializedMax;
+        int resolution = m_iResolution;
+        
+        for (int x = 0; x < resolution; x++)
+        {
+            if (!allRows && !m_aRowDirty[x])
+                continue;
+            
+            int rowStart = x * resolution;
+            array<string> values = new array<string>();
+            values.Resize(resolution);
+            
+            for (int z = 0; z < resolution; z++)
+            {
+                float value = m_aCells[rowStart + z];
+                if (m_fMaxValue > 0)
+                    value /= m_fMaxValue;
+                
+                values[z] = value.ToString();
+            }
+            
+            m_aRowJson[x] = "[" + JoinValues(values) + "]";
+            m_aRowDirty[x] = false;
+        }
+        
+        array<string> pieces = new array<string>();
+        pieces.Insert("{\"type\":\"" + m_sType + "\",\"resolution\":" + resolution + ",\"data\":[");
+        for (int row = 0; row < resolution; row++)
+        {
+            if (row > 0)
+                pieces.Insert("," + m_aRowJson[row]);
+            else
+                pieces.Insert(m_aRowJson[row]);
+        }
+        pieces.Insert("]}");
+        
+        m_sJson = STS_LZCodec.JoinPieces(pieces);
+        m_fSerializedMax = m_fMaxValue;
+        m_bDirty = false;
+        
+        return m_sJson;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Cells changed since the last serialization, inclusive; false if nothing changed
+    bool GetDirtyRegion(out int minX, out int maxX, out int minZ, out int maxZ)
+    {
+        minX = m_iDirtyMinX;
+        maxX = m_iDirtyMaxX;
+        minZ = m_iDirtyMinZ;
+        maxZ = m_iDirtyMaxZ;
+        return m_bDirty;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Have the next request rebuild the grid from the points
+    void MarkStale()
+    {
+        m_bStale = true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsStale()
+    {
+        return m_bStale;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Touch()
+    {
+        m_iLastUsed = System.GetUnixTime();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetLastUsed()
+    {
+        return m_iLastUsed;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int GetResolution()
+    {
+        return m_iResolution;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void MarkDirty(int minX, int maxX, int minZ, int maxZ)
+    {
+        if (!m_bDirty)
+        {
+            m_bDirty = true;
+            m_iDirtyMinX = minX;
+            m_iDirtyMaxX = maxX;
+            m_iDirtyMinZ = minZ;
+            m_iDirtyMaxZ = maxZ;
+            return;
+        }
+        
+        m_iDirtyMinX = Math.Min(m_iDirtyMinX, minX);
+        m_iDirtyMaxX = Math.Max(m_iDirtyMaxX, maxX);
+        m_iDirtyMinZ = Math.Min(m_iDirtyMinZ, minZ);
+        m_iDirtyMaxZ = Math.Max(m_iDirtyMaxZ, maxZ);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void RecomputeMax()
+    {
+        m_fMaxValue = 0;
+        foreach (float value : m_aCells)
+        {
+            if (value > m_fMaxValue)
+                m_fMaxValue = value;
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static string JoinValues(array<string> values)
+    {
+        for (int i = 0; i < values.Count() - 1; i++)
+        {
+            values[i] = values[i] + ",";
+        }
+        
+        return STS_LZCodec.JoinPieces(values);
+    }
+}
@@ -98,6 +98,166 @@ class STS_HeatmapHotspot
     }
 }
 
+//------------------------------------------------------------------------------------------------
+// Writes the heat data file one point per unit through the time-sliced serializer. The point arrays and their
+// intensities are copied in Begin, so decay or trimming between frames cannot skip, repeat or alter points.
+// Compressed saves are written as one frame per line, each holding about COMPRESSION_BLOCK_SIZE bytes of JSON,
+// so no unit compresses more than one block however many points there are.
+class STS_HeatDataSaveJob : STS_SerializationJob
+{
+    protected map<string, ref array<ref STS_HeatmapPoint>> m_HeatData;
+    protected ref array<string> m_aTypes = new array<string>();
+    protected ref array<ref array<ref STS_HeatmapPoint>> m_aSnapshots = new array<ref array<ref STS_HeatmapPoint>>();
+    protected ref array<ref array<float>> m_aIntensities = new array<ref array<float>>();
+    protected int m_iTypeIndex = 0;
+    protected int m_iPointIndex = 0;
+    protected bool m_bTypeOpen = false;
+    protected int m_iPointsWritten = 0;
+    
+    // Text waiting to be compressed as the next block
+    protected bool m_bCompress;
+    protected ref array<string> m_aBuffer = new array<string>();
+    protected int m_iBufferedBytes = 0;
+    protected int m_iBlocksWritten = 0;
+    protected ref STS_CompressionDictionary m_Dictionary;
+    protected const int COMPRESSION_BLOCK_SIZE = 4096;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_HeatDataSaveJob(string targetPath, map<string, ref array<ref STS_HeatmapPoint>> heatData, bool compress)
+    {
+        m_sTargetPath = targetPath;
+        m_HeatData = heatData;
+        m_bCompress = compress;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void Begin(FileHandle file)
+    {
+        if (m_HeatData)
+        {
+            foreach (string type, array<ref STS_HeatmapPoint> points : m_HeatData)
+            {
+                array<ref STS_HeatmapPoint> snapshot = new array<ref STS_HeatmapPoint>();
+                array<float> intensities = new array<float>();
+                if (points)
+                {
+                    snapshot.Copy(points);
+                    
+                    // Decay changes intensities in place, so the shared points alone are not a stable copy
+                    foreach (STS_HeatmapPoint snapshotPoint : points)
+                    {
+                        intensities.Insert(snapshotPoint.m_fIntensity);
+                    }
+                }
+                
+                m_aTypes.Insert(type);
+                m_aSnapshots.Insert(snapshot);
+                m_aIntensities.Insert(intensities);
+            }
+        }
+        
+        if (m_bCompress)
+            m_Dictionary = STS_DataCompression.GetInstance().GetActiveDictionary();
+        
+        Emit(file, "{");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool WriteNext(FileHandle file)
+    {
+        if (m_iTypeIndex >= m_aTypes.Count())
+            return false;
+        
+        string type = m_aTypes[m_iTypeIndex];
+        
+        if (!m_bTypeOpen)
+        {
+            string separator = "";
+            if (m_iTypeIndex > 0)
+                separator = ",";
+            
+            Emit(file, separator + "\"" + type + "\":[");
+            m_bTypeOpen = true;
+            return true;
+        }
+        
+        array<ref STS_HeatmapPoint> points = m_aSnapshots[m_iTypeIndex];
+        if (m_iPointIndex < points.Count())
+        {
+            STS_HeatmapPoint point = points[m_iPointIndex];
+            
+            string json = "";
+            if (m_iPointIndex > 0)
+                json = ",";
+            
+            json += "{";
+            json += "\"x\":" + point.m_vPosition[0].ToString() + ",";
+            json += "\"y\":" + point.m_vPosition[1].ToString() + ",";
+            json += "\"z\":" + point.m_vPosition[2].ToString() + ",";
+            json += "\"i\":" + m_aIntensities[m_iTypeIndex][m_iPointIndex].ToString() + ",";
+            json += "\"t\":" + point.m_fTimestamp.ToString() + ",";
+            json += "\"m\":\"" + point.m_sMetadata + "\"";
+            json += "}";
+            
+            Emit(file, json);
+            m_iPointIndex++;
+            m_iPointsWritten++;
+            return true;
+        }
+        
+        Emit(file, "]");
+        m_bTypeOpen = false;
+        m_iTypeIndex++;
+        m_iPointIndex = 0;
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void End(FileHandle file)
+    {
+        Emit(file, "}");
+        
+        if (m_bCompress && !m_aBuffer.IsEmpty())
+            WriteBlock(file);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (success)
+            Print(string.Format("[StatTracker] Saved %1 heatmap points", m_iPointsWritten));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Emit(FileHandle file, string text)
+    {
+        if (!m_bCompress)
+        {
+            file.WriteLine(text);
+            return;
+        }
+        
+        m_aBuffer.Insert(text);
+        m_iBufferedBytes += text.Length();
+        
+        if (m_iBufferedBytes >= COMPRESSION_BLOCK_SIZE)
+            WriteBlock(file);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Compress the buffered text as one frame: dictionary codes shorten the keys, then LZ takes out the
+    // repetition between points. Units never split a quoted string, so blocks can be encoded separately.
+    protected void WriteBlock(FileHandle file)
+    {
+        string block = STS_DataCompression.GetInstance().CompressJsonPiece(STS_LZCodec.JoinPieces(m_aBuffer), m_Dictionary, m_iBlocksWritten == 0);
+        file.WriteLine(STS_LZCodec.Compress(block));
+        
+        m_aBuffer.Clear();
+        m_iBufferedBytes = 0;
+        m_iBlocksWritten++;
+    }
+}
+
 class STS_HeatmapManager
 {
     // Singleton instance
@@ -109,8 +269,17 @@ class STS_HeatmapManager
     // Heat data storage by type
     protected ref map<string, ref array<ref STS_HeatmapPoint>> m_HeatData;
     
-    // Cache of generated heatmaps
-    protected ref map<string, ref STS_HeatmapCache> m_HeatmapCache;
+    // Live rasters by type and resolution, kept up to date as points are added. The configured resolution is
+    // kept; rasters at other resolutions are bounded in count and total cells and dropped once idle.
+    protected ref map<string, ref map<int, ref STS_HeatmapAccumulator>> m_Accumulators;
+    protected const int MAX_ACCUMULATORS_PER_TYPE = 4;
+    protected const int MAX_EXTRA_ACCUMULATOR_CELLS = 2097152; // Two 1024 x 1024 rasters
+    protected const int ACCUMULATOR_IDLE_SECONDS = 600;
+    protected const int ACCUMULATOR_EVICTION_INTERVAL_MS = 60000;
+    
+    // Requested resolutions are clamped to this range
+    protected const int MIN_RESOLUTION = 1;
+    protected const int MAX_RESOLUTION = 1024;
     
     // Heatmap types
     static const string HEATMAP_KILLS = "kills";
@@ -139,6 +308,7 @@ class STS_HeatmapManager
     protected float m_fHotspotThreshold = 0.75; // Top 25% of heat intensity
     protected float m_fLastHotspotUpdate = 0;
     protected const float HOTSPOT_UPDATE_INTERVAL = 300; // Update hotspots every 5 minutes
+    protected ref STS_HotspotClusterer m_HotspotClusterer;
     
     //------------------------------------------------------------------------------------------------
     // Constructor
@@ -152,8 +322,9 @@ class STS_HeatmapManager
         
         // Initialize heat data storage
         m_HeatData = new map<string, ref array<ref STS_HeatmapPoint>>();
-        m_HeatmapCache = new map<string, ref STS_HeatmapCache>();
+        m_Accumulators = new map<string, ref map<int, ref STS_HeatmapAccumulator>>();
         m_Hotspots = new array<ref STS_HeatmapHotspot>();
+        m_HotspotClusterer = new STS_HotspotClusterer();
         
         // Initialize heat data arrays for each type
         m_HeatData.Set(HEATMAP_KILLS, new array<ref STS_HeatmapPoint>());
@@ -185,7 +356,7 @@ class STS_HeatmapManager
         if (m_Config)
         {
             if (m_Config.m_iHeatmapResolution > 0)
-                m_iMapResolution = m_Config.m_iHeatmapResolution;
+                m_iMapResolution = Math.Clamp(m_Config.m_iHeatmapResolution, MIN_RESOLUTION, MAX_RESOLUTION);
                 
             if (m_Config.m_fHeatmapDecayRate > 0)
                 m_fDecayRate = m_Config.m_fHeatmapDecayRate;
@@ -215,6 +386,9 @@ class STS_HeatmapManager
         // Start regular hotspot analysis
         GetGame().GetCallqueue().CallLater(UpdateHotspots, HOTSPOT_UPDATE_INTERVAL * 1000, true);
         
+        // Drop rasters at other resolutions nobody has asked for in a while
+        GetGame().GetCallqueue().CallLater(EvictIdleAccumulators, ACCUMULATOR_EVICTION_INTERVAL_MS, true);
+        
         Print("[StatTracker] Heatmap Manager initialized successfully");
     }
     
@@ -262,8 +436,16 @@ class STS_HeatmapManager
         // Add to the appropriate heat map
         m_HeatData.Get(type).Insert(point);
         
-        // Invalidate cache for this type
-        InvalidateCache(type);
+        // Stamp it into the live rasters of this type
+        map<int, ref STS_HeatmapAccumulator> accumulators = m_Accumulators.Get(type);
+        if (accumulators)
+        {
+            foreach (int resolution, STS_HeatmapAccumulator accumulator : accumulators)
+            {
+                if (!accumulator.IsStale())
+                    accumulator.Stamp(position, intensity);
+            }
+        }
     }
     
     //------------------------------------------------------------------------------------------------
@@ -283,17 +465,6 @@ class STS_HeatmapManager
         if (parameters && parameters.Contains("resolution"))
             resolution = parameters.Get("resolution").ToInt();
             
-        // Check if we have a valid cached heatmap
-        if (m_HeatmapCache.Contains(type))
-        {
-            STS_HeatmapCache cache = m_HeatmapCache.Get(type);
-            if (cache && cache.m_iResolution == resolution && System.GetUnixTime() - cache.m_iTimestamp < 300) // Cache valid for 5 minutes
-            {
-                return cache.m_sData;
-            }
-        }
-        
-        // Generate new heatmap
         return GenerateHeatmapJSON(type, resolution);
     }
     
@@ -335,26 +506,30 @@ class STS_HeatmapManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Update hotspots analysis
+    // Update hotspots analysis. Clustering runs over the following frames; the previous hotspots are served
+    // until it completes.
     void UpdateHotspots()
     {
+        if (m_HotspotClusterer.IsRunning())
+            return;
+        
         Print("[StatTracker] Updating hotspot analysis");
         
         m_fLastHotspotUpdate = System.GetTickCount() / 1000.0;
         
+        // Find clusters using density-based clustering; types with too few points are skipped
+        m_HotspotClusterer.Start(m_HeatData, m_fPointRadius * 2, 5, 10, OnHotspotClustersFound);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Turn the clusters of each type into hotspots and replace the current ones
+    protected void OnHotspotClustersFound(map<string, ref array<ref array<ref STS_HeatmapPoint>>> clustersByType)
+    {
         // Clear existing hotspots
         m_Hotspots.Clear();
         
-        // Process each heatmap type
-        foreach (string type, array<ref STS_HeatmapPoint> points : m_HeatData)
+        foreach (string type, array<ref array<ref STS_HeatmapPoint>> clusters : clustersByType)
         {
-            // Skip types with too few points
-            if (points.Count() < 10)
-                continue;
-                
-            // Find clusters using density-based clustering
-            array<ref array<ref STS_HeatmapPoint>> clusters = FindClusters(points, m_fPointRadius * 2, 5);
-            
             // Process each cluster
             foreach (array<ref STS_HeatmapPoint> cluster : clusters)
             {
@@ -411,107 +586,6 @@ class STS_HeatmapManager
         Print(string.Format("[StatTracker] Identified %1 hotspots", m_Hotspots.Count()));
     }
     
-    //------------------------------------------------------------------------------------------------
-    // Find clusters using density-based clustering (simplified DBSCAN)
-    protected array<ref array<ref STS_HeatmapPoint>> FindClusters(array<ref STS_HeatmapPoint> points, float eps, int minPoints)
-    {
-        array<ref array<ref STS_HeatmapPoint>> clusters = new array<ref array<ref STS_HeatmapPoint>>();
-        array<bool> visited = new array<bool>();
-        
-        // Initialize visited array
-        for (int i = 0; i < points.Count(); i++)
-        {
-            visited.Insert(false);
-        }
-        
-        // Process each point
-        for (int i = 0; i < points.Count(); i++)
-        {
-            // Skip if already visited
-            if (visited[i])
-                continue;
-                
-            // Mark as visited
-            visited[i] = true;
-            
-            // Find neighbors
-            array<int> neighbors = GetNeighbors(points, i, eps);
-            
-            // Check if this is a core point
-            if (neighbors.Count() >= minPoints)
-            {
-                // Start a new cluster
-                ref array<ref STS_HeatmapPoint> cluster = new array<ref STS_HeatmapPoint>();
-                cluster.Insert(points[i]);
-                
-                // Expand cluster
-                ExpandCluster(points, visited, neighbors, cluster, eps, minPoints);
-                
-                // Add cluster to results
-                clusters.Insert(cluster);
-            }
-        }
-        
-        return clusters;
-    }
-    
-    //------------------------------------------------------------------------------------------------
-    // Get neighbors within eps distance
-    protected array<int> GetNeighbors(array<ref STS_HeatmapPoint> points, int pointIndex, float eps)
-    {
-        array<int> neighbors = new array<int>();
-        
-        for (int i = 0; i < points.Count(); i++)
-        {
-            if (i == pointIndex)
-                continue;
-                
-            float distance = vector.Distance(points[pointIndex].m_vPosition, points[i].m_vPosition);
-            if (distance <= eps)
-            {
-                neighbors.Insert(i);
-            }
-        }
-        
-        return neighbors;
-    }
-    
-    //------------------------------------------------------------------------------------------------
-    // Expand cluster by adding neighbors
-    protected void ExpandCluster(array<ref STS_HeatmapPoint> points, array<bool> visited, array<int> neighbors, array<ref STS_HeatmapPoint> cluster, float eps, int minPoints)
-    {
-        // Process each neighbor
-        for (int i = 0; i < neighbors.Count(); i++)
-        {
-            int index = neighbors[i];
-            
-            // Skip if already processed
-            if (visited[index])
-                continue;
-                
-            // Mark as visited
-            visited[index] = true;
-            
-            // Add to cluster
-            cluster.Insert(points[index]);
-            
-            // Get neighbors of this point
-            array<int> newNeighbors = GetNeighbors(points, index, eps);
-            
-            // If this is a core point, add its neighbors to be processed
-            if (newNeighbors.Count() >= minPoints)
-            {
-                for (int j = 0; j < newNeighbors.Count(); j++)
-                {
-                    if (neighbors.Find(newNeighbors[j]) < 0)
-                    {
-                        neighbors.Insert(newNeighbors[j]);
-                    }
-                }
-            }
-        }
-    }
-    
     //------------------------------------------------------------------------------------------------
     // Calculate the radius of a cluster
     protected float CalculateClusterRadius(array<ref STS_HeatmapPoint> cluster, vector center)
@@ -559,104 +633,127 @@ class STS_HeatmapManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Generate heatmap JSON data
+    // Generate heatmap JSON data from the live raster of the type, creating it on the first request for a
+    // resolution. The resolution comes from API parameters, so it is clamped before it sizes a grid.
     protected string GenerateHeatmapJSON(string type, int resolution)
     {
         if (!m_HeatData.Contains(type))
             return "{}";
-            
-        array<ref STS_HeatmapPoint> points = m_HeatData.Get(type);
         
-        // Generate grid
-        array<array<float>> grid = new array<array<float>>();
-        for (int i = 0; i < resolution; i++)
+        resolution = Math.Clamp(resolution, MIN_RESOLUTION, MAX_RESOLUTION);
+        
+        STS_HeatmapAccumulator accumulator = GetAccumulator(type, resolution);
+        if (accumulator.IsStale())
+            accumulator.Rebuild(m_HeatData.Get(type));
+        
+        accumulator.Touch();
+        return accumulator.ToJSON();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Raster for a type and resolution; least recently requested rasters at other resolutions than the
+    // configured one are dropped to make room for a new one
+    protected STS_HeatmapAccumulator GetAccumulator(string type, int resolution)
+    {
+        map<int, ref STS_HeatmapAccumulator> accumulators = m_Accumulators.Get(type);
+        if (!accumulators)
         {
-            array<float> row = new array<float>();
-            for (int j = 0; j < resolution; j++)
+            accumulators = new map<int, ref STS_HeatmapAccumulator>();
+            m_Accumulators.Set(type, accumulators);
+        }
+        
+        STS_HeatmapAccumulator accumulator = accumulators.Get(resolution);
+        if (accumulator)
+            return accumulator;
+        
+        if (resolution != m_iMapResolution)
+        {
+            int neededCells = resolution * resolution;
+            while (GetExtraAccumulatorCells() + neededCells > MAX_EXTRA_ACCUMULATOR_CELLS)
             {
-                row.Insert(0);
+                if (!RemoveLeastRecentAccumulator(string.Empty))
+                    break;
             }
-            grid.Insert(row);
         }
         
-        // Calculate cell size
-        float cellSizeX = m_vWorldSize[0] / resolution;
-        float cellSizeZ = m_vWorldSize[2] / resolution;
+        if (accumulators.Count() >= MAX_ACCUMULATORS_PER_TYPE)
+            RemoveLeastRecentAccumulator(type);
+        
+        accumulator = new STS_HeatmapAccumulator(type, resolution, m_vWorldSize, m_fPointRadius);
+        accumulators.Set(resolution, accumulator);
+        return accumulator;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Drop the least recently requested raster at another resolution than the configured one, of the given
+    // type or of any type if it is empty; false if there is none
+    protected bool RemoveLeastRecentAccumulator(string onlyType)
+    {
+        string oldestType;
+        int oldestResolution = -1;
+        int oldestUse = int.MAX;
         
-        // Add heat from each point
-        foreach (STS_HeatmapPoint point : points)
+        foreach (string type, map<int, ref STS_HeatmapAccumulator> accumulators : m_Accumulators)
         {
-            // Convert world position to grid position
-            int gridX = Math.Clamp(Math.Round(point.m_vPosition[0] / cellSizeX), 0, resolution - 1);
-            int gridZ = Math.Clamp(Math.Round(point.m_vPosition[2] / cellSizeZ), 0, resolution - 1);
-            
-            // Calculate radius in grid cells
-            int radiusCells = Math.Clamp(Math.Round(m_fPointRadius / cellSizeX), 1, resolution / 4);
+            if (!onlyType.IsEmpty() && type != onlyType)
+                continue;
             
-            // Add heat to surrounding cells based on distance
-            for (int x = Math.Max(0, gridX - radiusCells); x <= Math.Min(resolution - 1, gridX + radiusCells); x++)
+            foreach (int resolution, STS_HeatmapAccumulator accumulator : accumulators)
             {
-                for (int z = Math.Max(0, gridZ - radiusCells); z <= Math.Min(resolution - 1, gridZ + radiusCells); z++)
+                if (resolution != m_iMapResolution && accumulator.GetLastUsed() < oldestUse)
                 {
-                    float distance = Math.Sqrt(Math.Pow(x - gridX, 2) + Math.Pow(z - gridZ, 2));
-                    if (distance <= radiusCells)
-                    {
-                        // Gaussian falloff
-                        float intensity = point.m_fIntensity * Math.Exp(-(distance * distance) / (2 * radiusCells * radiusCells));
-                        grid[x][z] += intensity;
-                    }
+                    oldestUse = accumulator.GetLastUsed();
+                    oldestType = type;
+                    oldestResolution = resolution;
                 }
             }
         }
         
-        // Normalize grid values
-        float maxValue = 0;
-        for (int i = 0; i < resolution; i++)
+        if (oldestResolution == -1)
+            return false;
+        
+        m_Accumulators.Get(oldestType).Remove(oldestResolution);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Cells held by rasters at other resolutions than the configured one
+    protected int GetExtraAccumulatorCells()
+    {
+        int cells = 0;
+        foreach (string type, map<int, ref STS_HeatmapAccumulator> accumulators : m_Accumulators)
         {
-            for (int j = 0; j < resolution; j++)
+            foreach (int resolution, STS_HeatmapAccumulator accumulator : accumulators)
             {
-                if (grid[i][j] > maxValue)
-                    maxValue = grid[i][j];
+                if (resolution != m_iMapResolution)
+                    cells += resolution * resolution;
             }
         }
         
-        if (maxValue > 0)
+        return cells;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Drop rasters at other resolutions than the configured one that were not requested for
+    // ACCUMULATOR_IDLE_SECONDS
+    protected void EvictIdleAccumulators()
+    {
+        int cutoff = System.GetUnixTime() - ACCUMULATOR_IDLE_SECONDS;
+        
+        foreach (string type, map<int, ref STS_HeatmapAccumulator> accumulators : m_Accumulators)
         {
-            for (int i = 0; i < resolution; i++)
+            array<int> idle = new array<int>();
+            foreach (int resolution, STS_HeatmapAccumulator accumulator : accumulators)
             {
-                for (int j = 0; j < resolution; j++)
-                {
-                    grid[i][j] /= maxValue;
-                }
+                if (resolution != m_iMapResolution && accumulator.GetLastUsed() < cutoff)
+                    idle.Insert(resolution);
             }
-        }
-        
-        // Generate JSON
-        string json = "{\"type\":\"" + type + "\",\"resolution\":" + resolution + ",\"data\":[";
-        for (int i = 0; i < resolution; i++)
-        {
-            json += "[";
-            for (int j = 0; j < resolution; j++)
+            
+            foreach (int idleResolution : idle)
             {
-                json += grid[i][j].ToString();
-                if (j < resolution - 1)
-                    json += ",";
+                accumulators.Remove(idleResolution);
             }
-            json += "]";
-            if (i < resolution - 1)
-                json += ",";
         }
-        json += "]}";
-        
-        // Cache the result
-        STS_HeatmapCache cache = new STS_HeatmapCache();
-        cache.m_iResolution = resolution;
-        cache.m_iTimestamp = System.GetUnixTime();
-        cache.m_sData = json;
-        
-        m_HeatmapCache.Set(type, cache);
-        
-        return json;
     }
     
     //------------------------------------------------------------------------------------------------
@@ -764,71 +861,37 @@ class STS_HeatmapManager
                 }
             }
             
-            // Invalidate cache
+            // Decayed intensities cannot be stamped; rebuild the rasters on the next request
             InvalidateCache(type);
         }
     }
     
     //------------------------------------------------------------------------------------------------
-    // Invalidate cache for a specific type
+    // Invalidate the rasters of a specific type
     protected void InvalidateCache(string type)
     {
-        if (m_HeatmapCache.Contains(type))
+        map<int, ref STS_HeatmapAccumulator> accumulators = m_Accumulators.Get(type);
+        if (!accumulators)
+            return;
+        
+        foreach (int resolution, STS_HeatmapAccumulator accumulator : accumulators)
         {
-            m_HeatmapCache.Remove(type);
+            accumulator.MarkStale();
         }
     }
     
     //------------------------------------------------------------------------------------------------
-    // Save heat data to disk
+    // Save heat data to disk, spread over frames by the time-sliced serializer
     void SaveHeatData()
     {
         Print("[StatTracker] Saving heatmap data");
         
         string filePath = "$profile:StatTracker/heatmap_data.json";
         
-        // Build JSON structure
-        string json = "{";
-        
-        bool firstType = true;
-        foreach (string type, array<ref STS_HeatmapPoint> points : m_HeatData)
-        {
-            if (!firstType) json += ",";
-            
-            json += "\"" + type + "\":[";
-            
-            bool firstPoint = true;
-            foreach (STS_HeatmapPoint point : points)
-            {
-                if (!firstPoint) json += ",";
-                
-                json += "{";
-                json += "\"x\":" + point.m_vPosition[0].ToString() + ",";
-                json += "\"y\":" + point.m_vPosition[1].ToString() + ",";
-                json += "\"z\":" + point.m_vPosition[2].ToString() + ",";
-                json += "\"i\":" + point.m_fIntensity.ToString() + ",";
-                json += "\"t\":" + point.m_fTimestamp.ToString() + ",";
-                json += "\"m\":\"" + point.m_sMetadata + "\"";
-                json += "}";
-                
-                firstPoint = false;
-            }
-            
-            json += "]";
-            firstType = false;
-        }
-        
-        json += "}";
-        
         // Save to file (compressed if available)
-        if (m_Config && m_Config.m_bCompressHeatmapData && STS_DataCompression.GetInstance())
-        {
-            STS_DataCompression.GetInstance().SaveCompressedData(filePath, json);
-        }
-        else
-        {
-            FileIO.WriteFile(filePath, json);
-        }
+        bool compress = m_Config && m_Config.m_bCompressHeatmapData && STS_DataCompression.GetInstance();
+        
+        STS_TimeSlicedSerializer.GetInstance().Submit(new STS_HeatDataSaveJob(filePath, m_HeatData, compress));
     }
     
     //------------------------------------------------------------------------------------------------
@@ -871,6 +934,7 @@ class STS_HeatmapManager
         foreach (string type, array<ref STS_HeatmapPoint> points : m_HeatData)
         {
             points.Clear();
+            InvalidateCache(type);
         }
         
         // TODO: Implement proper JSON parsing here
@@ -898,15 +962,6 @@ class STS_HeatmapPoint
     }
 }
 
-//------------------------------------------------------------------------------------------------
-// Heatmap cache class
-class STS_HeatmapCache
-{
-    int m_iResolution;     // Resolution of the cached heatmap
-    int m_iTimestamp;      // Time when cache was created
-    string m_sData;        // JSON data
-}
-
 //------------------------------------------------------------------------------------------------
 // Heatmap hotspot class
 class STS_HeatmapHotspot
@@ -0,0 +1,262 @@
+// STS_HotspotClusterer.c
+// Time-sliced density-based clustering (simplified DBSCAN) of heat points for hotspot analysis. Each heat type is
+// snapshotted, indexed in an eps-sized STS_SpatialHashGrid and then clustered; every unit of work (one grid insert
+// or one neighbor query) is small, and units run until the per-frame budget is spent.
+
+class STS_HotspotClusterer
+{
+    // Input: one snapshot per heat type, so points added or decayed meanwhile do not disturb a run
+    protected ref array<string> m_aTypes = new array<string>();
+    protected ref array<ref array<ref STS_HeatmapPoint>> m_aSnapshots = new array<ref array<ref STS_HeatmapPoint>>();
+    protected float m_fEps;
+    protected int m_iMinPoints;
+    protected func<map<string, ref array<ref array<ref STS_HeatmapPoint>>>> m_Callback;
+    
+    // Current type
+    protected int m_iTypeIndex = -1;
+    protected array<ref STS_HeatmapPoint> m_aPoints;
+    protected ref STS_SpatialHashGrid m_Grid;
+    protected ref array<bool> m_aVisited = new array<bool>();
+    protected ref array<bool> m_aQueued = new array<bool>(); // Membership of the frontier, so it holds no duplicates
+    protected int m_iScanCursor = 0;
+    
+    // Cluster being expanded
+    protected ref array<ref STS_HeatmapPoint> m_aCluster;
+    protected ref array<int> m_aFrontier = new array<int>();
+    protected int m_iFrontierCursor = 0;
+    protected ref array<int> m_aNeighbors = new array<int>();
+    
+    // Clusters found so far, by type
+    protected ref map<string, ref array<ref array<ref STS_HeatmapPoint>>> m_mResults;
+    
+    protected bool m_bRunning = false;
+    
+    // Configuration
+    protected float m_fFrameBudgetMs = 1.0;
+    
+    // Statistics of the last run
+    protected int m_iRunStartTime = 0;
+    protected int m_iQueries = 0;
+    
+    //------------------------------------------------------------------------------------------------
+    void ~STS_HotspotClusterer()
+    {
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Start clustering every type with at least minTypePoints points. Points with at least minPoints neighbors
+    // within eps are core points. The callback receives the clusters by type. Returns false if a run is active.
+    bool Start(map<string, ref array<ref STS_HeatmapPoint>> heatData, float eps, int minPoints, int minTypePoints,
+        func<map<string, ref array<ref array<ref STS_HeatmapPoint>>>> callback)
+    {
+        if (m_bRunning)
+            return false;
+        
+        m_aTypes.Clear();
+        m_aSnapshots.Clear();
+        
+        foreach (string type, array<ref STS_HeatmapPoint> points : heatData)
+        {
+            if (!points || points.Count() < minTypePoints)
+                continue;
+            
+            array<ref STS_HeatmapPoint> snapshot = new array<ref STS_HeatmapPoint>();
+            snapshot.Copy(points);
+            m_aTypes.Insert(type);
+            m_aSnapshots.Insert(snapshot);
+        }
+        
+        m_fEps = eps;
+        m_iMinPoints = minPoints;
+        m_Callback = callback;
+        m_mResults = new map<string, ref array<ref array<ref STS_HeatmapPoint>>>();
+        m_iTypeIndex = -1;
+        m_aPoints = null;
+        m_iQueries = 0;
+        m_iRunStartTime = System.GetTickCount();
+        
+        m_bRunning = true;
+        GetGame().GetCallqueue().CallLater(ProcessFrame, 0, true);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Finish the active run now, ignoring the budget
+    void RunToCompletion()
+    {
+        if (!m_bRunning)
+            return;
+        
+        GetGame().GetCallqueue().Remove(ProcessFrame);
+        while (Step())
+        {
+        }
+        
+        Finish();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Run units until this frame's budget is spent
+    protected void ProcessFrame()
+    {
+        int startTime = System.GetTickCount();
+        
+        while (System.GetTickCount() - startTime < m_fFrameBudgetMs)
+        {
+            if (!Step())
+            {
+                GetGame().GetCallqueue().Remove(ProcessFrame);
+                Finish();
+                return;
+            }
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // One unit of work; false once every type is done
+    protected bool Step()
+    {
+        if (!m_aPoints)
+            return NextType();
+        
+        int count = m_aPoints.Count();
+        
+        // Index the snapshot
+        if (m_Grid.Count() < count)
+        {
+            m_Grid.Insert(m_aPoints[m_Grid.Count()].m_vPosition);
+            m_aVisited.Insert(false);
+            m_aQueued.Insert(false);
+            return true;
+        }
+        
+        // Expand the open cluster by one frontier point
+        if (m_aCluster && m_iFrontierCursor < m_aFrontier.Count())
+        {
+            int index = m_aFrontier[m_iFrontierCursor];
+            m_iFrontierCursor++;
+            
+            if (m_aVisited[index])
+                return true;
+            
+            m_aVisited[index] = true;
+            m_aCluster.Insert(m_aPoints[index]);
+            
+            // Only core points pass their neighborhood on
+            if (QueryNeighbors(index) >= m_iMinPoints)
+                AddToFrontier(m_aNeighbors);
+            
+            return true;
+        }
+        
+        if (m_aCluster)
+        {
+            m_mResults.Get(m_aTypes[m_iTypeIndex]).Insert(m_aCluster);
+            m_aCluster = null;
+            m_aFrontier.Clear();
+            m_iFrontierCursor = 0;
+        }
+        
+        // Find the next unvisited point and start a cluster if it is a core point
+        while (m_iScanCursor < count && m_aVisited[m_iScanCursor])
+        {
+            m_iScanCursor++;
+        }
+        
+        if (m_iScanCursor >= count)
+        {
+            m_aPoints = null;
+            return true;
+        }
+        
+        int seed = m_iScanCursor;
+        m_aVisited[seed] = true;
+        
+        if (QueryNeighbors(seed) >= m_iMinPoints)
+        {
+            m_aCluster = new array<ref STS_HeatmapPoint>();
+            m_aCluster.Insert(m_aPoints[seed]);
+            AddToFrontier(m_aNeighbors);
+        }
+        
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Load the next type's snapshot; false if there is none
+    protected bool NextType()
+    {
+        m_iTypeIndex++;
+        if (m_iTypeIndex >= m_aTypes.Count())
+            return false;
+        
+        m_aPoints = m_aSnapshots[m_iTypeIndex];
+        m_Grid = new STS_SpatialHashGrid(m_fEps);
+        m_aVisited.Clear();
+        m_aQueued.Clear();
+        m_iScanCursor = 0;
+        m_aCluster = null;
+        m_aFrontier.Clear();
+        m_iFrontierCursor = 0;
+        
+        m_mResults.Insert(m_aTypes[m_iTypeIndex], new array<ref array<ref STS_HeatmapPoint>>());
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Neighbors of a point into m_aNeighbors; returns their count
+    protected int QueryNeighbors(int index)
+    {
+        m_iQueries++;
+        m_Grid.QueryRadius(m_Grid.GetPosition(index), m_fEps, m_aNeighbors, index);
+        return m_aNeighbors.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void AddToFrontier(array<int> indices)
+    {
+        foreach (int index : indices)
+        {
+            if (m_aVisited[index] || m_aQueued[index])
+                continue;
+            
+            m_aQueued[index] = true;
+            m_aFrontier.Insert(index);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void Finish()
+    {
+        m_bRunning = false;
+        
+        // Release the snapshots and index before handing out the results
+        m_aSnapshots.Clear();
+        m_aPoints = null;
+        m_Grid = null;
+        m_aVisited.Clear();
+        m_aQueued.Clear();
+        m_aFrontier.Clear();
+        
+        STS_LoggingSystem logger = STS_LoggingSystem.GetInstance();
+        if (logger)
+            logger.LogDebug(string.Format("Hotspot clustering of %1 types took %2 ms wall time, %3 neighbor queries",
+                m_aTypes.Count(), System.GetTickCount() - m_iRunStartTime, m_iQueries), "STS_HotspotClusterer", "Finish");
+        
+        if (m_Callback)
+            m_Callback(m_mResults);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsRunning()
+    {
+        return m_bRunning;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void SetFrameBudget(float budgetMs)
+    {
+        m_fFrameBudgetMs = Math.Max(0.1, budgetMs);
+    }
+}
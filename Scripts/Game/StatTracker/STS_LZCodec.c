@@ -0,0 +1,356 @@
+// STS_LZCodec.c
+// Byte-oriented LZ77 codec with a framed, versioned container. Repeats within the last WINDOW_SIZE bytes are
+// replaced by back-references found through a hash chain; everything else is copied through as literal runs.
+// The output stays a single line of text so it can be written with the plain FileIO API.
+//
+// Frame: STZ<version>:<mode>:<raw length>:<checksum>:<payload>
+//   mode     L = LZ77 payload, S = stored (used when compression would not make the data smaller)
+//   checksum string.Hash() of the raw data
+//
+// Payload: literal bytes, except for escape sequences starting with ESCAPE:
+//   `` literal `      `. newline      `, carriage return
+//   `<o1><o2><l>       back-reference; o1 o2 = (offset - 1) in base 64, l = (length - MIN_MATCH) in base 64
+
+class STS_LZCodec
+{
+    static const int FORMAT_VERSION = 1;
+    protected static const string MAGIC = "STZ";
+    
+    protected static const string ESCAPE = "`";
+    protected static const string DIGITS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz-_";
+    
+    // A back-reference costs 4 bytes, so only longer matches pay off
+    protected static const int MIN_MATCH = 5;
+    protected static const int MAX_MATCH = MIN_MATCH + 63;
+    protected static const int WINDOW_SIZE = 4096;
+    
+    protected static const int HASH_SIZE = 8192;
+    protected static const int MAX_CHAIN = 16;
+    
+    // Decoded output is gathered in pieces of about this size and joined once at the end
+    protected static const int PIECE_SIZE = 1024;
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether data starts with a frame header
+    static bool IsFramed(string data)
+    {
+        return data.StartsWith(MAGIC);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Compress data into a frame
+    static string Compress(string data)
+    {
+        string payload = EncodePayload(data);
+        string mode = "L";
+        
+        // Stored frames keep incompressible data from growing by more than the header
+        if (payload.Length() >= data.Length())
+        {
+            payload = data;
+            Escape(payload);
+            mode = "S";
+        }
+        
+        return string.Format("%1%2:%3:%4:%5:", MAGIC, FORMAT_VERSION, mode, data.Length(), data.Hash()) + payload;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Decode a frame; false if it is malformed, from an unknown version or fails its length or checksum check
+    static bool Decompress(string frame, out string data)
+    {
+        data = "";
+        
+        if (!IsFramed(frame))
+            return false;
+        
+        // Header fields are separated by ':'; the payload follows the fourth one
+        array<int> separators = {};
+        int pos = MAGIC.Length();
+        while (separators.Count() < 4)
+        {
+            pos = frame.IndexOfFrom(pos, ":");
+            if (pos == -1)
+                return false;
+            
+            separators.Insert(pos);
+            pos++;
+        }
+        
+        int version = frame.Substring(MAGIC.Length(), separators[0] - MAGIC.Length()).ToInt();
+        string mode = frame.Substring(separators[0] + 1, separators[1] - separators[0] - 1);
+        int rawLength = frame.Substring(separators[1] + 1, separators[2] - separators[1] - 1).ToInt();
+        int checksum = frame.Substring(separators[2] + 1, separators[3] - separators[2] - 1).ToInt();
+        string payload = frame.Substring(separators[3] + 1, frame.Length() - separators[3] - 1);
+        
+        if (version != FORMAT_VERSION)
+            return false;
+        
+        if (mode == "L" || mode == "S")
+        {
+            // A stored payload is a payload without back-references
+            if (!DecodePayload(payload, data))
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+        
+        return data.Length() == rawLength && data.Hash() == checksum;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static string EncodePayload(string data)
+    {
+        int length = data.Length();
+        
+        array<int> bytes = new array<int>();
+        bytes.Resize(length);
+        for (int i = 0; i < length; i++)
+        {
+            bytes[i] = data.Get(i).ToAscii() & 0xFF;
+        }
+        
+        // Most recent position per hash of the next 4 bytes, and the previous position with the same hash
+        array<int> head = new array<int>();
+        head.Resize(HASH_SIZE);
+        for (int h = 0; h < HASH_SIZE; h++)
+        {
+            head[h] = -1;
+        }
+        
+        array<int> chain = new array<int>();
+        chain.Resize(length);
+        
+        array<string> pieces = new array<string>();
+        int literalStart = 0;
+        int pos = 0;
+        
+        while (pos + MIN_MATCH <= length)
+        {
+            int hash = HashAt(bytes, pos);
+            int maxLength = Math.Min(MAX_MATCH, length - pos);
+            int bestLength = 0;
+            int bestOffset = 0;
+            
+            int candidate = head[hash];
+            int depth = 0;
+            while (candidate >= 0 && pos - candidate <= WINDOW_SIZE && depth < MAX_CHAIN)
+            {
+                int matched = 0;
+                while (matched < maxLength && bytes[candidate + matched] == bytes[pos + matched])
+                {
+                    matched++;
+                }
+                
+                if (matched > bestLength)
+                {
+                    bestLength = matched;
+                    bestOffset = pos - candidate;
+                    if (matched == maxLength)
+                        break;
+                }
+                
+                candidate = chain[candidate];
+                depth++;
+            }
+            
+            chain[pos] = head[hash];
+            head[hash] = pos;
+            
+            if (bestLength < MIN_MATCH)
+            {
+                pos++;
+                continue;
+            }
+            
+            if (pos > literalStart)
+                pieces.Insert(EscapedRun(data, literalStart, pos - literalStart));
+            
+            int offset = bestOffset - 1;
+            pieces.Insert(ESCAPE + DIGITS.Get((offset >> 6) & 63) + DIGITS.Get(offset & 63) + DIGITS.Get(bestLength - MIN_MATCH));
+            
+            // Index the positions inside the match so later data can refer back into it
+            for (int j = pos + 1; j < pos + bestLength && j + 4 <= length; j++)
+            {
+                int matchHash = HashAt(bytes, j);
+                chain[j] = head[matchHash];
+                head[matchHash] = j;
+            }
+            
+            pos += bestLength;
+            literalStart = pos;
+        }
+        
+        if (length > literalStart)
+            pieces.Insert(EscapedRun(data, literalStart, length - literalStart));
+        
+        return JoinPieces(pieces);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static bool DecodePayload(string payload, out string data)
+    {
+        // Output so far: completed pieces with their start offsets, plus the piece being filled
+        array<string> pieces = new array<string>();
+        array<int> pieceStarts = new array<int>();
+        int piecesEnd = 0;
+        string current = "";
+        
+        int length = payload.Length();
+        int pos = 0;
+        
+        while (pos < length)
+        {
+            int escape = payload.IndexOfFrom(pos, ESCAPE);
+            if (escape == -1)
+                escape = length;
+            
+            if (escape > pos)
+                current += payload.Substring(pos, escape - pos);
+            
+            if (escape >= length)
+                break;
+            
+            if (escape + 1 >= length)
+                return false;
+            
+            string code = payload.Get(escape + 1);
+            if (code == ESCAPE)
+            {
+                current += ESCAPE;
+                pos = escape + 2;
+            }
+            else if (code == ".")
+            {
+                current += "\n";
+                pos = escape + 2;
+            }
+            else if (code == ",")
+            {
+                current += "\r";
+                pos = escape + 2;
+            }
+            else
+            {
+                if (escape + 4 > length)
+                    return false;
+                
+                int high = DIGITS.IndexOf(code);
+                int low = DIGITS.IndexOf(payload.Get(escape + 2));
+                int lengthCode = DIGITS.IndexOf(payload.Get(escape + 3));
+                if (high == -1 || low == -1 || lengthCode == -1)
+                    return false;
+                
+                int offset = (high << 6 | low) + 1;
+                int matchLength = lengthCode + MIN_MATCH;
+                int outputLength = piecesEnd + current.Length();
+                if (offset > outputLength)
+                    return false;
+                
+                // A reference closer than its length repeats the bytes it is copying
+                string source = ReadOutput(pieces, pieceStarts, piecesEnd, current, outputLength - offset, Math.Min(offset, matchLength));
+                while (matchLength > 0)
+                {
+                    int take = Math.Min(matchLength, source.Length());
+                    current += source.Substring(0, take);
+                    matchLength -= take;
+                }
+                
+                pos = escape + 4;
+            }
+            
+            if (current.Length() >= PIECE_SIZE)
+            {
+                pieces.Insert(current);
+                pieceStarts.Insert(piecesEnd);
+                piecesEnd += current.Length();
+                current = "";
+            }
+        }
+        
+        pieces.Insert(current);
+        data = JoinPieces(pieces);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Bytes [start, start + count) of the decoded output; back-references only reach into the last few pieces
+    protected static string ReadOutput(array<string> pieces, array<int> pieceStarts, int piecesEnd, string current, int start, int count)
+    {
+        string result = "";
+        
+        int index = pieces.Count() - 1;
+        while (index > 0 && pieceStarts[index] > start)
+        {
+            index--;
+        }
+        
+        while (count > 0)
+        {
+            if (start >= piecesEnd)
+                return result + current.Substring(start - piecesEnd, count);
+            
+            string piece = pieces[index];
+            int offsetInPiece = start - pieceStarts[index];
+            int take = Math.Min(count, piece.Length() - offsetInPiece);
+            
+            result += piece.Substring(offsetInPiece, take);
+            start += take;
+            count -= take;
+            index++;
+        }
+        
+        return result;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static int HashAt(array<int> bytes, int pos)
+    {
+        int value = bytes[pos] | bytes[pos + 1] << 8 | bytes[pos + 2] << 16 | bytes[pos + 3] << 24;
+        return ((value * 0x9E3779B1) >> 19) & (HASH_SIZE - 1);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static string EscapedRun(string data, int start, int count)
+    {
+        string run = data.Substring(start, count);
+        Escape(run);
+        return run;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected static void Escape(inout string text)
+    {
+        // The escape character itself goes first so the sequences added after it are not doubled
+        text.Replace(ESCAPE, ESCAPE + ESCAPE);
+        text.Replace("\n", ESCAPE + ".");
+        text.Replace("\r", ESCAPE + ",");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Concatenate pieces pairwise so every byte is copied O(log n) times instead of once per piece
+    static string JoinPieces(array<string> pieces)
+    {
+        if (pieces.IsEmpty())
+            return "";
+        
+        array<string> level = pieces;
+        while (level.Count() > 1)
+        {
+            array<string> next = new array<string>();
+            for (int i = 0; i < level.Count(); i += 2)
+            {
+                if (i + 1 < level.Count())
+                    next.Insert(level[i] + level[i + 1]);
+                else
+                    next.Insert(level[i]);
+            }
+            
+            level = next;
+        }
+        
+        return level[0];
+    }
+}
@@ -22,15 +22,25 @@ class STS_PersistenceManager
     protected bool m_bHealthy = true;
     protected int m_iConsecutiveErrors = 0;
     protected const int ERROR_THRESHOLD = 5;
-    protected ref array<string> m_aFailedOperations = new array<string>();
     protected bool m_bUsingFallbackStorage = false;
     protected bool m_bDataCorruptionDetected = false;
     
-    // Fallback mechanism for when database is down
-    protected ref map<string, string> m_mMemoryBackup = new map<string, string>();
-    protected bool m_bMemoryBackupDirty = false;
-    protected float m_fLastBackupDumpTime = 0;
-    protected const float BACKUP_DUMP_INTERVAL = 300.0; // 5 minutes
+    // Write-behind buffer for batched player stat saves
+    protected ref STS_PlayerStatsWriteBehind m_WriteBehind = new STS_PlayerStatsWriteBehind();
+    
+    // Saves not yet acknowledged by the database survive a crash here
+    protected ref STS_WriteAheadLog m_WriteAheadLog = new STS_WriteAheadLog();
+    
+    // Write-ahead log entry of each queued save, acknowledged once the flush has stored that save
+    protected ref map<string, STS_WalEntry> m_mQueuedWalEntries = new map<string, STS_WalEntry>();
+    
+    // Hydrated stats for recently loaded or saved players; concurrent async loads for one player are coalesced
+    protected ref STS_PlayerStatsCache m_StatsCache = new STS_PlayerStatsCache(STATS_CACHE_CAPACITY, STATS_CACHE_TTL_SECONDS);
+    protected const int STATS_CACHE_CAPACITY = 512;
+    protected const float STATS_CACHE_TTL_SECONDS = 600;
+    
+    // Saves refused by admission control are retried no sooner than this
+    protected const int MIN_DEFERRED_FLUSH_DELAY_MS = 250;
     
     //------------------------------------------------------------------------------------------------
     // Constructor
@@ -53,6 +63,56 @@ class STS_PersistenceManager
             m_Logger.LogError("Failed to initialize database with best settings - persistence will not function",
                 "STS_PersistenceManager", "Constructor");
         }
+        
+        RecoverFromWriteAheadLog();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Requeue the saves a previous session logged but the database never acknowledged
+    protected void RecoverFromWriteAheadLog()
+    {
+        try
+        {
+            array<ref STS_WalEntry> entries = m_WriteAheadLog.Open();
+            if (entries.IsEmpty())
+                return;
+            
+            int recovered = 0;
+            foreach (STS_WalEntry entry : entries)
+            {
+                // Saves from the player components carry the enhanced fields; replaying them as plain stats would drop those
+                STS_PlayerStats stats;
+                if (entry.m_sPayload.Contains("\"firstLogin\":"))
+                    stats = new STS_EnhancedPlayerStats();
+                else
+                    stats = new STS_PlayerStats();
+                
+                if (!stats.FromJSON(entry.m_sPayload))
+                {
+                    m_Logger.LogError(string.Format("Unreadable write-ahead log entry %1 for UID %2 - skipped", 
+                        entry.m_iSequence, entry.m_sPlayerUID), "STS_PersistenceManager", "RecoverFromWriteAheadLog");
+                    continue;
+                }
+                
+                stats.MarkDirty(STS_EStatsDirtyFlags.ALL);
+                m_WriteBehind.Enqueue(entry.m_sPlayerUID, entry.m_sPlayerName, stats);
+                
+                // Already in the log - no need to append it again
+                m_WriteBehind.GetPending(entry.m_sPlayerUID).m_iLoggedVersion = stats.GetVersion();
+                m_mQueuedWalEntries.Set(entry.m_sPlayerUID, entry);
+                recovered++;
+            }
+            
+            m_Logger.LogInfo(string.Format("Recovered %1 unacknowledged player saves from the write-ahead log", recovered), 
+                "STS_PersistenceManager", "RecoverFromWriteAheadLog");
+            
+            FlushQueuedPlayerStats();
+        }
+        catch (Exception e)
+        {
+            m_Logger.LogError(string.Format("Exception recovering from write-ahead log: %1", e.ToString()), 
+                "STS_PersistenceManager", "RecoverFromWriteAheadLog");
+        }
     }
     
     //------------------------------------------------------------------------------------------------
@@ -89,9 +149,19 @@ class STS_PersistenceManager
     }
     
     //------------------------------------------------------------------------------------------------
-    // Load player statistics from database
+    // Load player statistics from database. Unknown players get fresh stats; null means the load failed, and
+    // nothing is cached so the next request tries the database again.
     STS_PlayerStats LoadPlayerStats(string playerUID)
     {
+        // A queued save is newer than anything in the database
+        STS_PlayerStatsSaveRecord pending = m_WriteBehind.GetPending(playerUID);
+        if (pending)
+            return pending.m_Stats;
+        
+        STS_PlayerStats cached = m_StatsCache.Get(playerUID);
+        if (cached)
+            return cached;
+        
         if (!m_DatabaseManager)
             return null;
             
@@ -105,39 +175,57 @@ class STS_PersistenceManager
                 return null;
             }
             
-            // Attempt to load stats
+            // Attempt to load stats; the repository returns fresh stats for unknown players and null on failure
             STS_PlayerStats stats = repository.LoadPlayerStats(playerUID);
             
-            if (stats)
-            {
-                m_Logger.LogInfo(string.Format("Successfully loaded stats for player UID: %1", playerUID), 
-                    "STS_PersistenceManager", "LoadPlayerStats");
-            }
-            else
+            if (!stats)
             {
-                m_Logger.LogInfo(string.Format("No existing stats found for player UID: %1", playerUID), 
+                m_Logger.LogWarning(string.Format("Failed to load stats for player UID: %1", playerUID), 
                     "STS_PersistenceManager", "LoadPlayerStats");
-                stats = new STS_PlayerStats(); // Create a fresh stats object
+                return null;
             }
             
+            // Freshly loaded stats match what is stored
+            stats.ClearDirty();
+            m_Logger.LogInfo(string.Format("Successfully loaded stats for player UID: %1", playerUID), 
+                "STS_PersistenceManager", "LoadPlayerStats");
+            
+            m_StatsCache.Put(playerUID, stats);
             return stats;
         }
         catch (Exception e)
         {
             m_Logger.LogError(string.Format("Exception loading player stats for UID %1: %2", 
                 playerUID, e.ToString()), "STS_PersistenceManager", "LoadPlayerStats");
-            return new STS_PlayerStats(); // Return empty stats on error
+            return null;
         }
     }
     
     //------------------------------------------------------------------------------------------------
-    // Load player statistics asynchronously
+    // Load player statistics asynchronously; served from the cache when possible, and concurrent loads for the
+    // same player share one database query. The callback gets null if the load failed.
     void LoadPlayerStatsAsync(string playerUID, func<STS_PlayerStats> callback)
     {
+        STS_PlayerStatsSaveRecord pending = m_WriteBehind.GetPending(playerUID);
+        if (pending)
+        {
+            if (callback)
+                callback(pending.m_Stats);
+            return;
+        }
+        
+        STS_PlayerStats cached = m_StatsCache.Get(playerUID);
+        if (cached)
+        {
+            if (callback)
+                callback(cached);
+            return;
+        }
+        
         if (!m_DatabaseManager)
         {
             if (callback)
-                callback(new STS_PlayerStats());
+                callback(null);
             return;
         }
             
@@ -150,18 +238,27 @@ class STS_PersistenceManager
                     "STS_PersistenceManager", "LoadPlayerStatsAsync");
                 
                 if (callback)
-                    callback(new STS_PlayerStats());
+                    callback(null);
                 return;
             }
             
-            // Create a wrapped callback that handles null results
+            // Another caller is already loading this player - wait for its result
+            if (!m_StatsCache.BeginLoad(playerUID, callback))
+                return;
+            
+            // Create a wrapped callback that answers every coalesced caller; a failed load is not cached
             func<STS_PlayerStats> wrappedCallback = func<STS_PlayerStats>(STS_PlayerStats loadedStats)
             {
                 if (!loadedStats)
-                    loadedStats = new STS_PlayerStats();
-                    
-                if (callback)
-                    callback(loadedStats);
+                {
+                    m_Logger.LogWarning(string.Format("Failed to load stats for player UID: %1", playerUID), 
+                        "STS_PersistenceManager", "LoadPlayerStatsAsync");
+                    m_StatsCache.CompleteLoad(playerUID, null, false);
+                    return;
+                }
+                
+                loadedStats.ClearDirty();
+                m_StatsCache.CompleteLoad(playerUID, loadedStats);
             };
             
             // Load stats asynchronously
@@ -171,17 +268,47 @@ class STS_PersistenceManager
         {
             m_Logger.LogError(string.Format("Exception in LoadPlayerStatsAsync for UID %1: %2", 
                 playerUID, e.ToString()), "STS_PersistenceManager", "LoadPlayerStatsAsync");
-                
-            if (callback)
-                callback(new STS_PlayerStats());
+            
+            // Nothing is cached - the next request retries the database
+            if (m_StatsCache.IsLoading(playerUID))
+                m_StatsCache.CompleteLoad(playerUID, null, false);
+            else if (callback)
+                callback(null);
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Warm the cache for a player who is about to spawn; a later load returns at once or joins this one
+    void PrefetchPlayerStats(string playerUID)
+    {
+        if (HasCachedPlayerStats(playerUID) || IsLoadingPlayerStats(playerUID))
+            return;
+        
+        m_Logger.LogDebug(string.Format("Prefetching stats for player UID: %1", playerUID), 
+            "STS_PersistenceManager", "PrefetchPlayerStats");
+        
+        LoadPlayerStatsAsync(playerUID, null);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether a load for this player is in flight
+    bool IsLoadingPlayerStats(string playerUID)
+    {
+        return m_StatsCache.IsLoading(playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether this player's stats can be returned without a database query
+    bool HasCachedPlayerStats(string playerUID)
+    {
+        return m_WriteBehind.HasPending(playerUID) || m_StatsCache.Contains(playerUID);
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Save player statistics to database
     bool SavePlayerStats(string playerUID, string playerName, STS_PlayerStats stats)
     {
-        if (!m_DatabaseManager)
+        if (!m_DatabaseManager || !stats)
             return false;
             
         try
@@ -194,11 +321,15 @@ class STS_PersistenceManager
                 return false;
             }
             
-            // Save stats
+            // Save stats; the cache is written through so readers never see an older copy
+            int version = stats.GetVersion();
+            m_StatsCache.Put(playerUID, stats);
             bool success = repository.SavePlayerStats(playerUID, playerName, stats);
             
             if (success)
             {
+                stats.MarkPersisted(version);
+                m_DatabaseManager.CancelPendingPlayerSave(playerUID);
                 m_Logger.LogDebug(string.Format("Successfully saved stats for player %1 (UID: %2)", 
                     playerName, playerUID), "STS_PersistenceManager", "SavePlayerStats");
             }
@@ -206,6 +337,7 @@ class STS_PersistenceManager
             {
                 m_Logger.LogError(string.Format("Failed to save stats for player %1 (UID: %2)", 
                     playerName, playerUID), "STS_PersistenceManager", "SavePlayerStats");
+                QueueFailedPlayerSave(playerUID, playerName, stats);
             }
             
             return success;
@@ -218,6 +350,242 @@ class STS_PersistenceManager
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Save player statistics without blocking the caller; failed attempts are retried with backoff
+    void SavePlayerStatsAsync(string playerUID, string playerName, STS_PlayerStats stats, func<bool> callback = null)
+    {
+        STS_PlayerStatsRepository repository = null;
+        if (m_DatabaseManager)
+            repository = m_DatabaseManager.GetPlayerStatsRepository();
+        
+        if (!repository || !stats)
+        {
+            m_Logger.LogError(string.Format("Cannot schedule save for player %1 (UID: %2) - repository unavailable", 
+                playerName, playerUID), "STS_PersistenceManager", "SavePlayerStatsAsync");
+            
+            if (callback)
+                callback(false);
+            return;
+        }
+        
+        int version = stats.GetVersion();
+        m_StatsCache.Put(playerUID, stats);
+        
+        // The attempt runs on a later frame - write a frozen copy so it cannot tear against gameplay updates
+        STS_PlayerStats snapshot = stats.CreateSnapshot();
+        
+        // Logged before dispatch like the queued saves, so a crash during the retries replays it next session
+        STS_WalEntry walEntry = new STS_WalEntry(playerUID, playerName, snapshot.ToJSON());
+        array<ref STS_WalEntry> walEntries = {walEntry};
+        if (!m_WriteAheadLog.Append(walEntries))
+        {
+            m_Logger.LogWarning(string.Format("Failed to append save for player %1 (UID: %2) to the write-ahead log - it is not crash safe", 
+                playerName, playerUID), "STS_PersistenceManager", "SavePlayerStatsAsync");
+            walEntry = null;
+        }
+        
+        func<bool> wrappedCallback = func<bool>(bool success)
+        {
+            if (success)
+            {
+                stats.MarkPersisted(version);
+                m_DatabaseManager.CancelPendingPlayerSave(playerUID);
+                
+                if (walEntry)
+                {
+                    array<STS_WalEntry> stored = {walEntry};
+                    m_WriteAheadLog.AcknowledgeEntries(stored);
+                }
+            }
+            else
+            {
+                m_Logger.LogError(string.Format("Failed to save stats for player %1 (UID: %2) after retries", 
+                    playerName, playerUID), "STS_PersistenceManager", "SavePlayerStatsAsync");
+                QueueFailedPlayerSave(playerUID, playerName, snapshot);
+            }
+            
+            if (callback)
+                callback(success);
+        };
+        
+        repository.SavePlayerStatsAsync(playerUID, playerName, snapshot, wrappedCallback);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Hand a save that failed to the database manager's pending queue, which keeps retrying it with backoff.
+    // A write-ahead log entry of the save stays outstanding, so a crash before the retry succeeds still replays it.
+    protected void QueueFailedPlayerSave(string playerUID, string playerName, STS_PlayerStats stats)
+    {
+        map<string, string> parameters = new map<string, string>();
+        parameters.Set("playerUID", playerUID);
+        parameters.Set("playerName", playerName);
+        parameters.Set("statsJson", stats.ToJSON());
+        
+        if (!m_DatabaseManager.AddPendingOperation("SavePlayerStats", parameters))
+        {
+            m_Logger.LogError(string.Format("Could not queue a retry for player %1 (UID: %2) - the save is lost unless the player saves again", 
+                playerName, playerUID), "STS_PersistenceManager", "QueueFailedPlayerSave");
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Queue player statistics for the next batched flush; returns false if there was nothing to write
+    bool QueuePlayerStatsSave(string playerUID, string playerName, STS_PlayerStats stats)
+    {
+        if (!stats || !stats.IsDirty())
+            return false;
+        
+        m_WriteBehind.Enqueue(playerUID, playerName, stats);
+        m_StatsCache.Put(playerUID, stats);
+        return true;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Write queued player statistics as one batched upsert; failed records stay queued. Without force only as
+    // many records as admission control allows are written and the rest are flushed once tokens refill.
+    STS_PlayerStatsFlushResult FlushQueuedPlayerStats(bool force = false)
+    {
+        STS_PlayerStatsRepository repository = null;
+        if (m_DatabaseManager)
+            repository = m_DatabaseManager.GetPlayerStatsRepository();
+        
+        try
+        {
+            // Every queued save goes to the write-ahead log first, admitted or not
+            LogQueuedPlayerStats();
+            
+            int pendingCount = m_WriteBehind.GetPendingCount();
+            int admitted = pendingCount;
+            
+            STS_AdmissionController admission = STS_AdmissionController.GetInstance();
+            if (force)
+                admission.Consume(pendingCount);
+            else if (pendingCount > 0)
+                admitted = admission.AcquireUpTo(pendingCount);
+            
+            STS_PlayerStatsFlushResult result = m_WriteBehind.Flush(repository, admitted);
+            AcknowledgeQueuedPlayerStats(result.m_aSucceededUIDs);
+            
+            if (m_DatabaseManager)
+            {
+                foreach (string storedUID : result.m_aSucceededUIDs)
+                {
+                    m_DatabaseManager.CancelPendingPlayerSave(storedUID);
+                }
+            }
+            
+            if (result.GetFailureCount() > 0)
+            {
+                m_Logger.LogWarning(string.Format("Batched flush left %1 records queued for retry", 
+                    result.GetFailureCount()), "STS_PersistenceManager", "FlushQueuedPlayerStats");
+            }
+            
+            // Deferred, not dropped: flush the remainder in admitted slices as the bucket refills
+            if (admitted < pendingCount)
+            {
+                int delayMs = Math.Max(admission.GetWaitTimeMs(), MIN_DEFERRED_FLUSH_DELAY_MS);
+                GetGame().GetCallqueue().Remove(FlushDeferredPlayerStats);
+                GetGame().GetCallqueue().CallLater(FlushDeferredPlayerStats, delayMs, false);
+                
+                m_Logger.LogDebug(string.Format("Admission control deferred %1 of %2 queued saves by %3 ms",
+                    pendingCount - admitted, pendingCount, delayMs), "STS_PersistenceManager", "FlushQueuedPlayerStats");
+            }
+            
+            return result;
+        }
+        catch (Exception e)
+        {
+            m_Logger.LogError(string.Format("Exception flushing queued player stats: %1", e.ToString()), 
+                "STS_PersistenceManager", "FlushQueuedPlayerStats");
+            return new STS_PlayerStatsFlushResult();
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void FlushDeferredPlayerStats()
+    {
+        if (m_WriteBehind.GetPendingCount() > 0)
+            FlushQueuedPlayerStats();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Append every queued save that changed since it was last logged as one write-ahead log batch
+    protected void LogQueuedPlayerStats()
+    {
+        array<STS_PlayerStatsSaveRecord> records = new array<STS_PlayerStatsSaveRecord>();
+        m_WriteBehind.GetPendingRecords(records);
+        
+        array<ref STS_WalEntry> entries = new array<ref STS_WalEntry>();
+        array<STS_PlayerStatsSaveRecord> logged = new array<STS_PlayerStatsSaveRecord>();
+        
+        foreach (STS_PlayerStatsSaveRecord record : records)
+        {
+            if (record.m_iLoggedVersion == record.m_iStatsVersion)
+                continue;
+            
+            entries.Insert(new STS_WalEntry(record.m_sPlayerUID, record.m_sPlayerName, record.m_Stats.ToJSON()));
+            logged.Insert(record);
+        }
+        
+        if (entries.IsEmpty())
+            return;
+        
+        if (!m_WriteAheadLog.Append(entries))
+        {
+            m_Logger.LogWarning(string.Format("Failed to append %1 saves to the write-ahead log - they are not crash safe", 
+                entries.Count()), "STS_PersistenceManager", "LogQueuedPlayerStats");
+            return;
+        }
+        
+        for (int i = 0; i < logged.Count(); i++)
+        {
+            logged[i].m_iLoggedVersion = logged[i].m_iStatsVersion;
+            m_mQueuedWalEntries.Set(logged[i].m_sPlayerUID, entries[i]);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Acknowledge the logged entries of the flushed saves. By entry rather than by player, so an async save
+    // logged for the same player after the flush was logged stays outstanding until it is stored itself.
+    protected void AcknowledgeQueuedPlayerStats(array<string> playerUIDs)
+    {
+        array<STS_WalEntry> stored = new array<STS_WalEntry>();
+        foreach (string uid : playerUIDs)
+        {
+            STS_WalEntry entry;
+            if (m_mQueuedWalEntries.Find(uid, entry))
+            {
+                stored.Insert(entry);
+                m_mQueuedWalEntries.Remove(uid);
+            }
+        }
+        
+        m_WriteAheadLog.AcknowledgeEntries(stored);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Number of player stat saves waiting for the next flush
+    int GetQueuedPlayerStatsCount()
+    {
+        return m_WriteBehind.GetPendingCount();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Average cost of snapshotting one player's stats in the flushes so far, in microseconds
+    float GetAverageSnapshotCostUs()
+    {
+        return m_WriteBehind.GetAverageSnapshotCostUs();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Player stats cache effectiveness
+    void GetStatsCacheStatistics(out float hitRate, out int hits, out int misses, out int evictions, out int expirations, out int coalescedLoads, out int size)
+    {
+        m_StatsCache.GetStatistics(hits, misses, evictions, expirations, coalescedLoads);
+        hitRate = m_StatsCache.GetHitRate();
+        size = m_StatsCache.Count();
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get all player statistics (for scoreboard, etc.)
     array<ref STS_PlayerStats> GetAllPlayerStats()
@@ -271,6 +639,7 @@ class STS_PersistenceManager
             }
             
             // Delete player stats
+            m_StatsCache.Invalidate(playerUID);
             bool success = repository.DeletePlayerStats(playerUID);
             
             if (success)
@@ -333,6 +702,28 @@ class STS_PersistenceManager
             "STS_PersistenceManager", "SetAutosaveEnabled");
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Delete player statistics without blocking the caller; failed attempts are retried with backoff
+    void DeletePlayerStatsAsync(string playerUID, func<bool> callback = null)
+    {
+        STS_PlayerStatsRepository repository = null;
+        if (m_DatabaseManager)
+            repository = m_DatabaseManager.GetPlayerStatsRepository();
+        
+        if (!repository)
+        {
+            m_Logger.LogError(string.Format("Cannot schedule delete for player UID %1 - repository unavailable", 
+                playerUID), "STS_PersistenceManager", "DeletePlayerStatsAsync");
+            
+            if (callback)
+                callback(false);
+            return;
+        }
+        
+        m_StatsCache.Invalidate(playerUID);
+        repository.DeletePlayerStatsAsync(playerUID, callback);
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Shutdown the persistence system
     void Shutdown()
@@ -344,8 +735,27 @@ class STS_PersistenceManager
         STS_StatTrackingManagerComponent manager = STS_StatTrackingManagerComponent.GetInstance();
         if (manager)
         {
-            manager.SaveAllPlayerStats();
+            manager.SaveAllPlayerStats(true);
+        }
+        GetGame().GetCallqueue().Remove(FlushDeferredPlayerStats);
+        
+        // Anything still unacknowledged is replayed on the next start
+        if (m_WriteAheadLog.GetOutstandingCount() > 0)
+        {
+            m_Logger.LogWarning(string.Format("%1 player saves remain in the write-ahead log for the next session", 
+                m_WriteAheadLog.GetOutstandingCount()), "STS_PersistenceManager", "Shutdown");
         }
+        m_WriteAheadLog.Close();
+        
+        // Operations still waiting on a retry cannot complete once the database is gone
+        STS_RetryScheduler retryScheduler = STS_RetryScheduler.GetInstance();
+        int pendingRetries = retryScheduler.GetInFlightCount() + retryScheduler.GetWaitingCount();
+        if (pendingRetries > 0)
+        {
+            m_Logger.LogWarning(string.Format("Abandoning %1 database operations still pending retry", pendingRetries), 
+                "STS_PersistenceManager", "Shutdown");
+        }
+        retryScheduler.Shutdown();
         
         // Shutdown database
         if (m_DatabaseManager)
@@ -379,10 +789,10 @@ class STS_PersistenceManager
             bool success = m_DatabaseManager.Reconnect();
             m_Logger.LogInfo("Database reconnection attempt: " + (success ? "successful" : "failed"));
             
-            if (success && m_bMemoryBackupDirty)
+            if (success && GetQueuedPlayerStatsCount() > 0)
             {
-                // Try to write memory backup to database
-                ReplayBackupOperations();
+                // Write the saves queued while the database was down
+                FlushQueuedPlayerStats();
             }
         }
     }
@@ -402,8 +812,8 @@ class STS_PersistenceManager
             m_bUsingFallbackStorage = true;
             m_bHealthy = false;
             
-            // Dump memory backup to emergency file
-            DumpMemoryBackupToFile();
+            // Make sure every queued save is on disk in the write-ahead log
+            m_WriteAheadLog.Sync();
         }
     }
     
@@ -428,8 +838,8 @@ class STS_PersistenceManager
                 m_bHealthy = true;
                 m_Logger.LogInfo("Switching back to database storage");
                 
-                // Try to replay failed operations
-                ReplayBackupOperations();
+                // Write the saves queued while the database was down
+                FlushQueuedPlayerStats();
             }
         }
     }
@@ -462,117 +872,6 @@ class STS_PersistenceManager
         }
     }
     
-    //------------------------------------------------------------------------------------------------
-    // Replay backup operations once database is available again
-    protected void ReplayBackupOperations()
-    {
-        if (!m_DatabaseManager || !m_DatabaseManager.IsInitialized())
-            return;
-            
-        m_Logger.LogInfo("Replaying " + m_aFailedOperations.Count() + " backed up operations");
-        
-        array<string> completedOps = new array<string>();
-        
-        foreach (string operation : m_aFailedOperations)
-        {
-            array<string> parts = new array<string>();
-            operation.Split(":", parts);
-            
-            if (parts.Count() < 2)
-                continue;
-                
-            string opType = parts[0];
-            string playerId = parts[1];
-            
-            if (opType == "save")
-            {
-                string json = m_mMemoryBackup.Get(playerId);
-                if (json && !json.IsEmpty())
-                {
-                    bool success = m_DatabaseManager.SavePlayerData(playerId, json);
-                    if (success)
-                    {
-                        completedOps.Insert(operation);
-                        m_Logger.LogDebug("Successfully replayed save operation for player ID: " + playerId);
-                    }
-                }
-            }
-        }
-        
-        // Remove completed operations
-        foreach (string completedOp : completedOps)
-        {
-            m_aFailedOperations.RemoveItem(completedOp);
-        }
-        
-        m_Logger.LogInfo("Replay complete. " + completedOps.Count() + " operations succeeded, " + 
-            m_aFailedOperations.Count() + " operations still pending");
-            
-        // Mark memory backup as clean if all operations are complete
-        if (m_aFailedOperations.Count() == 0)
-        {
-            m_bMemoryBackupDirty = false;
-        }
-    }
-    
-    //------------------------------------------------------------------------------------------------
-    // Dump memory backup to file in case of emergency
-    protected void DumpMemoryBackupToFile()
-    {
-        try
-        {
-            // Only dump if dirty and if enough time has passed since last dump
-            float currentTime = System.GetTickCount() / 1000.0;
-            if (!m_bMemoryBackupDirty || currentTime - m_fLastBackupDumpTime < BACKUP_DUMP_INTERVAL)
-                return;
-                
-            m_fLastBackupDumpTime = currentTime;
-            
-            // Create backup directory
-            string backupDir = "$profile:StatTracker/EmergencyBackups/";
-            if (!FileIO.FileExists(backupDir))
-            {
-                FileIO.MakeDirectory(backupDir);
-            }
-            
-            // Create timestamped backup file
-            string timestamp = GetTimestamp();
-            string backupFile = backupDir + "backup_" + timestamp + ".json";
-            
-            // Build JSON array of all player data
-            string json = "[";
-            int count = 0;
-            
-            foreach (string playerId, string playerData : m_mMemoryBackup)
-            {
-                if (count > 0)
-                    json += ",";
-                    
-                json += "{\"id\":\"" + playerId + "\",\"data\":" + playerData + "}";
-                count++;
-            }
-            
-            json += "]";
-            
-            // Write to file
-            FileHandle file = FileIO.OpenFile(backupFile, FileMode.WRITE);
-            if (file)
-            {
-                FileIO.FPrintln(file, json);
-                FileIO.CloseFile(file);
-                m_Logger.LogInfo("Emergency backup created with " + count + " player records: " + backupFile);
-            }
-            else
-            {
-                m_Logger.LogError("Failed to create emergency backup file: " + backupFile);
-            }
-        }
-        catch (Exception e)
-        {
-            m_Logger.LogError("Exception creating emergency backup: " + e.ToString());
-        }
-    }
-    
     //------------------------------------------------------------------------------------------------
     // Validate JSON data
     protected bool IsValidJson(string json)
@@ -588,21 +887,4 @@ class STS_PersistenceManager
         
         return true;
     }
-    
-    //------------------------------------------------------------------------------------------------
-    // Get timestamp for backup files
-    protected string GetTimestamp()
-    {
-        int year, month, day, hour, minute, second;
-        GetHourMinuteSecond(hour, minute, second);
-        GetYearMonthDay(year, month, day);
-        
-        return string.Format("%1-%2-%3_%4-%5-%6", 
-            year.ToString(), 
-            month.ToString().PadLeft(2, "0"), 
-            day.ToString().PadLeft(2, "0"),
-            hour.ToString().PadLeft(2, "0"), 
-            minute.ToString().PadLeft(2, "0"), 
-            second.ToString().PadLeft(2, "0"));
-    }
 } 
\ No newline at end of file
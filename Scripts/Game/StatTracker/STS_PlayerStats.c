@@ -1,6 +1,26 @@
 // STS_PlayerStats.c
 // Player statistics data class
 
+// Field groups that changed since the last persist; bits so several groups can be dirty at once
+enum STS_EStatsDirtyFlags
+{
+    NONE = 0,
+    COMBAT = 1,          // Kills, deaths, AI/vehicle/air kills
+    OBJECTIVES = 2,      // Bases captured/lost
+    PROGRESSION = 4,     // XP and rank
+    LOGISTICS = 8,       // Supply deliveries
+    SESSION = 16,        // Connection info and playtime
+    KILLED_BY = 32,      // Killed-by history
+    IDENTITY = 64,       // Name, player ID, team
+    WEAPONS = 128,       // Per-weapon kills and kill history (enhanced stats)
+    MOVEMENT = 256,      // Distances and visited locations (enhanced stats)
+    DAMAGE = 512,        // Damage dealt/taken, unconsciousness (enhanced stats)
+    ECONOMY = 1024,      // Purchases and sales (enhanced stats)
+    ACHIEVEMENTS = 2048, // Achievements and challenges (enhanced stats)
+    LEADERBOARD = 4096,  // Leaderboard rank (enhanced stats)
+    ALL = 8191
+}
+
 class STS_PlayerStats
 {
     // Basic statistics
@@ -32,6 +52,12 @@ class STS_PlayerStats
     ref array<string> m_aKilledByWeapon = new array<string>();
     ref array<int> m_aKilledByTeam = new array<int>();
     
+    // Change tracking - not persisted
+    [NonSerialized()]
+    protected int m_iDirtyFlags = STS_EStatsDirtyFlags.ALL; // New objects have never been persisted
+    [NonSerialized()]
+    protected int m_iVersion = 0;                           // Bumped on every change
+    
     // Reference to logging system
     protected static ref STS_LoggingSystem m_Logger;
     
@@ -92,6 +118,7 @@ class STS_PlayerStats
             {
                 m_fLastSessionDuration = System.GetTickCount() / 1000.0 - m_fConnectionTime;
                 m_fTotalPlaytime += m_fLastSessionDuration;
+                MarkDirty(STS_EStatsDirtyFlags.SESSION);
                 
                 if (m_Logger)
                 {
@@ -248,9 +275,9 @@ class STS_PlayerStats
         
         // Find value after key
         int valueStart = keyIndex + key.Length();
-        int valueEnd = json.IndexOfFrom(",", valueStart);
+        int valueEnd = json.IndexOfFrom(valueStart, ",");
         if (valueEnd == -1)
-            valueEnd = json.IndexOfFrom("}", valueStart);
+            valueEnd = json.IndexOfFrom(valueStart, "}");
         
         if (valueEnd == -1)
             return false;
@@ -326,6 +353,7 @@ class STS_PlayerStats
             m_aKilledBy.Insert(killerName);
             m_aKilledByWeapon.Insert(weaponName);
             m_aKilledByTeam.Insert(teamID);
+            MarkDirty(STS_EStatsDirtyFlags.KILLED_BY);
             
             if (m_Logger)
             {
@@ -344,48 +372,124 @@ class STS_PlayerStats
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Mark one or more field groups as changed since the last persist
+    void MarkDirty(int flags)
+    {
+        m_iDirtyFlags |= flags;
+        m_iVersion++;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Clear the dirty groups after a successful persist. Pass the version captured when the save
+    // was queued; if the stats changed while the save was in flight they stay dirty.
+    void MarkPersisted(int persistedVersion)
+    {
+        if (persistedVersion == m_iVersion)
+            m_iDirtyFlags = STS_EStatsDirtyFlags.NONE;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Clear the dirty groups unconditionally, e.g. right after loading from storage
+    void ClearDirty()
+    {
+        m_iDirtyFlags = STS_EStatsDirtyFlags.NONE;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Frozen copy of this object for serialization off the hot path. Gameplay keeps mutating the live
+    // object while the snapshot is written over later frames; the snapshot carries the captured version.
+    STS_PlayerStats CreateSnapshot()
+    {
+        STS_PlayerStats snapshot = STS_PlayerStats.Cast(Type().Spawn());
+        CopySnapshotTo(snapshot);
+        return snapshot;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Copy every persisted field; subclasses with more fields extend this
+    protected void CopySnapshotTo(STS_PlayerStats snapshot)
+    {
+        snapshot.m_iKills = m_iKills;
+        snapshot.m_iDeaths = m_iDeaths;
+        snapshot.m_iBasesLost = m_iBasesLost;
+        snapshot.m_iBasesCaptured = m_iBasesCaptured;
+        snapshot.m_iTotalXP = m_iTotalXP;
+        snapshot.m_iRank = m_iRank;
+        snapshot.m_iSuppliesDelivered = m_iSuppliesDelivered;
+        snapshot.m_iSupplyDeliveryCount = m_iSupplyDeliveryCount;
+        snapshot.m_iAIKills = m_iAIKills;
+        snapshot.m_iVehicleKills = m_iVehicleKills;
+        snapshot.m_iAirKills = m_iAirKills;
+        
+        snapshot.m_sPlayerName = m_sPlayerName;
+        snapshot.m_iPlayerID = m_iPlayerID;
+        snapshot.m_iTeamID = m_iTeamID;
+        
+        snapshot.m_sIPAddress = m_sIPAddress;
+        snapshot.m_fConnectionTime = m_fConnectionTime;
+        snapshot.m_fLastSessionDuration = m_fLastSessionDuration;
+        snapshot.m_fTotalPlaytime = m_fTotalPlaytime;
+        
+        if (m_aKilledBy)
+            snapshot.m_aKilledBy.Copy(m_aKilledBy);
+        if (m_aKilledByWeapon)
+            snapshot.m_aKilledByWeapon.Copy(m_aKilledByWeapon);
+        if (m_aKilledByTeam)
+            snapshot.m_aKilledByTeam.Copy(m_aKilledByTeam);
+        
+        snapshot.m_iDirtyFlags = m_iDirtyFlags;
+        snapshot.m_iVersion = m_iVersion;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    bool IsDirty() { return m_iDirtyFlags != STS_EStatsDirtyFlags.NONE; }
+    bool IsGroupDirty(STS_EStatsDirtyFlags group) { return (m_iDirtyFlags & group) != 0; }
+    int GetDirtyFlags() { return m_iDirtyFlags; }
+    int GetVersion() { return m_iVersion; }
+    
     //------------------------------------------------------------------------------------------------
     // Getters and setters
     
     int GetKills() { return m_iKills; }
-    void SetKills(int value) { m_iKills = value; }
+    void SetKills(int value) { m_iKills = value; MarkDirty(STS_EStatsDirtyFlags.COMBAT); }
     
     int GetDeaths() { return m_iDeaths; }
-    void SetDeaths(int value) { m_iDeaths = value; }
+    void SetDeaths(int value) { m_iDeaths = value; MarkDirty(STS_EStatsDirtyFlags.COMBAT); }
     
     int GetBasesCaptured() { return m_iBasesCaptured; }
-    void SetBasesCaptured(int value) { m_iBasesCaptured = value; }
+    void SetBasesCaptured(int value) { m_iBasesCaptured = value; MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES); }
     
     int GetBasesLost() { return m_iBasesLost; }
-    void SetBasesLost(int value) { m_iBasesLost = value; }
+    void SetBasesLost(int value) { m_iBasesLost = value; MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES); }
     
     int GetTotalXP() { return m_iTotalXP; }
-    void SetTotalXP(int value) { m_iTotalXP = value; }
+    void SetTotalXP(int value) { m_iTotalXP = value; MarkDirty(STS_EStatsDirtyFlags.PROGRESSION); }
     
     int GetRank() { return m_iRank; }
-    void SetRank(int value) { m_iRank = value; }
+    void SetRank(int value) { m_iRank = value; MarkDirty(STS_EStatsDirtyFlags.PROGRESSION); }
     
     int GetAIKills() { return m_iAIKills; }
-    void SetAIKills(int value) { m_iAIKills = value; }
+    void SetAIKills(int value) { m_iAIKills = value; MarkDirty(STS_EStatsDirtyFlags.COMBAT); }
     
     int GetVehicleKills() { return m_iVehicleKills; }
-    void SetVehicleKills(int value) { m_iVehicleKills = value; }
+    void SetVehicleKills(int value) { m_iVehicleKills = value; MarkDirty(STS_EStatsDirtyFlags.COMBAT); }
     
     int GetAirKills() { return m_iAirKills; }
-    void SetAirKills(int value) { m_iAirKills = value; }
+    void SetAirKills(int value) { m_iAirKills = value; MarkDirty(STS_EStatsDirtyFlags.COMBAT); }
     
     string GetPlayerName() { return m_sPlayerName; }
-    void SetPlayerName(string value) { m_sPlayerName = value; }
+    void SetPlayerName(string value) { m_sPlayerName = value; MarkDirty(STS_EStatsDirtyFlags.IDENTITY); }
     
     int GetPlayerID() { return m_iPlayerID; }
-    void SetPlayerID(int value) { m_iPlayerID = value; }
+    void SetPlayerID(int value) { m_iPlayerID = value; MarkDirty(STS_EStatsDirtyFlags.IDENTITY); }
     
     int GetTeamId() { return m_iTeamID; }
-    void SetTeamId(int value) { m_iTeamID = value; }
+    void SetTeamId(int value) { m_iTeamID = value; MarkDirty(STS_EStatsDirtyFlags.IDENTITY); }
     
     float GetTotalPlaytime() { return m_fTotalPlaytime; }
     float GetSessionDuration() { return m_fLastSessionDuration; }
     
     string GetIPAddress() { return m_sIPAddress; }
-    void SetIPAddress(string value) { m_sIPAddress = value; }
+    void SetIPAddress(string value) { m_sIPAddress = value; MarkDirty(STS_EStatsDirtyFlags.SESSION); }
 } 
\ No newline at end of file
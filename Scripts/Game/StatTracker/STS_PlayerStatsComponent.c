@@ -17,6 +17,16 @@ class STS_PlayerStatsComponent : ScriptComponent
     protected float m_LastAutosave;
     protected IEntity m_Owner;
     
+    // Stored stats arrive asynchronously; until then this session's events accumulate in m_PlayerStats
+    protected bool m_bStatsLoaded = false;
+    protected int m_iIdentityPolls = 0;
+    protected const int MAX_IDENTITY_POLLS = 600; // Frames to wait for the player identity
+    
+    // A failed load is retried with a doubling delay; saves stay off until it succeeds
+    protected int m_iLoadFailures = 0;
+    protected const int LOAD_RETRY_DELAY_MS = 5000;
+    protected const int MAX_LOAD_RETRY_DELAY_MS = 120000;
+    
     //------------------------------------------------------------------------------------------------
     override void OnPostInit(IEntity owner)
     {
@@ -34,16 +44,40 @@ class STS_PlayerStatsComponent : ScriptComponent
         m_LastMovementCheck = System.GetTickCount() / 1000.0;
         m_LastAutosave = m_LastMovementCheck;
         
-        // Register event handlers
-        GetGame().GetCallqueue().CallLater(LoadPlayerStats, 1000, false); // Delay loading to ensure player is fully initialized
-        GetGame().GetCallqueue().CallLater(StartTracking, 2000, false);   // Start tracking after stats are loaded
+        // Track from the first frame; the stored stats (usually prefetched on connect) are folded in when ready
+        GetGame().GetCallqueue().CallLater(LoadPlayerStats, 0, true);
+        StartTracking();
     }
     
     //------------------------------------------------------------------------------------------------
-    // Load player stats from persistence
+    // Load player stats from persistence once the player identity is available; polled every frame
     protected void LoadPlayerStats()
     {
         // Get player identity
+        PlayerIdentity identity = PlayerIdentity.Cast(m_Owner.GetIdentity());
+        if (!identity)
+        {
+            if (++m_iIdentityPolls < MAX_IDENTITY_POLLS)
+                return;
+            
+            GetGame().GetCallqueue().Remove(LoadPlayerStats);
+            Print("[StatTracker] No player identity - stats will not be loaded or saved for this entity", LogLevel.WARNING);
+            return;
+        }
+        
+        GetGame().GetCallqueue().Remove(LoadPlayerStats);
+        
+        // Answered at once from the cache if the prefetch finished, otherwise when the pending load completes
+        m_PersistenceManager.LoadPlayerStatsAsync(identity.GetPlainId(), OnPlayerStatsLoaded);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void OnPlayerStatsLoaded(STS_PlayerStats storedStats)
+    {
+        // Deleted while the load was in flight
+        if (!m_Owner || !m_PlayerStats)
+            return;
+        
         PlayerIdentity identity = PlayerIdentity.Cast(m_Owner.GetIdentity());
         if (!identity)
             return;
@@ -51,15 +85,23 @@ class STS_PlayerStatsComponent : ScriptComponent
         string playerId = identity.GetPlainId();
         string steamId = identity.GetPlainId(); // In actual implementation, get real Steam ID if available
         
-        // Load player stats from persistence
-        m_PlayerStats = m_PersistenceManager.LoadPlayerStats(playerId);
-        
-        // If new player, initialize stats
-        if (!m_PlayerStats)
+        // Null means the storage failed, not that the player is new (new players get fresh stats). Saving now
+        // would replace the stored totals with this session's, so keep tracking and try the load again later.
+        if (!storedStats)
         {
-            m_PlayerStats = new STS_EnhancedPlayerStats();
+            int delayMs = Math.Min(LOAD_RETRY_DELAY_MS * Math.Pow(2, Math.Min(m_iLoadFailures, 5)), MAX_LOAD_RETRY_DELAY_MS);
+            m_iLoadFailures++;
+            
+            Print(string.Format("[StatTracker] Failed to load stats for player %1 (attempt %2) - retrying in %3 s", 
+                playerId, m_iLoadFailures, delayMs / 1000), LogLevel.WARNING);
+            
+            GetGame().GetCallqueue().CallLater(LoadPlayerStats, delayMs, false);
+            return;
         }
         
+        FoldStoredStats(storedStats);
+        m_bStatsLoaded = true;
+        
         // Record login
         m_PlayerStats.RecordLogin(playerId, steamId);
         
@@ -68,10 +110,172 @@ class STS_PlayerStatsComponent : ScriptComponent
             m_PlayerStats.m_sIPAddress = identity.GetAddress();
             
         m_PlayerStats.m_fConnectionTime = System.GetTickCount() / 1000.0;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.SESSION);
         
         Print("[StatTracker] Loaded stats for player: " + playerId);
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Merge every persisted field of the stored stats into what was recorded since spawn, so nothing
+    // tracked during the load is lost and the following full save does not erase the stored history
+    protected void FoldStoredStats(STS_PlayerStats stored)
+    {
+        m_PlayerStats.m_iKills += stored.m_iKills;
+        m_PlayerStats.m_iDeaths += stored.m_iDeaths;
+        m_PlayerStats.m_iBasesCaptured += stored.m_iBasesCaptured;
+        m_PlayerStats.m_iBasesLost += stored.m_iBasesLost;
+        m_PlayerStats.m_iTotalXP += stored.m_iTotalXP;
+        m_PlayerStats.m_iRank = Math.Max(m_PlayerStats.m_iRank, stored.m_iRank);
+        m_PlayerStats.m_iSuppliesDelivered += stored.m_iSuppliesDelivered;
+        m_PlayerStats.m_iSupplyDeliveryCount += stored.m_iSupplyDeliveryCount;
+        m_PlayerStats.m_iAIKills += stored.m_iAIKills;
+        m_PlayerStats.m_iVehicleKills += stored.m_iVehicleKills;
+        m_PlayerStats.m_iAirKills += stored.m_iAirKills;
+        m_PlayerStats.m_fTotalPlaytime += stored.m_fTotalPlaytime;
+        
+        if (m_PlayerStats.m_fLastSessionDuration == 0)
+            m_PlayerStats.m_fLastSessionDuration = stored.m_fLastSessionDuration;
+        
+        FoldKilledBy(stored);
+        
+        STS_EnhancedPlayerStats enhanced = STS_EnhancedPlayerStats.Cast(stored);
+        if (enhanced)
+        {
+            if (enhanced.m_fFirstLogin > 0 && (m_PlayerStats.m_fFirstLogin == 0 || enhanced.m_fFirstLogin < m_PlayerStats.m_fFirstLogin))
+                m_PlayerStats.m_fFirstLogin = enhanced.m_fFirstLogin;
+            
+            // Login/logout are only recorded by this session once the load completes, so keep the stored ones until then
+            if (m_PlayerStats.m_fLastLogin == 0)
+                m_PlayerStats.m_fLastLogin = enhanced.m_fLastLogin;
+            
+            if (m_PlayerStats.m_fLastLogout == 0)
+                m_PlayerStats.m_fLastLogout = enhanced.m_fLastLogout;
+            
+            if (m_PlayerStats.m_sSteamID == "")
+                m_PlayerStats.m_sSteamID = enhanced.m_sSteamID;
+            
+            m_PlayerStats.m_iTotalSessions += enhanced.m_iTotalSessions;
+            m_PlayerStats.m_iHeadshotKills += enhanced.m_iHeadshotKills;
+            m_PlayerStats.m_iLongestKill = Math.Max(m_PlayerStats.m_iLongestKill, enhanced.m_iLongestKill);
+            m_PlayerStats.m_fDistanceTraveled += enhanced.m_fDistanceTraveled;
+            m_PlayerStats.m_fDistanceOnFoot += enhanced.m_fDistanceOnFoot;
+            m_PlayerStats.m_fDistanceInVehicles += enhanced.m_fDistanceInVehicles;
+            m_PlayerStats.m_fDamageDealt += enhanced.m_fDamageDealt;
+            m_PlayerStats.m_fDamageTaken += enhanced.m_fDamageTaken;
+            m_PlayerStats.m_iTimesBled += enhanced.m_iTimesBled;
+            m_PlayerStats.m_iTimesUnconcious += enhanced.m_iTimesUnconcious;
+            
+            m_PlayerStats.m_iMoneyEarned += enhanced.m_iMoneyEarned;
+            m_PlayerStats.m_iMoneySpent += enhanced.m_iMoneySpent;
+            
+            SumCounts(m_PlayerStats.m_mKillsByWeapon, enhanced.m_mKillsByWeapon);
+            SumCounts(m_PlayerStats.m_mItemsBought, enhanced.m_mItemsBought);
+            SumCounts(m_PlayerStats.m_mItemsSold, enhanced.m_mItemsSold);
+            SumCounts(m_PlayerStats.m_mChallenges, enhanced.m_mChallenges);
+            
+            if (enhanced.m_aAchievements)
+            {
+                foreach (string achievement : enhanced.m_aAchievements)
+                {
+                    if (m_PlayerStats.m_aAchievements.Find(achievement) == -1)
+                        m_PlayerStats.m_aAchievements.Insert(achievement);
+                }
+            }
+            
+            FoldVisitedLocations(enhanced);
+            
+            // Lower is better; zero means the player has not been ranked yet
+            if (enhanced.m_iBestLeaderboardRank > 0 && (m_PlayerStats.m_iBestLeaderboardRank == 0 || enhanced.m_iBestLeaderboardRank < m_PlayerStats.m_iBestLeaderboardRank))
+                m_PlayerStats.m_iBestLeaderboardRank = enhanced.m_iBestLeaderboardRank;
+            
+            if (m_PlayerStats.m_iLastLeaderboardRank == 0)
+                m_PlayerStats.m_iLastLeaderboardRank = enhanced.m_iLastLeaderboardRank;
+        }
+        
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.ALL);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // The stored deaths happened before this session's, so they go in front to keep the arrays chronological
+    protected void FoldKilledBy(STS_PlayerStats stored)
+    {
+        if (!stored.m_aKilledBy || stored.m_aKilledBy.IsEmpty())
+            return;
+        
+        if (!m_PlayerStats.m_aKilledBy)
+            m_PlayerStats.m_aKilledBy = new array<string>();
+        
+        if (!m_PlayerStats.m_aKilledByWeapon)
+            m_PlayerStats.m_aKilledByWeapon = new array<string>();
+        
+        if (!m_PlayerStats.m_aKilledByTeam)
+            m_PlayerStats.m_aKilledByTeam = new array<int>();
+        
+        for (int i = 0; i < stored.m_aKilledBy.Count(); i++)
+        {
+            m_PlayerStats.m_aKilledBy.InsertAt(stored.m_aKilledBy[i], i);
+            
+            if (stored.m_aKilledByWeapon && i < stored.m_aKilledByWeapon.Count())
+                m_PlayerStats.m_aKilledByWeapon.InsertAt(stored.m_aKilledByWeapon[i], i);
+            else
+                m_PlayerStats.m_aKilledByWeapon.InsertAt("Unknown", i);
+            
+            if (stored.m_aKilledByTeam && i < stored.m_aKilledByTeam.Count())
+                m_PlayerStats.m_aKilledByTeam.InsertAt(stored.m_aKilledByTeam[i], i);
+            else
+                m_PlayerStats.m_aKilledByTeam.InsertAt(-1, i);
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Union the visited locations with the same 100 m rule RecordLocationVisit uses. A place visited this
+    // session that was already stored was counted as new, so take it back off the LocationsVisited challenge.
+    protected void FoldVisitedLocations(STS_EnhancedPlayerStats stored)
+    {
+        if (!stored.m_aVisitedLocations || stored.m_aVisitedLocations.IsEmpty())
+            return;
+        
+        array<vector> merged = {};
+        merged.Copy(stored.m_aVisitedLocations);
+        
+        int revisited = 0;
+        foreach (vector position : m_PlayerStats.m_aVisitedLocations)
+        {
+            bool known = false;
+            foreach (vector storedPosition : stored.m_aVisitedLocations)
+            {
+                if (vector.Distance(storedPosition, position) < 100)
+                {
+                    known = true;
+                    break;
+                }
+            }
+            
+            if (known)
+                revisited++;
+            else
+                merged.Insert(position);
+        }
+        
+        m_PlayerStats.m_aVisitedLocations.Copy(merged);
+        
+        int visitedCount;
+        if (revisited > 0 && m_PlayerStats.m_mChallenges.Find("LocationsVisited", visitedCount))
+            m_PlayerStats.m_mChallenges.Set("LocationsVisited", Math.Max(visitedCount - revisited, 0));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void SumCounts(map<string, int> target, map<string, int> source)
+    {
+        if (!source)
+            return;
+        
+        foreach (string key, int count : source)
+        {
+            target.Set(key, target.Get(key) + count);
+        }
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Start tracking player statistics
     protected void StartTracking()
@@ -86,6 +290,7 @@ class STS_PlayerStatsComponent : ScriptComponent
     {
         // Unregister tick updates
         GetGame().GetCallqueue().Remove(OnTrackerTick);
+        GetGame().GetCallqueue().Remove(LoadPlayerStats);
         
         // Record logout and save stats
         if (m_PlayerStats)
@@ -111,10 +316,11 @@ class STS_PlayerStatsComponent : ScriptComponent
             m_LastMovementCheck = currentTime;
         }
         
-        // Check for autosave
+        // Check for autosave - idle players have nothing new to write
         if (currentTime - m_LastAutosave >= m_AutosaveInterval)
         {
-            SavePlayerStats();
+            if (m_PlayerStats.IsDirty())
+                SavePlayerStats();
             m_LastAutosave = currentTime;
         }
         
@@ -179,6 +385,7 @@ class STS_PlayerStatsComponent : ScriptComponent
         {
             // It's an AI kill
             m_PlayerStats.m_iAIKills++;
+            m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
         }
         
         // Save stats after a kill
@@ -193,6 +400,7 @@ class STS_PlayerStatsComponent : ScriptComponent
             return;
             
         m_PlayerStats.m_iDeaths++;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
         
         // Save stats after death
         SavePlayerStats();
@@ -236,6 +444,7 @@ class STS_PlayerStatsComponent : ScriptComponent
             return;
             
         m_PlayerStats.m_iBasesCaptured++;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES);
         SavePlayerStats();
     }
     
@@ -247,6 +456,7 @@ class STS_PlayerStatsComponent : ScriptComponent
             return;
             
         m_PlayerStats.m_iBasesLost++;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES);
         SavePlayerStats();
     }
     
@@ -259,6 +469,7 @@ class STS_PlayerStatsComponent : ScriptComponent
             
         m_PlayerStats.m_iSuppliesDelivered += amount;
         m_PlayerStats.m_iSupplyDeliveryCount++;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.LOGISTICS);
         SavePlayerStats();
     }
     
@@ -276,6 +487,8 @@ class STS_PlayerStatsComponent : ScriptComponent
             m_PlayerStats.m_iAirKills++;
         else
             m_PlayerStats.m_iVehicleKills++;
+        
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
             
         SavePlayerStats();
     }
@@ -308,6 +521,7 @@ class STS_PlayerStatsComponent : ScriptComponent
             return;
             
         m_PlayerStats.m_iTotalXP += amount;
+        m_PlayerStats.MarkDirty(STS_EStatsDirtyFlags.PROGRESSION);
         
         // Check for rank upgrades
         UpdateRank();
@@ -359,6 +573,14 @@ class STS_PlayerStatsComponent : ScriptComponent
     {
         if (!m_PlayerStats || !m_PersistenceManager)
             return;
+        
+        // Nothing changed since the last persist
+        if (!m_PlayerStats.IsDirty())
+            return;
+        
+        // Writing before the stored stats are folded in would overwrite them with this session alone
+        if (!m_bStatsLoaded)
+            return;
             
         PlayerIdentity identity = PlayerIdentity.Cast(m_Owner.GetIdentity());
         if (!identity)
@@ -366,8 +588,8 @@ class STS_PlayerStatsComponent : ScriptComponent
             
         string playerId = identity.GetPlainId();
         
-        // Save to persistence
-        m_PersistenceManager.SavePlayerStats(playerId, m_PlayerStats);
+        // Save to persistence; retries happen on the callqueue so a slow backend never stalls the tick
+        m_PersistenceManager.SavePlayerStatsAsync(playerId, identity.GetName(), m_PlayerStats);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -153,6 +153,52 @@ class PlayerProgression
     }
 }
 
+//------------------------------------------------------------------------------------------------
+// Writes the progression file one player per unit through the time-sliced serializer
+class STS_ProgressionSaveJob : STS_KeyedJsonSerializationJob
+{
+    protected map<int, ref PlayerProgression> m_mData;
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_ProgressionSaveJob(string targetPath, map<int, ref PlayerProgression> data)
+    {
+        m_sTargetPath = targetPath;
+        m_mData = data;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override protected void CollectKeys(notnull array<string> keys)
+    {
+        if (!m_mData)
+            return;
+        
+        foreach (int playerID, PlayerProgression progression : m_mData)
+        {
+            keys.Insert(playerID.ToString());
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override protected string SerializeValue(string key)
+    {
+        if (!m_mData)
+            return string.Empty;
+        
+        PlayerProgression progression = m_mData.Get(key.ToInt());
+        if (!progression)
+            return string.Empty;
+        
+        return progression.ToJSON();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        if (success)
+            Print(string.Format("[StatTracker] Saved progression data for %1 players", GetWrittenCount()));
+    }
+}
+
 class STS_ProgressionSystem
 {
     // Singleton instance
@@ -373,32 +419,15 @@ class STS_ProgressionSystem
     }
     
     //------------------------------------------------------------------------------------------------
-    // Save progression data to file
+    // Save progression data to file. The write is spread over frames by the time-sliced serializer; a save
+    // requested while one is still queued is covered by it.
     void SaveProgressionData()
     {
-        string fileContent = "{";
-        
-        int count = 0;
-        foreach (int playerID, PlayerProgression progression : m_mPlayerProgression)
-        {
-            fileContent += "\"" + playerID.ToString() + "\":" + progression.ToJSON();
-            
-            if (count < m_mPlayerProgression.Count() - 1)
-                fileContent += ",";
-                
-            count++;
-        }
-        
-        fileContent += "}";
-        
         // Ensure directory exists
         string dir = "$profile:StatTracker";
         FileIO.MakeDirectory(dir);
         
-        // Write to file
-        FileIO.FileWrite(PROGRESSION_DATA_PATH, fileContent);
-        
-        Print(string.Format("[StatTracker] Saved progression data for %1 players", m_mPlayerProgression.Count()));
+        STS_TimeSlicedSerializer.GetInstance().Submit(new STS_ProgressionSaveJob(PROGRESSION_DATA_PATH, m_mPlayerProgression));
     }
     
     //------------------------------------------------------------------------------------------------
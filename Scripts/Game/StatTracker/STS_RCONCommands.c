@@ -26,6 +26,7 @@ class STS_RCONCommands
     static const string CMD_CONFIG_LIST = "sts_config_list";  // List all config values
     static const string CMD_CONFIG_RELOAD = "sts_config_reload"; // Reload config from file
     static const string CMD_CONFIG_SAVE = "sts_config_save";  // Save current config to file
+    static const string CMD_BENCH = "sts_bench";         // Run the serialization/compression benchmarks
     
     // Last time monitoring data was sent
     protected int m_iLastMonitorTime = 0;
@@ -80,7 +81,8 @@ class STS_RCONCommands
               CMD_CONFIG_SET + ", " + 
               CMD_CONFIG_LIST + ", " + 
               CMD_CONFIG_RELOAD + ", " + 
-              CMD_CONFIG_SAVE);
+              CMD_CONFIG_SAVE + ", " + 
+              CMD_BENCH);
     }
     
     //------------------------------------------------------------------------------------------------
@@ -165,6 +167,10 @@ class STS_RCONCommands
                 response = HandleConfigSaveCommand(params);
                 break;
                 
+            case CMD_BENCH:
+                response = HandleBenchCommand(params);
+                break;
+            
             default:
                 response = "Unknown command: " + command;
                 break;
@@ -915,4 +921,41 @@ class STS_RCONCommands
         
         return "Configuration saved to file";
     }
-} 
\ No newline at end of file
+    
+    //------------------------------------------------------------------------------------------------
+    // Handle benchmark command. Blocks the server while it runs; meant for test servers.
+    // Format: sts_bench [label] [full]
+    protected string HandleBenchCommand(array<string> params)
+    {
+        // The default quick run uses small corpora and finishes in moments. The full run includes the 100k-player
+        // fixture and stalls the game thread for a long time, so it has to be asked for explicitly.
+        string label = "";
+        bool full = false;
+        foreach (string param : params)
+        {
+            if (param == "full")
+                full = true;
+            else if (param != "quick" && label.IsEmpty())
+                label = param;
+        }
+        
+        if (m_Logger)
+            m_Logger.LogInfo(string.Format("Benchmark request via RCON: label '%1'%2", label, full ? " (full)" : " (quick)"), "STS_RCONCommands", "HandleBenchCommand");
+        
+        STS_BenchmarkSuite suite = new STS_BenchmarkSuite();
+        int results;
+        if (full)
+            results = suite.RunAll(label);
+        else
+            results = suite.RunAll(label, {1000}, 100000);
+        
+        string response = string.Format("Benchmark finished: %1 results appended to $profile:StatTracker/Bench/results.csv", results);
+        
+        // The benchmark snapshots synthetic players; the live figure shows what real flushes cost on this server
+        STS_PersistenceManager persistence = STS_PersistenceManager.GetInstance();
+        if (persistence)
+            response += string.Format("\nLive flush snapshot cost: %1 us/player", persistence.GetAverageSnapshotCostUs());
+        
+        return response;
+    }
+}
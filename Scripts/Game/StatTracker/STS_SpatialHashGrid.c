@@ -0,0 +1,98 @@
+// STS_SpatialHashGrid.c
+// Uniform grid over the x/z plane for radius queries on heat points. Points are bucketed into square cells;
+// a query only visits the cells its radius overlaps (the 3x3 block around the point when the radius is at most
+// one cell) and compares squared distances, so it costs the local density rather than the total point count.
+
+class STS_SpatialHashGrid
+{
+    protected float m_fCellSize;
+    
+    // Point indices per cell, keyed by the packed cell coordinates
+    protected ref map<int, ref array<int>> m_mCells = new map<int, ref array<int>>();
+    protected ref array<vector> m_aPositions = new array<vector>();
+    
+    //------------------------------------------------------------------------------------------------
+    // Queries are cheapest with a cell size equal to the usual query radius
+    void STS_SpatialHashGrid(float cellSize)
+    {
+        m_fCellSize = Math.Max(0.01, cellSize);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Add a point; returns its index, which is the order of insertion
+    int Insert(vector position)
+    {
+        int index = m_aPositions.Insert(position);
+        
+        int key = CellKey(CellCoord(position[0]), CellCoord(position[2]));
+        array<int> cell = m_mCells.Get(key);
+        if (!cell)
+        {
+            cell = new array<int>();
+            m_mCells.Insert(key, cell);
+        }
+        
+        cell.Insert(index);
+        return index;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Fill result with the indices of the points within radius of position (3D distance), except excludeIndex
+    void QueryRadius(vector position, float radius, notnull array<int> result, int excludeIndex = -1)
+    {
+        result.Clear();
+        
+        float radiusSq = radius * radius;
+        int reach = Math.Ceil(radius / m_fCellSize);
+        int centerX = CellCoord(position[0]);
+        int centerZ = CellCoord(position[2]);
+        
+        for (int x = centerX - reach; x <= centerX + reach; x++)
+        {
+            for (int z = centerZ - reach; z <= centerZ + reach; z++)
+            {
+                array<int> cell = m_mCells.Get(CellKey(x, z));
+                if (!cell)
+                    continue;
+                
+                foreach (int index : cell)
+                {
+                    if (index != excludeIndex && vector.DistanceSq(position, m_aPositions[index]) <= radiusSq)
+                        result.Insert(index);
+                }
+            }
+        }
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    vector GetPosition(int index)
+    {
+        return m_aPositions[index];
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    int Count()
+    {
+        return m_aPositions.Count();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    void Clear()
+    {
+        m_mCells.Clear();
+        m_aPositions.Clear();
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected int CellCoord(float value)
+    {
+        return Math.Floor(value / m_fCellSize);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Exact for cell coordinates within +-32767, which covers any map at any sensible cell size
+    protected int CellKey(int x, int z)
+    {
+        return (x & 0xFFFF) | (z << 16);
+    }
+}
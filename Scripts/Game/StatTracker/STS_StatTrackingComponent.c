@@ -728,6 +728,7 @@ class STS_StatTrackingComponent : ScriptComponent
                     {
                         // Normal player kill
                         m_Stats.m_iKills++;
+                        m_Stats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
                         m_Logger.LogInfo(string.Format("%1 killed player %2 with %3", 
                             m_sPlayerName, victimComponent.GetPlayerName(), weaponName),
                             "STS_StatTrackingComponent", "OnDamageDealt");
@@ -746,6 +747,7 @@ class STS_StatTrackingComponent : ScriptComponent
                 {
                     // AI kill
                     m_Stats.m_iAIKills++;
+                    m_Stats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
                     m_Logger.LogDebug(string.Format("%1 killed AI %2 with %3", 
                         m_sPlayerName, victimComponent.GetPlayerName(), weaponName),
                         "STS_StatTrackingComponent", "OnDamageDealt");
@@ -758,6 +760,7 @@ class STS_StatTrackingComponent : ScriptComponent
                 if (isAircraft)
                 {
                     m_Stats.m_iAirKills++;
+                    m_Stats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
                     m_Logger.LogInfo(string.Format("%1 destroyed aircraft %2", 
                         m_sPlayerName, victim.GetName()),
                         "STS_StatTrackingComponent", "OnDamageDealt");
@@ -765,6 +768,7 @@ class STS_StatTrackingComponent : ScriptComponent
                 else
                 {
                     m_Stats.m_iVehicleKills++;
+                    m_Stats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
                     m_Logger.LogInfo(string.Format("%1 destroyed vehicle %2", 
                         m_sPlayerName, victim.GetName()),
                         "STS_StatTrackingComponent", "OnDamageDealt");
@@ -802,6 +806,7 @@ class STS_StatTrackingComponent : ScriptComponent
                 if (m_Stats)
                 {
                     m_Stats.m_iDeaths++;
+                    m_Stats.MarkDirty(STS_EStatsDirtyFlags.COMBAT);
                     
                     m_Logger.LogDebug(string.Format("Death recorded for player %1 (ID: %2)", m_sPlayerName, m_iPlayerID), 
                         "STS_StatTrackingComponent", "OnDamageStateChanged");
@@ -843,6 +848,7 @@ class STS_StatTrackingComponent : ScriptComponent
             }
             
             m_Stats.m_iBasesCaptured++;
+            m_Stats.MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES);
             AddXP(50);
             
             m_Logger.LogDebug(string.Format("Base capture recorded for player %1 (ID: %2)", m_sPlayerName, m_iPlayerID), 
@@ -876,6 +882,7 @@ class STS_StatTrackingComponent : ScriptComponent
             }
             
             m_Stats.m_iBasesLost++;
+            m_Stats.MarkDirty(STS_EStatsDirtyFlags.OBJECTIVES);
             
             m_Logger.LogDebug(string.Format("Base loss recorded for player %1 (ID: %2)", m_sPlayerName, m_iPlayerID), 
                 "STS_StatTrackingComponent", "AddBaseLost");
@@ -909,6 +916,7 @@ class STS_StatTrackingComponent : ScriptComponent
             
             m_Stats.m_iSuppliesDelivered += amount;
             m_Stats.m_iSupplyDeliveryCount++;
+            m_Stats.MarkDirty(STS_EStatsDirtyFlags.LOGISTICS);
             AddXP(amount);
             
             m_Logger.LogDebug(string.Format("Supplies delivery recorded for player %1 (ID: %2): %3 units", 
@@ -951,6 +959,7 @@ class STS_StatTrackingComponent : ScriptComponent
             
             int oldXP = m_Stats.m_iTotalXP;
             m_Stats.m_iTotalXP += amount;
+            m_Stats.MarkDirty(STS_EStatsDirtyFlags.PROGRESSION);
             
             m_Logger.LogDebug(string.Format("Added %1 XP to player %2 (now %3, was %4)", 
                 amount, m_sPlayerName, m_Stats.m_iTotalXP, oldXP), 
@@ -985,6 +994,7 @@ class STS_StatTrackingComponent : ScriptComponent
             
             m_Stats.m_sIPAddress = ipAddress;
             m_Stats.m_fConnectionTime = System.GetTickCount() / 1000.0; // Current time in seconds
+            m_Stats.MarkDirty(STS_EStatsDirtyFlags.SESSION);
             
             m_Logger.LogDebug(string.Format("Connection info set for player %1 (ID: %2): IP=%3", 
                 m_sPlayerName, m_iPlayerID, ipAddress), 
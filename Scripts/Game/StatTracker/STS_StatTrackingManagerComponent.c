@@ -1,6 +1,116 @@
 // STS_StatTrackingManagerComponent.c
 // Manager component to track all players' stats and handle global events
 
+//------------------------------------------------------------------------------------------------
+// Writes the current session snapshot one player per unit through the time-sliced serializer
+class STS_SessionSnapshotJob : STS_SerializationJob
+{
+    protected string m_sSessionId;
+    protected float m_fTimestamp;
+    protected ref array<STS_StatTrackingComponent> m_aPlayers = new array<STS_StatTrackingComponent>();
+    protected int m_iCursor = 0;
+    protected int m_iWritten = 0;
+    
+    protected static const string HEX_DIGITS = "0123456789abcdef";
+    
+    //------------------------------------------------------------------------------------------------
+    void STS_SessionSnapshotJob(string targetPath, string sessionId, array<STS_StatTrackingComponent> players)
+    {
+        m_sTargetPath = targetPath;
+        m_sSessionId = sessionId;
+        m_fTimestamp = System.GetTickCount() / 1000.0;
+        m_aPlayers.Copy(players);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void Begin(FileHandle file)
+    {
+        file.WriteLine("{");
+        file.WriteLine("\"sessionId\":\"" + m_sSessionId + "\",");
+        file.WriteLine("\"timestamp\":" + m_fTimestamp.ToString() + ",");
+        file.WriteLine("\"serverName\":\"Unknown\",");
+        file.WriteLine("\"players\":[");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override bool WriteNext(FileHandle file)
+    {
+        while (m_iCursor < m_aPlayers.Count())
+        {
+            // Players that left or are AI since the snapshot was requested are skipped
+            STS_StatTrackingComponent player = m_aPlayers[m_iCursor];
+            m_iCursor++;
+            
+            if (!player || player.IsAI())
+                continue;
+            
+            string json = "";
+            if (m_iWritten > 0)
+                json = ",";
+            
+            json += "{\"id\":" + player.GetPlayerID().ToString() + ",\"name\":\"" + EscapeJsonString(player.GetPlayerName()) + "\"";
+            
+            STS_PlayerStats stats = player.GetStats();
+            if (stats)
+                json += ",\"kills\":" + stats.m_iKills.ToString() + ",\"deaths\":" + stats.m_iDeaths.ToString();
+            
+            json += "}";
+            
+            file.WriteLine(json);
+            m_iWritten++;
+            return true;
+        }
+        
+        return false;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Player names are chosen by the players; quotes, backslashes and control characters must not end the string
+    protected static string EscapeJsonString(string value)
+    {
+        string escaped = "";
+        for (int i = 0; i < value.Length(); i++)
+        {
+            string character = value.Get(i);
+            int code = character.ToAscii() & 0xFF;
+            
+            if (character == "\"" || character == "\\")
+                escaped += "\\" + character;
+            else if (character == "\n")
+                escaped += "\\n";
+            else if (character == "\r")
+                escaped += "\\r";
+            else if (character == "\t")
+                escaped += "\\t";
+            else if (code < 0x20 || code == 0x7F)
+                escaped += "\\u00" + HEX_DIGITS.Get(code >> 4) + HEX_DIGITS.Get(code & 0xF);
+            else
+                escaped += character;
+        }
+        
+        return escaped;
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void End(FileHandle file)
+    {
+        file.WriteLine("],");
+        file.WriteLine("\"playerCount\":" + m_iWritten.ToString());
+        file.WriteLine("}");
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    override void OnComplete(bool success)
+    {
+        STS_LoggingSystem logger = STS_LoggingSystem.GetInstance();
+        if (success && logger)
+        {
+            logger.LogInfo(string.Format("Session snapshot saved - session ID: %1, players: %2", m_sSessionId, m_iWritten), 
+                "STS_SessionSnapshotJob", "OnComplete");
+        }
+    }
+}
+
 class STS_StatTrackingManagerComponent : ScriptComponent
 {
     // List of all registered players
@@ -17,9 +127,25 @@ class STS_StatTrackingManagerComponent : ScriptComponent
     protected string m_sStatsFilePath = "$profile:StatTracker/player_stats.json";
     protected string m_sSessionFilePath = "$profile:StatTracker/current_session.json";
     
-    // Player stats cache for load/save operations (mapped by player UID)
+    // Stats version of each player at the last broadcast (mapped by player ID)
+    protected ref map<int, int> m_mBroadcastVersions = new map<int, int>();
+    
+    // Hash-partitioned stats files; only shards holding changed players are rewritten
+    protected ref STS_PlayerStatsShardStore m_ShardStore = new STS_PlayerStatsShardStore();
+    
+    // Byte-range index of the legacy single stats file, read-only; players are only parsed when they connect
+    protected ref STS_PlayerStatsFileIndex m_PlayerStatsIndex = new STS_PlayerStatsFileIndex();
+    
+    // Stats of connected players hydrated from the stats files (mapped by player UID)
     protected ref map<string, ref STS_PlayerStats> m_mPlayerStatsCache = new map<string, ref STS_PlayerStats>();
     
+    // Players whose stored stats are not merged into their live stats yet. Their live stats only hold this
+    // session and would overwrite the stored totals, so they are not saved until the merge.
+    protected ref set<string> m_PendingStoredStats = new set<string>();
+    protected ref map<string, int> m_mStoredStatsLoadFailures = new map<string, int>();
+    protected const int STORED_STATS_RETRY_DELAY_MS = 5000;
+    protected const int MAX_STORED_STATS_RETRY_DELAY_MS = 120000;
+    
     // RPCs for client-server communication
     [RplRpc(RplChannel.Reliable, RplRcver.Broadcast)]
     protected void RPC_UpdateStats(array<int> playerIDs, array<ref STS_PlayerStats> playerStats, array<string> playerNames)
@@ -75,7 +201,12 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         if (Replication.IsServer())
         {
             // Save stats before shutting down
-            SaveAllPlayerStats();
+            SaveAllPlayerStats(true);
+            SaveCurrentSession();
+            m_ShardStore.FlushAll();
+            
+            // Finish every save that is still being written over frames
+            STS_TimeSlicedSerializer.GetInstance().FlushAll();
             
             // Unsubscribe from game events
             SCR_BaseGameMode gameMode = SCR_BaseGameMode.Cast(GetGame().GetGameMode());
@@ -104,6 +235,9 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         // Only do this on server
         if (!Replication.IsServer())
             return;
+        
+        // Persistence backs off when the server is near its frame budget
+        STS_AdmissionController.GetInstance().ReportFrameTime(timeSlice);
             
         // Auto-save stats periodically
         float currentTime = System.GetTickCount() / 1000.0;
@@ -154,6 +288,12 @@ class STS_StatTrackingManagerComponent : ScriptComponent
     // Broadcast all player stats to clients
     protected void BroadcastStats()
     {
+        // Nothing to send if the roster and every player's stats are unchanged since the last broadcast
+        if (!HasUnbroadcastChanges())
+            return;
+        
+        m_mBroadcastVersions.Clear();
+        
         array<int> playerIDs = new array<int>();
         array<ref STS_PlayerStats> playerStats = new array<ref STS_PlayerStats>();
         array<string> playerNames = new array<string>();
@@ -161,15 +301,40 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         // Collect all player stats
         foreach (STS_StatTrackingComponent player : m_aPlayers)
         {
+            STS_PlayerStats stats = player.GetStats();
             playerIDs.Insert(player.GetPlayerID());
-            playerStats.Insert(player.GetStats());
+            playerStats.Insert(stats);
             playerNames.Insert(player.GetPlayerName());
+            
+            if (stats)
+                m_mBroadcastVersions.Set(player.GetPlayerID(), stats.GetVersion());
         }
         
         // Send RPC to all clients
         RPC_UpdateStats(playerIDs, playerStats, playerNames);
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Check whether any player joined, left or changed stats since the last broadcast
+    protected bool HasUnbroadcastChanges()
+    {
+        if (m_aPlayers.Count() != m_mBroadcastVersions.Count())
+            return true;
+        
+        foreach (STS_StatTrackingComponent player : m_aPlayers)
+        {
+            STS_PlayerStats stats = player.GetStats();
+            if (!stats)
+                return true;
+            
+            int lastVersion;
+            if (!m_mBroadcastVersions.Find(player.GetPlayerID(), lastVersion) || lastVersion != stats.GetVersion())
+                return true;
+        }
+        
+        return false;
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Register a player with the manager
     void RegisterPlayer(STS_StatTrackingComponent player)
@@ -251,8 +416,10 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                 
                 // Try to load previous stats
                 string playerUID = GetPlayerUID(playerId);
-                if (!playerUID.IsEmpty() && m_mPlayerStatsCache.Contains(playerUID))
+                if (!playerUID.IsEmpty() && HasPreviousStats(playerUID))
                 {
+                    m_PendingStoredStats.Insert(playerUID);
+                    
                     // Successfully loaded previous stats
                     if (LoadPlayerPreviousStats(player, playerUID))
                     {
@@ -261,7 +428,7 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                     }
                     else
                     {
-                        logger.LogWarning(string.Format("Failed to load previous stats for player %1 (UID: %2)", 
+                        logger.LogWarning(string.Format("Failed to load previous stats for player %1 (UID: %2) - saves are held back until a retry loads them", 
                             playerName, playerUID), "STS_StatTrackingManagerComponent", "RegisterPlayer");
                     }
                 }
@@ -319,12 +486,29 @@ class STS_StatTrackingManagerComponent : ScriptComponent
             {
                 STS_PlayerStats stats = player.GetStats();
                 
-                // Update the cache with current stats
-                if (!m_mPlayerStatsCache.Contains(playerUID))
-                    m_mPlayerStatsCache.Insert(playerUID, new STS_PlayerStats());
+                // Only connected players stay hydrated; the shard store keeps the stats for a reconnect
+                m_mPlayerStatsCache.Remove(playerUID);
+                m_mStoredStatsLoadFailures.Remove(playerUID);
+                
+                if (m_PendingStoredStats.Contains(playerUID))
+                {
+                    // Saving the session alone would replace the stored totals
+                    m_PendingStoredStats.RemoveItem(playerUID);
+                    Print(string.Format("[StatTracker] Warning: Player %1 (UID: %2) left before their stored stats loaded - this session's stats are not saved", 
+                        player.GetPlayerName(), playerUID), LogLevel.WARNING);
+                }
+                else
+                {
+                    m_ShardStore.MarkChanged(playerUID, stats);
                     
-                // Copy the current stats
-                m_mPlayerStatsCache[playerUID] = stats;
+                    // Queue the final save - the player is no longer in m_aPlayers when the batch flushes
+                    STS_PersistenceManager persistenceManager = STS_PersistenceManager.GetInstance();
+                    if (persistenceManager)
+                    {
+                        stats.UpdateSessionDuration();
+                        persistenceManager.QueuePlayerStatsSave(playerUID, player.GetPlayerName(), stats);
+                    }
+                }
                 
                 Print(string.Format("[StatTracker] Player %1 (ID: %2) disconnected. Session duration: %3 minutes", 
                     player.GetPlayerName(), 
@@ -348,6 +532,19 @@ class STS_StatTrackingManagerComponent : ScriptComponent
     // Called when a player connects
     void OnPlayerConnected(int playerId)
     {
+        // Connect waves load and save many players at once - let the database burst
+        STS_AdmissionController.GetInstance().NotifyPlayerWave();
+        
+        // Start loading stats now, before the character exists; RegisterPlayer picks up the warm
+        // result or attaches to the load still in flight
+        if (Replication.IsServer())
+        {
+            string playerUID = GetPlayerUID(playerId);
+            STS_PersistenceManager persistenceManager = STS_PersistenceManager.GetInstance();
+            if (!playerUID.IsEmpty() && persistenceManager)
+                persistenceManager.PrefetchPlayerStats(playerUID);
+        }
+        
         // Player component will register itself when initialized
         Print(string.Format("[StatTracker] Player connected with ID: %1", playerId));
     }
@@ -359,6 +556,8 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         // Only process on server
         if (!Replication.IsServer())
             return;
+        
+        STS_AdmissionController.GetInstance().NotifyPlayerWave();
             
         // Find and remove the player
         STS_StatTrackingComponent playerComponent = null;
@@ -430,8 +629,8 @@ class STS_StatTrackingManagerComponent : ScriptComponent
     }
     
     //------------------------------------------------------------------------------------------------
-    // Save all player stats to the database
-    void SaveAllPlayerStats()
+    // Save all player stats to the database; a shutdown save bypasses admission control
+    void SaveAllPlayerStats(bool shutdown = false)
     {
         // Create local logger reference
         STS_LoggingSystem logger = STS_LoggingSystem.GetInstance();
@@ -459,11 +658,13 @@ class STS_StatTrackingManagerComponent : ScriptComponent
             logger.LogInfo(string.Format("Saving stats for %1 players", m_aPlayers.Count()), 
                 "STS_StatTrackingManagerComponent", "SaveAllPlayerStats");
             
-            // Track success/failure counts
-            int successCount = 0;
+            // Track players that could not be queued, idle players with nothing new to write and players whose
+            // stored stats are not merged yet
             int failureCount = 0;
+            int skippedCount = 0;
+            int heldCount = 0;
             
-            // Save each player's stats
+            // Queue each player's stats; they are written as one batched upsert below
             foreach (STS_StatTrackingComponent player : m_aPlayers)
             {
                 // Skip AI players
@@ -484,6 +685,12 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                     continue;
                 }
                 
+                if (m_PendingStoredStats.Contains(playerUID))
+                {
+                    heldCount++;
+                    continue;
+                }
+                
                 // Get player stats
                 STS_PlayerStats stats = player.GetStats();
                 if (!stats)
@@ -494,21 +701,27 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                     continue;
                 }
                 
+                // Idle players are not re-serialized; their playtime is folded in on the next change or on disconnect
+                if (!stats.IsDirty())
+                {
+                    skippedCount++;
+                    continue;
+                }
+                
                 // Update session duration before saving
                 stats.UpdateSessionDuration();
                 
-                // Save to database
-                bool success = persistenceManager.SavePlayerStats(playerUID, playerName, stats);
-                
-                if (success)
-                    successCount++;
-                else
-                    failureCount++;
+                persistenceManager.QueuePlayerStatsSave(playerUID, playerName, stats);
+                m_ShardStore.MarkChanged(playerUID, stats);
             }
             
+            // Flush the window as a single batch
+            STS_PlayerStatsFlushResult result = persistenceManager.FlushQueuedPlayerStats(shutdown);
+            
             // Log results
-            logger.LogInfo(string.Format("Saved player stats: %1 successful, %2 failed", 
-                successCount, failureCount), "STS_StatTrackingManagerComponent", "SaveAllPlayerStats");
+            logger.LogInfo(string.Format("Saved player stats: %1 successful, %2 failed, %3 unchanged, %4 waiting for stored stats in %5 ms", 
+                result.GetSuccessCount(), result.GetFailureCount() + failureCount, skippedCount, heldCount, result.m_fDurationMs), 
+                "STS_StatTrackingManagerComponent", "SaveAllPlayerStats");
         }
         catch (Exception e)
         {
@@ -546,45 +759,10 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                 return;
             }
             
-            // Create a session snapshot
-            JsonObjectRef sessionData = new JsonObjectRef();
-            
-            // Add session ID
-            sessionData.AddString("sessionId", persistenceManager.GetCurrentSessionId());
-            
-            // Add timestamp
-            sessionData.AddFloat("timestamp", System.GetTickCount() / 1000.0);
-            
-            // Add server name
-            string serverName = "Unknown";
-            sessionData.AddString("serverName", serverName);
-            
-            // Add player count
-            sessionData.AddInt("playerCount", m_aPlayers.Count());
-            
-            // Add online players
-            JsonArray playerIds = new JsonArray();
-            JsonArray playerNames = new JsonArray();
-            
-            foreach (STS_StatTrackingComponent player : m_aPlayers)
-            {
-                // Skip AI
-                if (player.IsAI())
-                    continue;
-                    
-                playerIds.AddInt(player.GetPlayerID());
-                playerNames.AddString(player.GetPlayerName());
-            }
-            
-            sessionData.AddArray("playerIds", playerIds);
-            sessionData.AddArray("playerNames", playerNames);
-            
-            // Run process to save session snapshot
-            // This functionality would be implemented in a dedicated session manager
-            // For now, log that we've created a session snapshot
-            logger.LogInfo(string.Format("Session snapshot created - session ID: %1, players: %2", 
-                persistenceManager.GetCurrentSessionId(), m_aPlayers.Count()), 
-                "STS_StatTrackingManagerComponent", "SaveCurrentSession");
+            // Write the session snapshot over several frames
+            FileIO.MakeDirectory("$profile:StatTracker");
+            STS_TimeSlicedSerializer.GetInstance().Submit(new STS_SessionSnapshotJob(m_sSessionFilePath, 
+                persistenceManager.GetCurrentSessionId(), m_aPlayers));
         }
         catch (Exception e)
         {
@@ -611,94 +789,55 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         // Clear cache
         m_mPlayerStatsCache.Clear();
         
-        // Try to open file
-        FileHandle file = FileIO.OpenFile(m_sStatsFilePath, FileMode.READ);
-        if (!file)
-        {
-            Print(string.Format("[StatTracker] No player stats file found at %1, starting with empty stats", m_sStatsFilePath));
-            return;
-        }
-        
-        // Read file content
-        string content;
-        file.ReadToString(content);
-        file.Close();
-        
-        // Parse JSON (simplified parsing for demonstration)
-        // In a real implementation, use a proper JSON parser
-        if (content.Length() == 0)
-        {
-            Print("[StatTracker] Stats file is empty");
-            return;
-        }
-        
-        // Check for start of players object
-        int playersStart = content.IndexOf("\"players\":{");
-        if (playersStart == -1)
-        {
-            Print("[StatTracker] Invalid stats file format");
-            return;
-        }
+        // Shard indexes load in batches over the next frames
+        m_ShardStore.StartLoading();
         
-        // Extract players object
-        string playersJson = content.Substring(playersStart + 10);
-        int playersEnd = playersJson.LastIndexOf("}");
-        if (playersEnd == -1)
+        // Only the index is loaded at boot; player objects are parsed on demand
+        float startTime = System.GetTickCount();
+        if (!m_PlayerStatsIndex.Load(m_sStatsFilePath))
         {
-            Print("[StatTracker] Invalid stats file format (no closing })");
+            Print(string.Format("[StatTracker] No legacy player stats file found at %1", m_sStatsFilePath));
             return;
         }
         
-        playersJson = playersJson.Substring(0, playersEnd);
+        Print(string.Format("[StatTracker] Indexed stats for %1 players from %2 in %3 ms", m_PlayerStatsIndex.Count(), m_sStatsFilePath, 
+            System.GetTickCount() - startTime));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Whether a player has stats from an earlier session or connection
+    protected bool HasPreviousStats(string playerUID)
+    {
+        if (m_mPlayerStatsCache.Contains(playerUID) || m_ShardStore.Contains(playerUID) || m_PlayerStatsIndex.Contains(playerUID))
+            return true;
         
-        // Split by player UIDs
-        bool parsingPlayer = false;
-        string currentPlayerUID = "";
-        string currentPlayerJson = "";
-        int bracketCount = 0;
+        // Prefetched on connect, or the prefetch is still running
+        STS_PersistenceManager persistenceManager = STS_PersistenceManager.GetInstance();
+        return persistenceManager && (persistenceManager.HasCachedPlayerStats(playerUID) || persistenceManager.IsLoadingPlayerStats(playerUID));
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Parse a player's stats from the stat shards (or the legacy stats file) on first use
+    protected STS_PlayerStats HydrateCachedStats(string playerUID)
+    {
+        STS_PlayerStats stats = m_mPlayerStatsCache.Get(playerUID);
+        if (stats)
+            return stats;
         
-        for (int i = 0; i < playersJson.Length(); i++)
+        stats = m_ShardStore.Load(playerUID);
+        if (!stats)
         {
-            char c = playersJson[i];
+            string json = m_PlayerStatsIndex.ReadRecord(playerUID);
+            if (json.IsEmpty())
+                return null;
             
-            // Start of player UID
-            if (c == '"' && !parsingPlayer && bracketCount == 0)
-            {
-                int uidEnd = playersJson.IndexOf("\":", i + 1);
-                if (uidEnd != -1)
-                {
-                    currentPlayerUID = playersJson.Substring(i + 1, uidEnd - i - 1);
-                    i = uidEnd + 1;
-                    parsingPlayer = true;
-                    currentPlayerJson = "";
-                    continue;
-                }
-            }
-            
-            // Track JSON object nesting
-            if (c == '{')
-                bracketCount++;
-            else if (c == '}')
-                bracketCount--;
-                
-            // If parsing player and we're at the end of the player's JSON object
-            if (parsingPlayer)
-            {
-                currentPlayerJson += c;
-                
-                if (bracketCount == 0)
-                {
-                    // Parse this player's stats
-                    STS_PlayerStats stats = new STS_PlayerStats();
-                    stats.FromJSON(currentPlayerJson);
-                    m_mPlayerStatsCache.Insert(currentPlayerUID, stats);
-                    
-                    parsingPlayer = false;
-                }
-            }
+            stats = new STS_PlayerStats();
+            if (!stats.FromJSON(json))
+                return null;
         }
         
-        Print(string.Format("[StatTracker] Loaded stats for %1 players from %2", m_mPlayerStatsCache.Count(), m_sStatsFilePath));
+        m_mPlayerStatsCache.Set(playerUID, stats);
+        return stats;
     }
     
     //------------------------------------------------------------------------------------------------
@@ -725,92 +864,52 @@ class STS_StatTrackingManagerComponent : ScriptComponent
                 return false;
             }
             
-            // Get persistence manager
             STS_PersistenceManager persistenceManager = STS_PersistenceManager.GetInstance();
-            if (!persistenceManager)
-            {
-                logger.LogError("Failed to get persistence manager - previous stats cannot be loaded", 
-                    "STS_StatTrackingManagerComponent", "LoadPlayerPreviousStats");
-                return false;
-            }
             
-            // Load player's previous stats from database
-            STS_PlayerStats previousStats = persistenceManager.LoadPlayerStats(playerUID);
-            
-            // If no previous stats found, nothing more to do
-            if (!previousStats)
-                return false;
-            
-            // Get current stats
-            STS_PlayerStats currentStats = player.GetStats();
-            if (!currentStats)
+            // The prefetch started in OnPlayerConnected is still running - attach to it instead of loading again.
+            // Tracking continues meanwhile; the loaded stats are added on top of whatever this session recorded,
+            // and the player's saves are held back until then.
+            if (persistenceManager && persistenceManager.IsLoadingPlayerStats(playerUID))
             {
-                logger.LogWarning(string.Format("Failed to get current stats for player %1 - creating new stats", 
-                    player.GetPlayerName()), "STS_StatTrackingManagerComponent", "LoadPlayerPreviousStats");
-                
-                currentStats = new STS_PlayerStats();
-                player.SetStats(currentStats);
-            }
-            
-            // Copy data from previous stats
-            currentStats.m_iKills = previousStats.m_iKills;
-            currentStats.m_iDeaths = previousStats.m_iDeaths;
-            currentStats.m_iBasesLost = previousStats.m_iBasesLost;
-            currentStats.m_iBasesCaptured = previousStats.m_iBasesCaptured;
-            currentStats.m_iTotalXP = previousStats.m_iTotalXP;
-            currentStats.m_iRank = previousStats.m_iRank;
-            currentStats.m_iSuppliesDelivered = previousStats.m_iSuppliesDelivered;
-            currentStats.m_iSupplyDeliveryCount = previousStats.m_iSupplyDeliveryCount;
-            currentStats.m_iAIKills = previousStats.m_iAIKills;
-            currentStats.m_iVehicleKills = previousStats.m_iVehicleKills;
-            currentStats.m_iAirKills = previousStats.m_iAirKills;
-            
-            // Add session time to total playtime
-            currentStats.m_fTotalPlaytime = previousStats.m_fTotalPlaytime;
-            currentStats.m_fLastSessionDuration = previousStats.m_fLastSessionDuration;
-            
-            // Copy killed by information if available
-            if (previousStats.m_aKilledBy && previousStats.m_aKilledBy.Count() > 0)
-            {
-                // Create arrays if they don't exist
-                if (!currentStats.m_aKilledBy)
-                    currentStats.m_aKilledBy = new array<string>();
-                    
-                if (!currentStats.m_aKilledByWeapon)
-                    currentStats.m_aKilledByWeapon = new array<string>();
-                    
-                if (!currentStats.m_aKilledByTeam)
-                    currentStats.m_aKilledByTeam = new array<int>();
-                
-                // Clear existing arrays
-                currentStats.m_aKilledBy.Clear();
-                currentStats.m_aKilledByWeapon.Clear();
-                currentStats.m_aKilledByTeam.Clear();
-                
-                // Copy data
-                for (int i = 0; i < previousStats.m_aKilledBy.Count(); i++)
+                func<STS_PlayerStats> onLoaded = func<STS_PlayerStats>(STS_PlayerStats loadedStats)
                 {
-                    currentStats.m_aKilledBy.Insert(previousStats.m_aKilledBy[i]);
+                    // Left before the load finished - nothing was saved for this session
+                    if (!m_aPlayers.Contains(player))
+                        return;
                     
-                    if (i < previousStats.m_aKilledByWeapon.Count())
-                        currentStats.m_aKilledByWeapon.Insert(previousStats.m_aKilledByWeapon[i]);
-                    else
-                        currentStats.m_aKilledByWeapon.Insert("Unknown");
+                    if (!loadedStats)
+                        loadedStats = HydrateCachedStats(playerUID);
                     
-                    if (i < previousStats.m_aKilledByTeam.Count())
-                        currentStats.m_aKilledByTeam.Insert(previousStats.m_aKilledByTeam[i]);
+                    if (loadedStats)
+                        ApplyPreviousStats(player, playerUID, loadedStats);
                     else
-                        currentStats.m_aKilledByTeam.Insert(-1);
-                }
+                        ScheduleStoredStatsRetry(player, playerUID);
+                };
+                
+                persistenceManager.LoadPlayerStatsAsync(playerUID, onLoaded);
+                return true;
             }
             
-            // Update rank based on loaded XP
-            player.UpdateRank();
+            // Load player's previous stats from database
+            STS_PlayerStats previousStats = null;
+            if (persistenceManager)
+                previousStats = persistenceManager.LoadPlayerStats(playerUID);
+            else
+                logger.LogWarning("Failed to get persistence manager - falling back to the stats file", 
+                    "STS_StatTrackingManagerComponent", "LoadPlayerPreviousStats");
+            
+            // Fall back to the stats file cache
+            if (!previousStats)
+                previousStats = HydrateCachedStats(playerUID);
             
-            logger.LogInfo(string.Format("Successfully loaded previous stats for player %1 (UID: %2) - Kills: %3, XP: %4", 
-                player.GetPlayerName(), playerUID, currentStats.m_iKills, currentStats.m_iTotalXP), 
-                "STS_StatTrackingManagerComponent", "LoadPlayerPreviousStats");
+            // Stored stats exist but could not be read; keep the saves held back and try again
+            if (!previousStats)
+            {
+                ScheduleStoredStatsRetry(player, playerUID);
+                return false;
+            }
             
+            ApplyPreviousStats(player, playerUID, previousStats);
             return true;
         }
         catch (Exception e)
@@ -830,6 +929,112 @@ class STS_StatTrackingManagerComponent : ScriptComponent
         }
     }
     
+    //------------------------------------------------------------------------------------------------
+    // Load the stored stats again after a failure, backing off up to MAX_STORED_STATS_RETRY_DELAY_MS
+    protected void ScheduleStoredStatsRetry(STS_StatTrackingComponent player, string playerUID)
+    {
+        int failures = m_mStoredStatsLoadFailures.Get(playerUID);
+        m_mStoredStatsLoadFailures.Set(playerUID, failures + 1);
+        
+        int delayMs = Math.Min(STORED_STATS_RETRY_DELAY_MS * Math.Pow(2, Math.Min(failures, 5)), MAX_STORED_STATS_RETRY_DELAY_MS);
+        GetGame().GetCallqueue().CallLater(RetryLoadPlayerPreviousStats, delayMs, false, player, playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    protected void RetryLoadPlayerPreviousStats(STS_StatTrackingComponent player, string playerUID)
+    {
+        if (!player || !m_aPlayers.Contains(player) || !m_PendingStoredStats.Contains(playerUID))
+            return;
+        
+        LoadPlayerPreviousStats(player, playerUID);
+    }
+    
+    //------------------------------------------------------------------------------------------------
+    // Fold a player's stored stats into their live stats. The live stats only hold what this session has
+    // recorded so far, so stored counters are added rather than copied - nothing tracked while an async load
+    // was in flight is lost.
+    protected void ApplyPreviousStats(STS_StatTrackingComponent player, string playerUID, STS_PlayerStats previousStats)
+    {
+        STS_LoggingSystem logger = STS_LoggingSystem.GetInstance();
+        
+        // Get current stats
+        STS_PlayerStats currentStats = player.GetStats();
+        if (!currentStats)
+        {
+            logger.LogWarning(string.Format("Failed to get current stats for player %1 - creating new stats", 
+                player.GetPlayerName()), "STS_StatTrackingManagerComponent", "ApplyPreviousStats");
+            
+            currentStats = new STS_PlayerStats();
+            player.SetStats(currentStats);
+        }
+        
+        // A write-through cache entry of the live stats is not stored data; merging it would double the session
+        if (previousStats == currentStats)
+        {
+            logger.LogWarning(string.Format("Stored stats for player %1 (UID: %2) resolved to the live stats - loading again", 
+                player.GetPlayerName(), playerUID), "STS_StatTrackingManagerComponent", "ApplyPreviousStats");
+            ScheduleStoredStatsRetry(player, playerUID);
+            return;
+        }
+        
+        // Add data from previous stats
+        currentStats.m_iKills += previousStats.m_iKills;
+        currentStats.m_iDeaths += previousStats.m_iDeaths;
+        currentStats.m_iBasesLost += previousStats.m_iBasesLost;
+        currentStats.m_iBasesCaptured += previousStats.m_iBasesCaptured;
+        currentStats.m_iTotalXP += previousStats.m_iTotalXP;
+        currentStats.m_iRank = Math.Max(currentStats.m_iRank, previousStats.m_iRank);
+        currentStats.m_iSuppliesDelivered += previousStats.m_iSuppliesDelivered;
+        currentStats.m_iSupplyDeliveryCount += previousStats.m_iSupplyDeliveryCount;
+        currentStats.m_iAIKills += previousStats.m_iAIKills;
+        currentStats.m_iVehicleKills += previousStats.m_iVehicleKills;
+        currentStats.m_iAirKills += previousStats.m_iAirKills;
+        
+        // Add session time to total playtime
+        currentStats.m_fTotalPlaytime += previousStats.m_fTotalPlaytime;
+        currentStats.m_fLastSessionDuration = previousStats.m_fLastSessionDuration;
+        
+        // Put the stored kill history ahead of any deaths recorded this session
+        if (previousStats.m_aKilledBy && previousStats.m_aKilledBy.Count() > 0)
+        {
+            // Create arrays if they don't exist
+            if (!currentStats.m_aKilledBy)
+                currentStats.m_aKilledBy = new array<string>();
+            
+            if (!currentStats.m_aKilledByWeapon)
+                currentStats.m_aKilledByWeapon = new array<string>();
+            
+            if (!currentStats.m_aKilledByTeam)
+                currentStats.m_aKilledByTeam = new array<int>();
+            
+            for (int i = 0; i < previousStats.m_aKilledBy.Count(); i++)
+            {
+                currentStats.m_aKilledBy.InsertAt(previousStats.m_aKilledBy[i], i);
+                
+                if (i < previousStats.m_aKilledByWeapon.Count())
+                    currentStats.m_aKilledByWeapon.InsertAt(previousStats.m_aKilledByWeapon[i], i);
+                else
+                    currentStats.m_aKilledByWeapon.InsertAt("Unknown", i);
+                
+                if (i < previousStats.m_aKilledByTeam.Count())
+                    currentStats.m_aKilledByTeam.InsertAt(previousStats.m_aKilledByTeam[i], i);
+                else
+                    currentStats.m_aKilledByTeam.InsertAt(-1, i);
+            }
+        }
+        
+        // Update rank based on loaded XP
+        player.UpdateRank();
+        
+        // The live stats now hold the stored totals and may be saved
+        m_PendingStoredStats.RemoveItem(playerUID);
+        m_mStoredStatsLoadFailures.Remove(playerUID);
+        
+        logger.LogInfo(string.Format("Successfully loaded previous stats for player %1 (UID: %2) - Kills: %3, XP: %4", 
+            player.GetPlayerName(), playerUID, currentStats.m_iKills, currentStats.m_iTotalXP), 
+            "STS_StatTrackingManagerComponent", "ApplyPreviousStats");
+    }
+    
     //------------------------------------------------------------------------------------------------
     // Get player UID from player ID - this is simplified for the example
     // In a real implementation, use a more robust method to get permanent player identifiers